@@ -79,6 +79,15 @@ class Alpr:
         self._recognize_array_func.restype = ctypes.c_void_p
         self._recognize_array_func.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_ubyte), ctypes.c_uint]
 
+        self._recognize_file_batch_func = self._openalprpy_lib.recognizeFileBatch
+        self._recognize_file_batch_func.restype = ctypes.c_void_p
+        self._recognize_file_batch_func.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_int]
+
+        self._recognize_array_batch_func = self._openalprpy_lib.recognizeArrayBatch
+        self._recognize_array_batch_func.restype = ctypes.c_void_p
+        self._recognize_array_batch_func.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.POINTER(ctypes.c_ubyte)),
+                                                     ctypes.POINTER(ctypes.c_int), ctypes.c_int]
+
         try:
             import numpy as np
             import numpy.ctypeslib as npct
@@ -170,6 +179,45 @@ class Alpr:
         self._free_json_mem_func(ctypes.c_void_p(ptr))
         return response_obj
 
+    def recognize_file_batch(self, file_paths):
+        """
+        This causes OpenALPR to recognize a list of image files on disk.  The images are
+        analyzed concurrently inside the library.
+
+        :param file_paths: A list of paths to the images that will be analyzed
+        :return: A list of response dictionaries, in the same order as file_paths
+        """
+        count = len(file_paths)
+        paths = (ctypes.c_char_p * count)(*[_convert_to_charp(path) for path in file_paths])
+        ptr = self._recognize_file_batch_func(self.alpr_pointer, paths, count)
+        json_data = ctypes.cast(ptr, ctypes.c_char_p).value
+        json_data = _convert_from_charp(json_data)
+        response_obj = json.loads(json_data)
+        self._free_json_mem_func(ctypes.c_void_p(ptr))
+        return response_obj
+
+    def recognize_array_batch(self, byte_arrays):
+        """
+        This causes OpenALPR to recognize a list of images passed in as byte arrays.  The images
+        are analyzed concurrently inside the library.
+
+        :param byte_arrays: A list of strings (Python 2) or bytes objects (Python 3)
+        :return: A list of response dictionaries, in the same order as byte_arrays
+        """
+        for byte_array in byte_arrays:
+            if type(byte_array) != bytes:
+                raise TypeError("Expected a byte array (string in Python 2, bytes in Python 3)")
+        count = len(byte_arrays)
+        buffers = (ctypes.POINTER(ctypes.c_ubyte) * count)(
+            *[ctypes.cast(byte_array, ctypes.POINTER(ctypes.c_ubyte)) for byte_array in byte_arrays])
+        lengths = (ctypes.c_int * count)(*[len(byte_array) for byte_array in byte_arrays])
+        ptr = self._recognize_array_batch_func(self.alpr_pointer, buffers, lengths, count)
+        json_data = ctypes.cast(ptr, ctypes.c_char_p).value
+        json_data = _convert_from_charp(json_data)
+        response_obj = json.loads(json_data)
+        self._free_json_mem_func(ctypes.c_void_p(ptr))
+        return response_obj
+
     def recognize_ndarray(self, ndarray):
         """
         This causes OpenALPR to attempt to recognize an image passed in as a numpy array.
@@ -4,6 +4,24 @@
 
 #include <alpr.h>
 
+// Serializes the results of a batch call to a malloc'd JSON array
+static char* batchResultsToJson(const std::vector<alpr::AlprResults>& results)
+{
+  std::string json = "[";
+  for (unsigned int i = 0; i < results.size(); i++)
+  {
+    if (i > 0)
+      json += ",";
+    alpr::Alpr::toJson(results[i], json);
+  }
+  json += "]";
+
+  char* membuffer = (char*)malloc(json.length() + 1);
+  strcpy(membuffer, json.c_str());
+
+  return membuffer;
+}
+
 extern "C" {
 
 #if defined(WIN32)
@@ -96,6 +114,29 @@ extern "C" {
       return membuffer;
     }
 
+  // Both batch functions respond with a JSON array of results, in the same order as the input
+  OPENALPR_EXPORT char* recognizeFileBatch(Alpr* nativeAlpr, char** cimageFiles, int count)
+    {
+      std::vector<std::string> imageFiles;
+      for (int i = 0; i < count; i++)
+        imageFiles.push_back(std::string(cimageFiles[i]));
+
+      std::vector<AlprResults> results = nativeAlpr->recognizeBatch(imageFiles);
+
+      return batchResultsToJson(results);
+    }
+
+  OPENALPR_EXPORT char* recognizeArrayBatch(Alpr* nativeAlpr, unsigned char** bufs, int* lens, int count)
+    {
+      std::vector<std::vector<char> > images(count);
+      for (int i = 0; i < count; i++)
+        images[i].assign(bufs[i], bufs[i] + lens[i]);
+
+      std::vector<AlprResults> results = nativeAlpr->recognizeBatch(images);
+
+      return batchResultsToJson(results);
+    }
+
   // AlprResults recognize(unsigned char* pixelData,
   // int bytesPerPixel, int imgWidth, int imgHeight,
   // std::vector<AlprRegionOfInterest> regionsOfInterest);
@@ -5,14 +5,17 @@
 #include <execinfo.h>
 
 #include "daemon/beanstalk.hpp"
+#include "daemon/queuewriter.h"
+#include "daemon/uploader.h"
+#include "daemon/imagewriter.h"
 #include "video/logging_videobuffer.h"
 #include "daemon/daemonconfig.h"
 
 #include "tclap/CmdLine.h"
 #include "alpr.h"
-#include "openalpr/cjson.h"
+#include "openalpr/plate_tracker.h"
+#include "openalpr/motiondetector.h"
 #include "support/tinythread.h"
-#include <curl/curl.h>
 #include "support/timing.h"
 
 #include <log4cplus/logger.h>
@@ -24,9 +27,7 @@
 using namespace alpr;
 
 // prototypes
-void streamRecognitionThread(void* arg);
-bool writeToQueue(std::string jsonResult);
-bool uploadPost(CURL* curl, std::string url, std::string data);
+void recognitionWorkerThread(void* arg);
 void dataUploadThread(void* arg);
 
 // Constants
@@ -51,16 +52,42 @@ struct CaptureThreadData
   std::string config_file;
   std::string country_code;
   std::string pattern;
-  bool output_images;
-  std::string output_image_folder;
   int top_n;
+  bool plate_groups;
+  bool motion_detection;
 };
 
-struct UploadThreadData
+// Per camera state.  Only one recognition worker processes a camera at a time,
+// so the frames of a camera are always processed in order
+struct CameraState
 {
-  std::string upload_url;
+  CaptureThreadData* tdata;
+  LoggingVideoBuffer* videoBuffer;
+  
+  MotionDetector motionDetector;
+  PlateTracker plateTracker;
+  int framenum;
+  
+  // Results written so far.  Part of each UUID, since several plate groups can finish on one frame
+  int64_t result_count;
+  
+  bool busy;
+
+  // Reused for the JSON of every result from this camera
+  std::string json_buffer;
+};
+
+struct RecognitionWorkerData
+{
+  Alpr* alpr;
+  std::vector<CameraState*>* cameras;
 };
 
+void processFrame(Alpr* alpr, CameraState* camera, cv::Mat latestFrame);
+void stopCamera(CameraState* camera);
+std::string writeResult(CameraState* camera, const AlprResults& results, cv::Mat frame);
+std::string writeResult(CameraState* camera, const AlprPlateGroup& group);
+
 void segfault_handler(int sig) {
   void *array[10];
   size_t size;
@@ -75,11 +102,28 @@ void segfault_handler(int sig) {
 
 bool daemon_active;
 
+// Guards the busy flags of the cameras and the round robin position
+tthread::mutex scheduler_mutex;
+unsigned int next_camera = 0;
+
+// Signalled when a camera captures a new frame or becomes idle.  Idle workers wait on it
+tthread::condition_variable scheduler_signal;
+
 static log4cplus::Logger logger;
 
+// Every recognition worker pushes its results through the same connection
+QueueWriter* queue_writer;
+
+// Saves the plate images when store_plates is enabled, NULL otherwise
+ImageWriter* image_writer = NULL;
+
 int main( int argc, const char** argv )
 {
   signal(SIGSEGV, segfault_handler);   // install our segfault handler
+
+  // The queue connection stays open.  A write after beanstalkd goes away must fail, not kill the daemon
+  signal(SIGPIPE, SIG_IGN);
+
   daemon_active = true;
 
   bool noDaemon = false;
@@ -181,296 +225,347 @@ int main( int argc, const char** argv )
   
   LOG4CPLUS_INFO(logger, "Using: " << daemon_config.imageFolder << " for storing valid plate images");
   
-  pid_t pid;
+  LOG4CPLUS_INFO(logger, "country: " << daemon_config.country << " -- config file: " << openAlprConfigFile );
+  LOG4CPLUS_INFO(logger, "pattern: " << daemon_config.pattern);
   
-  std::vector<tthread::thread*> threads;
+  // One recognizer is shared by every camera
+  Alpr alpr(daemon_config.country, openAlprConfigFile);
+  alpr.setTopN(daemon_config.topn);
+  alpr.setDefaultRegion(daemon_config.pattern);
+  
+  if (alpr.isLoaded() == false)
+  {
+    LOG4CPLUS_FATAL(logger, "Error loading OpenALPR");
+    return 1;
+  }
+  
+  queue_writer = new QueueWriter(BEANSTALK_QUEUE_HOST, BEANSTALK_PORT, BEANSTALK_TUBE_NAME,
+                                 daemon_config.queueOutboxSize, daemon_config.queueSpillFile, logger);
 
+  if (daemon_config.storePlates)
+  {
+    image_writer = new ImageWriter(daemon_config.imageFolder, daemon_config.storePlatesThreads, daemon_config.storePlatesQueueSize,
+                                   daemon_config.storePlatesJpegQuality, daemon_config.storePlatesCrops,
+                                   daemon_config.storePlatesMaxWidth, logger);
+  }
+
+  std::vector<CameraState*> cameras;
   for (int i = 0; i < daemon_config.stream_urls.size(); i++)
   {
-    pid = fork();
-    if (pid == (pid_t) 0)
-    {
-      // This is the child process, kick off the capture data and upload threads
-      CaptureThreadData* tdata = new CaptureThreadData();
-      tdata->stream_url = daemon_config.stream_urls[i];
-      tdata->camera_id = i + 1;
-      tdata->config_file = openAlprConfigFile;
-      tdata->output_images = daemon_config.storePlates;
-      tdata->output_image_folder = daemon_config.imageFolder;
-      tdata->country_code = daemon_config.country;
-      tdata->company_id = daemon_config.company_id;
-      tdata->site_id = daemon_config.site_id;
-      tdata->top_n = daemon_config.topn;
-      tdata->pattern = daemon_config.pattern;
-      tdata->clock_on = clockOn;
-      
-      tthread::thread* thread_recognize = new tthread::thread(streamRecognitionThread, (void*) tdata);
-      threads.push_back(thread_recognize);
-      
-      if (daemon_config.uploadData)
-      {
-	// Kick off the data upload thread
-	UploadThreadData* udata = new UploadThreadData();
-	udata->upload_url = daemon_config.upload_url;
-	tthread::thread* thread_upload = new tthread::thread(dataUploadThread, (void*) udata );
-        threads.push_back(thread_upload);
-      }
-      
-      break;
-    }
-    // Parent process will continue and spawn more children
+    CaptureThreadData* tdata = new CaptureThreadData();
+    tdata->stream_url = daemon_config.stream_urls[i];
+    tdata->camera_id = i + 1;
+    tdata->config_file = openAlprConfigFile;
+    tdata->country_code = daemon_config.country;
+    tdata->company_id = daemon_config.company_id;
+    tdata->site_id = daemon_config.site_id;
+    tdata->top_n = daemon_config.topn;
+    tdata->plate_groups = daemon_config.plateGroups;
+    tdata->motion_detection = daemon_config.motionDetection;
+    tdata->pattern = daemon_config.pattern;
+    tdata->clock_on = clockOn;
+    
+    CameraState* camera = new CameraState();
+    camera->tdata = tdata;
+    camera->framenum = 0;
+    camera->result_count = 0;
+    camera->busy = false;
+    
+    // Each video buffer runs its own capture thread
+    LOG4CPLUS_INFO(logger, "Stream " << tdata->camera_id << ": " << tdata->stream_url);
+    camera->videoBuffer = new LoggingVideoBuffer(logger);
+    camera->videoBuffer->setFrameNotification(&scheduler_mutex, &scheduler_signal);
+    camera->videoBuffer->connect(tdata->stream_url, 5);
+    
+    cameras.push_back(camera);
+  }
+  
+  int num_workers = daemon_config.recognitionThreads;
+  if (num_workers <= 0)
+    num_workers = tthread::thread::hardware_concurrency();
+  if (num_workers <= 0)
+    num_workers = 1;
+  
+  LOG4CPLUS_INFO(logger, "Processing " << cameras.size() << " cameras with " << num_workers << " recognition threads");
+  
+  RecognitionWorkerData wdata;
+  wdata.alpr = &alpr;
+  wdata.cameras = &cameras;
+  
+  std::vector<tthread::thread*> workers;
+  for (int i = 0; i < num_workers; i++)
+    workers.push_back(new tthread::thread(recognitionWorkerThread, (void*) &wdata));
+  
+  std::vector<tthread::thread*> threads;
+  HttpUploader* uploader = NULL;
+  if (daemon_config.uploadData)
+  {
+    // Kick off the data upload thread
+    uploader = new HttpUploader(daemon_config.upload_url, BEANSTALK_QUEUE_HOST, BEANSTALK_PORT, BEANSTALK_TUBE_NAME,
+                                daemon_config.uploadMaxInFlight, daemon_config.uploadBatchSize, logger);
+    tthread::thread* thread_upload = new tthread::thread(dataUploadThread, (void*) uploader );
+    threads.push_back(thread_upload);
   }
 
+  int64_t next_statistics_time = getTimeMonotonicMs() + daemon_config.statisticsInterval * 1000;
   while (daemon_active)
+  {
     alpr::sleep_ms(30);
 
+    if (daemon_config.statisticsInterval > 0 && getTimeMonotonicMs() >= next_statistics_time)
+    {
+      LOG4CPLUS_INFO(logger, "Statistics: " << Alpr::toJson(alpr.getStatistics()));
+      LOG4CPLUS_INFO(logger, "Queue statistics: " << QueueWriter::toJson(queue_writer->getStatistics()));
+      if (uploader != NULL)
+        LOG4CPLUS_INFO(logger, "Upload statistics: " << HttpUploader::toJson(uploader->getStatistics()));
+      if (image_writer != NULL)
+        LOG4CPLUS_INFO(logger, "Image statistics: " << ImageWriter::toJson(image_writer->getStatistics()));
+      next_statistics_time += daemon_config.statisticsInterval * 1000;
+    }
+  }
+
+  // Wake the idle workers so they see the daemon stopping
+  scheduler_mutex.lock();
+  scheduler_signal.notify_all();
+  scheduler_mutex.unlock();
+
+  for (unsigned int i = 0; i < workers.size(); i++)
+  {
+    workers[i]->join();
+    delete workers[i];
+  }
+  
+  for (unsigned int i = 0; i < cameras.size(); i++)
+    stopCamera(cameras[i]);
+
+  // Sends or spills whatever is still waiting
+  delete queue_writer;
+
+  // Saves the images still queued
+  delete image_writer;
+  
+  if (uploader != NULL)
+    uploader->stop();
+
   for (uint16_t i = 0; i < threads.size(); i++)
+  {
+    threads[i]->join();
     delete threads[i];
+  }
+
+  delete uploader;
   
   return 0;
 }
 
 
-void streamRecognitionThread(void* arg)
+// Recognition workers take the newest frame of the next idle camera, in round robin order,
+// so that a busy camera can not starve the others.  Frames that arrive while a camera is
+// being processed are dropped, except for the latest one
+void recognitionWorkerThread(void* arg)
 {
-  CaptureThreadData* tdata = (CaptureThreadData*) arg;
-  
-  LOG4CPLUS_INFO(logger, "country: " << tdata->country_code << " -- config file: " << tdata->config_file );
-  LOG4CPLUS_INFO(logger, "pattern: " << tdata->pattern);
-  LOG4CPLUS_INFO(logger, "Stream " << tdata->camera_id << ": " << tdata->stream_url);
-  
-  Alpr alpr(tdata->country_code, tdata->config_file);
-  alpr.setTopN(tdata->top_n);
-  alpr.setDefaultRegion(tdata->pattern);
-  
-  
-  int framenum = 0;
-  
-  LoggingVideoBuffer videoBuffer(logger);
-  
-  videoBuffer.connect(tdata->stream_url, 5);
-  
-  cv::Mat latestFrame;
-  
-  std::vector<uchar> buffer;
-  
-  LOG4CPLUS_INFO(logger, "Starting camera " << tdata->camera_id);
+  RecognitionWorkerData* wdata = (RecognitionWorkerData*) arg;
+  std::vector<CameraState*>& cameras = *wdata->cameras;
   
   while (daemon_active)
   {
-    std::vector<cv::Rect> regionsOfInterest;
-    int response = videoBuffer.getLatestFrame(&latestFrame, regionsOfInterest);
+    CameraState* camera = NULL;
+    VideoFrame frame;
     
-    if (response != -1)
+    scheduler_mutex.lock();
+    while (camera == NULL && daemon_active)
     {
-      
-      timespec startTime;
-      getTimeMonotonic(&startTime);
-      
-      std::vector<AlprRegionOfInterest> regionsOfInterest;
-      regionsOfInterest.push_back(AlprRegionOfInterest(0,0, latestFrame.cols, latestFrame.rows));
-
-      AlprResults results = alpr.recognize(latestFrame.data, latestFrame.elemSize(), latestFrame.cols, latestFrame.rows, regionsOfInterest);
-      
-      timespec endTime;
-      getTimeMonotonic(&endTime);
-      double totalProcessingTime = diffclock(startTime, endTime);
-      
-      if (tdata->clock_on)
-      {
-	LOG4CPLUS_INFO(logger, "Camera " << tdata->camera_id << " processed frame in: " << totalProcessingTime << " ms.");
-      }
-      
-      if (results.plates.size() > 0)
+      for (unsigned int i = 0; i < cameras.size() && camera == NULL; i++)
       {
-        
-        std::stringstream uuid_ss;
-        uuid_ss << tdata->site_id << "-cam" << tdata->camera_id << "-" << getEpochTimeMs();
-	std::string uuid = uuid_ss.str();
-        
-	// Save the image to disk (using the UUID)
-	if (tdata->output_images)
-	{
-	  std::stringstream ss;
-	  ss << tdata->output_image_folder << "/" << uuid << ".jpg";
-	  
-	  cv::imwrite(ss.str(), latestFrame);
-	}
-	
-	// Update the JSON content to include UUID and camera ID
-  
-	std::string json = alpr.toJson(results);
+	unsigned int index = (next_camera + i) % cameras.size();
+	if (cameras[index]->busy)
+	  continue;
 	
-	cJSON *root = cJSON_Parse(json.c_str());
-	cJSON_AddStringToObject(root,	"uuid",		uuid.c_str());
-	cJSON_AddNumberToObject(root,	"camera_id",	tdata->camera_id);
-	cJSON_AddStringToObject(root, 	"site_id", 	tdata->site_id.c_str());
-	cJSON_AddNumberToObject(root,	"img_width",	latestFrame.cols);
-	cJSON_AddNumberToObject(root,	"img_height",	latestFrame.rows);
-
-        // Add the company ID to the output if configured
-        if (tdata->company_id.length() > 0)
-          cJSON_AddStringToObject(root, 	"company_id", 	tdata->company_id.c_str());
-
-	char *out;
-	out=cJSON_PrintUnformatted(root);
-	cJSON_Delete(root);
-	
-	std::string response(out);
-	
-	free(out);
-	
-	// Push the results to the Beanstalk queue
-	for (int j = 0; j < results.plates.size(); j++)
+	if (cameras[index]->videoBuffer->getLatestFrame(&frame))
 	{
-	  LOG4CPLUS_DEBUG(logger, "Writing plate " << results.plates[j].bestPlate.characters << " (" <<  uuid << ") to queue.");
+	  camera = cameras[index];
+	  camera->busy = true;
+	  next_camera = index + 1;
 	}
-	
-	writeToQueue(response);
       }
+      
+      // No idle camera has a new frame.  The capture threads signal with the mutex
+      // held, so nothing can arrive between this check and the wait
+      if (camera == NULL)
+	scheduler_signal.wait(scheduler_mutex);
     }
+    scheduler_mutex.unlock();
     
-    usleep(10000);
+    if (camera == NULL)
+      break;
+    
+    processFrame(wdata->alpr, camera, frame.image);
+    
+    // Frames that arrived while the camera was busy could not be taken until now
+    scheduler_mutex.lock();
+    camera->busy = false;
+    scheduler_signal.notify_one();
+    scheduler_mutex.unlock();
   }
-  
-  
-  videoBuffer.disconnect();
-  
-  LOG4CPLUS_INFO(logger, "Video processing ended");
-  
-  delete tdata;
 }
 
-
-bool writeToQueue(std::string jsonResult)
+void processFrame(Alpr* alpr, CameraState* camera, cv::Mat latestFrame)
 {
-  try
+  CaptureThreadData* tdata = camera->tdata;
+  
+  timespec startTime;
+  getTimeMonotonic(&startTime);
+  
+  std::vector<AlprRegionOfInterest> regionsOfInterest;
+  if (tdata->motion_detection)
   {
-    Beanstalk::Client client(BEANSTALK_QUEUE_HOST, BEANSTALK_PORT);
-    client.use(BEANSTALK_TUBE_NAME);
-
-    int id = client.put(jsonResult);
+    if (camera->framenum == 0)
+      camera->motionDetector.ResetMotionDetection(&latestFrame);
     
-    if (id <= 0)
-    {
-      LOG4CPLUS_ERROR(logger, "Failed to write data to queue");
-      return false;
-    }
+    // Motion areas are padded so that a plate on the edge of a moving vehicle is not cut off
+    int motion_padding = alpr->getConfig()->minPlateSizeHeightPx;
+    cv::Size motion_min_size(alpr->getConfig()->minPlateSizeWidthPx, alpr->getConfig()->minPlateSizeHeightPx);
     
-    LOG4CPLUS_DEBUG(logger, "put job id: " << id );
-
+    std::vector<cv::Rect> motionRegions = camera->motionDetector.MotionDetectRegions(&latestFrame, motion_padding, motion_min_size);
+    for (unsigned int j = 0; j < motionRegions.size(); j++)
+      regionsOfInterest.push_back(AlprRegionOfInterest(motionRegions[j].x, motionRegions[j].y, motionRegions[j].width, motionRegions[j].height));
   }
-  catch (const std::runtime_error& error)
+  else
   {
-    LOG4CPLUS_WARN(logger, "Error connecting to Beanstalk.  Result has not been saved.");
-    return false;
+    regionsOfInterest.push_back(AlprRegionOfInterest(0,0, latestFrame.cols, latestFrame.rows));
   }
-  return true;
-}
-
-
-
-void dataUploadThread(void* arg)
-{
-  CURL *curl;
+  camera->framenum++;
 
+  // Nothing moved, so there is nothing new to detect
+  bool skip_frame = regionsOfInterest.size() == 0;
   
-  /* In windows, this will init the winsock stuff */ 
-  curl_global_init(CURL_GLOBAL_ALL);
+  AlprResults results;
+  std::vector<AlprPlateGroup> finishedGroups;
+  if (tdata->plate_groups && skip_frame)
+    results = camera->plateTracker.skipRecognition(latestFrame, finishedGroups);
+  else if (tdata->plate_groups)
+    results = camera->plateTracker.recognize(alpr, latestFrame, regionsOfInterest, finishedGroups);
+  else if (!skip_frame)
+    results = alpr->recognize(latestFrame.data, latestFrame.elemSize(), latestFrame.cols, latestFrame.rows, regionsOfInterest);
   
+  timespec endTime;
+  getTimeMonotonic(&endTime);
+  double totalProcessingTime = diffclock(startTime, endTime);
   
-  UploadThreadData* udata = (UploadThreadData*) arg;
-  
-
-  
+  if (tdata->clock_on)
+  {
+    if (skip_frame)
+      LOG4CPLUS_INFO(logger, "Camera " << tdata->camera_id << " skipped frame without motion in: " << totalProcessingTime << " ms.");
+    else if (tdata->plate_groups && camera->plateTracker.lastFrameReused())
+      LOG4CPLUS_INFO(logger, "Camera " << tdata->camera_id << " reused the previous results in: " << totalProcessingTime << " ms.");
+    else
+      LOG4CPLUS_INFO(logger, "Camera " << tdata->camera_id << " processed frame in: " << totalProcessingTime << " ms.");
+  }
   
-  while(daemon_active)
+  if (tdata->plate_groups)
   {
-    try
+    for (unsigned int j = 0; j < finishedGroups.size(); j++)
     {
-      /* get a curl handle */ 
-      curl = curl_easy_init();
-      Beanstalk::Client client(BEANSTALK_QUEUE_HOST, BEANSTALK_PORT);
-      
-      client.watch(BEANSTALK_TUBE_NAME);
-    
-      while (daemon_active)
-      {
-	Beanstalk::Job job;
-	
-	client.reserve(job);
-	
-	if (job.id() > 0)
-	{
-	  //LOG4CPLUS_DEBUG(logger, job.body() );
-	  if (uploadPost(curl, udata->upload_url, job.body()))
-	  {
-	    client.del(job.id());
-	    LOG4CPLUS_INFO(logger, "Job: " << job.id() << " successfully uploaded" );
-	    // Wait 10ms
-	    sleep_ms(10);
-	  }
-	  else
-	  {
-	    client.release(job);
-	    LOG4CPLUS_WARN(logger, "Job: " << job.id() << " failed to upload.  Will retry." );
-	    // Wait 2 seconds
-	    sleep_ms(2000);
-	  }
-	}
-	
-      }
-      
-      /* always cleanup */ 
-      curl_easy_cleanup(curl);
+      std::string uuid = writeResult(camera, finishedGroups[j]);
+      LOG4CPLUS_DEBUG(logger, "Writing plate group " << finishedGroups[j].bestPlate.characters << " (" <<  uuid << ", " << finishedGroups[j].frame_count << " frames) to queue.");
     }
-    catch (const std::runtime_error& error)
+  }
+  else if (results.plates.size() > 0)
+  {
+    std::string uuid = writeResult(camera, results, latestFrame);
+    
+    for (int j = 0; j < results.plates.size(); j++)
     {
-      LOG4CPLUS_WARN(logger, "Error connecting to Beanstalk.  Will retry." );
+      LOG4CPLUS_DEBUG(logger, "Writing plate " << results.plates[j].bestPlate.characters << " (" <<  uuid << ") to queue.");
     }
-    // wait 5 seconds
-    usleep(5000000);
   }
+}
+
+void stopCamera(CameraState* camera)
+{
+  CaptureThreadData* tdata = camera->tdata;
   
-  curl_global_cleanup();
+  // Report the plates still in view
+  std::vector<AlprPlateGroup> remainingGroups = camera->plateTracker.flush();
+  for (unsigned int j = 0; j < remainingGroups.size(); j++)
+    writeResult(camera, remainingGroups[j]);
+  
+  int64_t droppedFrames = camera->videoBuffer->getDroppedFrames();
+  camera->videoBuffer->disconnect();
+  
+  LOG4CPLUS_INFO(logger, "Camera " << tdata->camera_id << " video processing ended.  " << droppedFrames << " frames were dropped because processing fell behind");
+  
+  delete camera->videoBuffer;
+  delete camera;
+  delete tdata;
 }
 
+// Assigns a UUID to a new result and creates the fields that identify the stream it came from
+std::string createResultFields(CameraState* camera, std::vector<AlprJsonField>& fields)
+{
+  CaptureThreadData* tdata = camera->tdata;
+  
+  std::stringstream uuid_ss;
+  uuid_ss << tdata->site_id << "-cam" << tdata->camera_id << "-" << getEpochTimeMs() << "-" << camera->result_count++;
+  std::string uuid = uuid_ss.str();
+  
+  fields.push_back(AlprJsonField("uuid", uuid));
+  fields.push_back(AlprJsonField("camera_id", tdata->camera_id));
+  fields.push_back(AlprJsonField("site_id", tdata->site_id));
+
+  // Add the company ID to the output if configured
+  if (tdata->company_id.length() > 0)
+    fields.push_back(AlprJsonField("company_id", tdata->company_id));
+  
+  return uuid;
+}
 
-bool uploadPost(CURL* curl, std::string url, std::string data)
+// Queues the frame or plate images to be saved if configured and pushes the JSON to the queue
+void queueResult(const std::string& uuid, const std::string& json, cv::Mat frame, const std::vector<AlprPlateResult>& plates)
 {
-  bool success = true;
-  CURLcode res;
-  struct curl_slist *headers=NULL; // init to NULL is important
-
-  /* Add the required headers */ 
-  headers = curl_slist_append(headers,  "Accept: application/json");
-  headers = curl_slist_append( headers, "Content-Type: application/json");
-  headers = curl_slist_append( headers, "charsets: utf-8");
- 
-  if(curl) {
-	/* Add the headers */
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-   
-    /* First set the URL that is about to receive our POST. This URL can
-       just as well be a https:// URL if that is what should receive the
-       data. */ 
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    /* Now specify the POST data */ 
-    //char* escaped_data = curl_easy_escape(curl, data.c_str(), data.length());
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data.c_str());
-    //curl_free(escaped_data);
- 
-    /* Perform the request, res will get the return code */ 
-    res = curl_easy_perform(curl);
-    /* Check for errors */ 
-    if(res != CURLE_OK)
-    {
-      success = false;
-    }
- 
-  }
+  // Save the image to disk (using the UUID).  The frame is not written to after this point
+  if (image_writer != NULL)
+    image_writer->write(uuid, frame, plates);
   
-  return success;
+  // Push the results to the Beanstalk queue
+  queue_writer->write(json);
+}
 
+// Serializes the results, with the stream details, in one pass and queues them.
+// Returns the UUID assigned to the result
+std::string writeResult(CameraState* camera, const AlprResults& results, cv::Mat frame)
+{
+  std::vector<AlprJsonField> fields;
+  std::string uuid = createResultFields(camera, fields);
   
+  camera->json_buffer.clear();
+  Alpr::toJson(results, camera->json_buffer, fields);
+  
+  queueResult(uuid, camera->json_buffer, frame, results.plates);
+  
+  return uuid;
+}
+
+std::string writeResult(CameraState* camera, const AlprPlateGroup& group)
+{
+  std::vector<AlprJsonField> fields;
+  std::string uuid = createResultFields(camera, fields);
+  
+  // Plate results carry the frame size already, groups do not
+  fields.push_back(AlprJsonField("img_width", group.bestFrame.cols));
+  fields.push_back(AlprJsonField("img_height", group.bestFrame.rows));
+  
+  camera->json_buffer.clear();
+  PlateTracker::toJson(group, camera->json_buffer, fields);
+  
+  queueResult(uuid, camera->json_buffer, group.bestFrame, std::vector<AlprPlateResult>(1, group.bestResult));
+  
+  return uuid;
+}
+
+void dataUploadThread(void* arg)
+{
+  HttpUploader* uploader = (HttpUploader*) arg;
+
+  uploader->run();
 }
@@ -46,14 +46,27 @@ DaemonConfig::DaemonConfig(std::string config_file, std::string config_defaults_
 
   country = getString(&ini, &defaultIni, "daemon", "country", "us");
   topn = getInt(&ini, &defaultIni, "daemon", "topn", 20);
+  plateGroups = getBoolean(&ini, &defaultIni, "daemon", "plate_groups", false);
+  motionDetection = getBoolean(&ini, &defaultIni, "daemon", "motion_detection", false);
+  recognitionThreads = getInt(&ini, &defaultIni, "daemon", "recognition_threads", 0);
+  statisticsInterval = getInt(&ini, &defaultIni, "daemon", "statistics_interval", 60);
   
   storePlates = getBoolean(&ini, &defaultIni, "daemon", "store_plates", false);
   imageFolder = getString(&ini, &defaultIni, "daemon", "store_plates_location", "/tmp/");
+  storePlatesThreads = getInt(&ini, &defaultIni, "daemon", "store_plates_threads", 1);
+  storePlatesQueueSize = getInt(&ini, &defaultIni, "daemon", "store_plates_queue_size", 32);
+  storePlatesJpegQuality = getInt(&ini, &defaultIni, "daemon", "store_plates_jpeg_quality", 85);
+  storePlatesCrops = getBoolean(&ini, &defaultIni, "daemon", "store_plates_crops", false);
+  storePlatesMaxWidth = getInt(&ini, &defaultIni, "daemon", "store_plates_max_width", 0);
   uploadData = getBoolean(&ini, &defaultIni, "daemon", "upload_data", false);
   upload_url = getString(&ini, &defaultIni, "daemon", "upload_address", "");
+  uploadMaxInFlight = getInt(&ini, &defaultIni, "daemon", "upload_max_in_flight", 4);
+  uploadBatchSize = getInt(&ini, &defaultIni, "daemon", "upload_batch_size", 1);
   company_id = getString(&ini, &defaultIni, "daemon", "company_id", "");
   site_id = getString(&ini, &defaultIni, "daemon", "site_id", "");
   pattern = getString(&ini, &defaultIni, "daemon", "pattern", "");
+  queueOutboxSize = getInt(&ini, &defaultIni, "daemon", "queue_outbox_size", 1000);
+  queueSpillFile = getString(&ini, &defaultIni, "daemon", "queue_spill_file", "");
 }
 
 DaemonConfig::~DaemonConfig() {
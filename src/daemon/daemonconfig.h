@@ -16,13 +16,26 @@ public:
   std::string country;
   
   int topn;
+  bool plateGroups;
+  bool motionDetection;
+  int recognitionThreads;
+  int statisticsInterval;
   bool storePlates;
   std::string imageFolder;
+  int storePlatesThreads;
+  int storePlatesQueueSize;
+  int storePlatesJpegQuality;
+  bool storePlatesCrops;
+  int storePlatesMaxWidth;
   bool uploadData;
   std::string upload_url;
+  int uploadMaxInFlight;
+  int uploadBatchSize;
   std::string company_id;
   std::string site_id;
   std::string pattern;
+  int queueOutboxSize;
+  std::string queueSpillFile;
   
 private:
 
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2016 OpenALPR Technology, Inc.
+ * Open source Automated License Plate Recognition [http://www.openalpr.com]
+ *
+ * This file is part of OpenALPR.
+ *
+ * OpenALPR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "imagewriter.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "opencv2/highgui/highgui.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <log4cplus/loggingmacros.h>
+
+#include "openalpr/json_writer.h"
+#include "support/timing.h"
+
+using namespace alpr;
+
+// Plate crops are padded on each side by this fraction of the plate size
+const float PLATE_CROP_PADDING = 0.1;
+
+ImageWriter::ImageWriter(std::string folder, int num_threads, int max_queue, int jpeg_quality,
+                         bool store_crops, int max_width, log4cplus::Logger logger)
+{
+  this->folder = folder;
+  this->jpeg_quality = jpeg_quality;
+  this->store_crops = store_crops;
+  this->max_width = max_width;
+  this->max_queue = max_queue > 0 ? max_queue : 1;
+  this->logger = logger;
+
+  stopping = false;
+  max_queue_depth = 0;
+  written = 0;
+  dropped = 0;
+  failed = 0;
+
+  if (num_threads <= 0)
+    num_threads = 1;
+  for (int i = 0; i < num_threads; i++)
+    threads.push_back(new tthread::thread(writerThread, (void*) this));
+}
+
+ImageWriter::~ImageWriter()
+{
+  // The images already queued are still saved
+  queue_mutex.lock();
+  stopping = true;
+  queue_changed.notify_all();
+  queue_mutex.unlock();
+
+  for (unsigned int i = 0; i < threads.size(); i++)
+  {
+    threads[i]->join();
+    delete threads[i];
+  }
+}
+
+bool ImageWriter::write(const std::string& uuid, cv::Mat frame, const std::vector<AlprPlateResult>& plates)
+{
+  PendingImage image;
+  image.uuid = uuid;
+  image.frame = frame;
+
+  if (store_crops)
+  {
+    for (unsigned int i = 0; i < plates.size(); i++)
+    {
+      std::vector<cv::Point> points;
+      for (int p = 0; p < 4; p++)
+        points.push_back(cv::Point(plates[i].plate_points[p].x, plates[i].plate_points[p].y));
+      image.plate_rects.push_back(cv::boundingRect(points));
+    }
+  }
+
+  tthread::lock_guard<tthread::mutex> guard(queue_mutex);
+
+  if (queue.size() >= max_queue)
+  {
+    dropped++;
+    LOG4CPLUS_WARN(logger, "Image writer is falling behind.  Image " << uuid << " has not been saved.");
+    return false;
+  }
+
+  queue.push_back(image);
+  max_queue_depth = std::max(max_queue_depth, (int64_t) queue.size());
+  queue_changed.notify_one();
+
+  return true;
+}
+
+void ImageWriter::writerThread(void* arg)
+{
+  ImageWriter* writer = (ImageWriter*) arg;
+  writer->run();
+}
+
+void ImageWriter::run()
+{
+  queue_mutex.lock();
+  while (true)
+  {
+    if (queue.size() > 0)
+    {
+      PendingImage image = queue.front();
+      queue.pop_front();
+      queue_mutex.unlock();
+
+      save(image);
+
+      queue_mutex.lock();
+    }
+    else if (stopping)
+    {
+      break;
+    }
+    else
+    {
+      queue_changed.wait(queue_mutex);
+    }
+  }
+  queue_mutex.unlock();
+}
+
+void ImageWriter::save(PendingImage& image)
+{
+  timespec startTime;
+  getTimeMonotonic(&startTime);
+
+  if (store_crops)
+  {
+    cv::Rect frame_rect(0, 0, image.frame.cols, image.frame.rows);
+    for (unsigned int i = 0; i < image.plate_rects.size(); i++)
+    {
+      cv::Rect plate = image.plate_rects[i];
+      int pad_x = plate.width * PLATE_CROP_PADDING;
+      int pad_y = plate.height * PLATE_CROP_PADDING;
+      cv::Rect crop = cv::Rect(plate.x - pad_x, plate.y - pad_y, plate.width + 2 * pad_x, plate.height + 2 * pad_y) & frame_rect;
+
+      if (crop.area() == 0)
+        continue;
+
+      std::stringstream ss;
+      ss << folder << "/" << image.uuid << "-" << i << ".jpg";
+      saveJpeg(ss.str(), image.frame(crop));
+    }
+  }
+  else
+  {
+    cv::Mat output = image.frame;
+    if (max_width > 0 && image.frame.cols > max_width)
+    {
+      int height = (int) (image.frame.rows * ((float) max_width / image.frame.cols));
+      cv::resize(image.frame, output, cv::Size(max_width, height), 0, 0, cv::INTER_AREA);
+    }
+
+    std::stringstream ss;
+    ss << folder << "/" << image.uuid << ".jpg";
+    saveJpeg(ss.str(), output);
+  }
+
+  timespec endTime;
+  getTimeMonotonic(&endTime);
+  write_latency.record(diffclock(startTime, endTime));
+}
+
+bool ImageWriter::saveJpeg(const std::string& path, const cv::Mat& image)
+{
+  std::vector<int> params;
+  params.push_back(CV_IMWRITE_JPEG_QUALITY);
+  params.push_back(jpeg_quality);
+
+  bool success = false;
+  try
+  {
+    success = cv::imwrite(path, image, params);
+  }
+  catch (const cv::Exception& e)
+  {
+    success = false;
+  }
+
+  tthread::lock_guard<tthread::mutex> guard(queue_mutex);
+  if (success)
+  {
+    written++;
+  }
+  else
+  {
+    failed++;
+    LOG4CPLUS_WARN(logger, "Unable to save image " << path);
+  }
+
+  return success;
+}
+
+ImageWriterStatistics ImageWriter::getStatistics()
+{
+  ImageWriterStatistics statistics;
+
+  queue_mutex.lock();
+  statistics.queue_depth = queue.size();
+  statistics.max_queue_depth = max_queue_depth;
+  statistics.written = written;
+  statistics.dropped = dropped;
+  statistics.failed = failed;
+  queue_mutex.unlock();
+
+  statistics.write_latency = write_latency.summarize("write");
+
+  return statistics;
+}
+
+std::string ImageWriter::toJson(const ImageWriterStatistics& statistics)
+{
+  std::string response;
+
+  JsonWriter writer(response);
+  writer.beginObject();
+  writer.addNumber("queue_depth",	statistics.queue_depth);
+  writer.addNumber("max_queue_depth",	statistics.max_queue_depth);
+  writer.addNumber("written",	statistics.written);
+  writer.addNumber("dropped",	statistics.dropped);
+  writer.addNumber("failed",	statistics.failed);
+
+  writer.beginObject("write_latency");
+  writer.addNumber("count",  statistics.write_latency.count);
+  writer.addNumber("mean_ms",  statistics.write_latency.mean_ms);
+  writer.addNumber("p50_ms",  statistics.write_latency.p50_ms);
+  writer.addNumber("p99_ms",  statistics.write_latency.p99_ms);
+  writer.addNumber("max_ms",  statistics.write_latency.max_ms);
+  writer.endObject();
+
+  writer.endObject();
+
+  return response;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2016 OpenALPR Technology, Inc.
+ * Open source Automated License Plate Recognition [http://www.openalpr.com]
+ *
+ * This file is part of OpenALPR.
+ *
+ * OpenALPR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPENALPR_IMAGEWRITER_H
+#define OPENALPR_IMAGEWRITER_H
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "opencv2/core/core.hpp"
+#include <log4cplus/logger.h>
+
+#include "alpr.h"
+#include "openalpr/pipeline_statistics.h"
+#include "support/tinythread.h"
+
+struct ImageWriterStatistics
+{
+  int64_t queue_depth;
+  int64_t max_queue_depth;
+
+  int64_t written;
+  int64_t dropped;
+  int64_t failed;
+
+  // Time taken to crop or scale, encode and save one image
+  alpr::AlprStageStatistics write_latency;
+};
+
+// Saves the images of recognized plates on dedicated threads, so recognition never waits for
+// the JPEG encoder or the disk.  When the queue is full, new images are dropped and counted
+class ImageWriter
+{
+  public:
+    // store_crops saves one image per plate instead of the frame.  A max_width above 0 scales
+    // larger frames down to it
+    ImageWriter(std::string folder, int num_threads, int max_queue, int jpeg_quality,
+                bool store_crops, int max_width, log4cplus::Logger logger);
+    virtual ~ImageWriter();
+
+    // Queues the frame to be saved as <uuid>.jpg, or its plates as <uuid>-<plate index>.jpg.
+    // The frame is not copied and must not be modified afterwards.  Returns false if it was dropped
+    bool write(const std::string& uuid, cv::Mat frame, const std::vector<alpr::AlprPlateResult>& plates);
+
+    ImageWriterStatistics getStatistics();
+    static std::string toJson(const ImageWriterStatistics& statistics);
+
+  private:
+
+    struct PendingImage
+    {
+      std::string uuid;
+      cv::Mat frame;
+      std::vector<cv::Rect> plate_rects;
+    };
+
+    std::string folder;
+    int jpeg_quality;
+    bool store_crops;
+    int max_width;
+    unsigned int max_queue;
+    log4cplus::Logger logger;
+
+    std::deque<PendingImage> queue;
+    bool stopping;
+    tthread::mutex queue_mutex;
+    tthread::condition_variable queue_changed;
+
+    int64_t max_queue_depth;
+    int64_t written;
+    int64_t dropped;
+    int64_t failed;
+    alpr::LatencyHistogram write_latency;
+
+    std::vector<tthread::thread*> threads;
+
+    static void writerThread(void* arg);
+    void run();
+
+    void save(PendingImage& image);
+    bool saveJpeg(const std::string& path, const cv::Mat& image);
+};
+
+#endif // OPENALPR_IMAGEWRITER_H
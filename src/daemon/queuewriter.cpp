@@ -0,0 +1,536 @@
+/*
+ * Copyright (c) 2016 OpenALPR Technology, Inc.
+ * Open source Automated License Plate Recognition [http://www.openalpr.com]
+ *
+ * This file is part of OpenALPR.
+ *
+ * OpenALPR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "queuewriter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#include <log4cplus/loggingmacros.h>
+
+#include "openalpr/json_writer.h"
+#include "support/filesystem.h"
+#include "support/platform.h"
+#include "support/timing.h"
+
+using namespace alpr;
+
+// Seconds to wait for beanstalkd to accept a connection
+const float QUEUE_CONNECT_TIMEOUT = 5;
+
+// Reconnection attempts back off exponentially between these delays
+const int QUEUE_MIN_RETRY_MS = 1000;
+const int QUEUE_MAX_RETRY_MS = 30000;
+
+// Same defaults as Beanstalk::Client::put
+const uint32_t QUEUE_PUT_PRIORITY = 0;
+const uint32_t QUEUE_PUT_DELAY = 0;
+const uint32_t QUEUE_PUT_TTR = 60;
+
+int64_t QueueClient::putJob(const std::string& json)
+{
+  return bs_put(handle, QUEUE_PUT_PRIORITY, QUEUE_PUT_DELAY, QUEUE_PUT_TTR, (char*) json.data(), json.size());
+}
+
+// Reads the non-empty lines of a file.  A missing file has none
+static void readLines(const std::string& filename, std::vector<std::string>& lines)
+{
+  std::ifstream infile(filename.c_str());
+  std::string line;
+  while (std::getline(infile, line))
+  {
+    if (line.length() > 0)
+      lines.push_back(line);
+  }
+}
+
+QueueWriter::QueueWriter(std::string host, int port, std::string tube, int max_outbox, std::string spill_file,
+                         log4cplus::Logger logger)
+{
+  this->host = host;
+  this->port = port;
+  this->tube = tube;
+  this->max_outbox = max_outbox > 0 ? max_outbox : 1;
+  this->spill_file = spill_file;
+  this->logger = logger;
+
+  stopping = false;
+  retry_delay_ms = QUEUE_MIN_RETRY_MS;
+
+  written = 0;
+  spilled = 0;
+  dropped = 0;
+  rejected = 0;
+
+  // The first connection is not counted as a reconnect
+  reconnects = -1;
+
+  // Results spilled by a previous run are replayed along with the new ones
+  spill_depth = 0;
+  spill_sent = 0;
+  if (spill_file.length() > 0)
+  {
+    std::vector<std::string> lines;
+    readLines(spill_file, lines);
+    spill_depth = lines.size();
+
+    if (spill_depth > 0)
+      LOG4CPLUS_INFO(logger, spill_depth << " results from " << spill_file << " will be replayed to the queue");
+  }
+
+  writer_thread = new tthread::thread(writerThread, (void*) this);
+}
+
+QueueWriter::~QueueWriter()
+{
+  outbox_mutex.lock();
+  stopping = true;
+  outbox_changed.notify_all();
+  outbox_mutex.unlock();
+
+  writer_thread->join();
+  delete writer_thread;
+}
+
+bool QueueWriter::write(const std::string& json)
+{
+  PendingResult result;
+  result.json = json;
+  result.queued_time = getTimeMonotonicMs();
+
+  outbox_mutex.lock();
+  if (outbox.size() < max_outbox)
+  {
+    outbox.push_back(result);
+    outbox_changed.notify_all();
+    outbox_mutex.unlock();
+    return true;
+  }
+  outbox_mutex.unlock();
+
+  // The queue is not keeping up
+  if (spill_file.length() == 0)
+  {
+    LOG4CPLUS_WARN(logger, "Queue outbox is full.  Result has not been saved.");
+    countDropped(1);
+    return false;
+  }
+
+  std::vector<PendingResult> overflow(1, result);
+  spill(overflow, 0);
+  return true;
+}
+
+void QueueWriter::writerThread(void* arg)
+{
+  QueueWriter* writer = (QueueWriter*) arg;
+  writer->run();
+}
+
+void QueueWriter::run()
+{
+  while (true)
+  {
+    std::vector<PendingResult> batch;
+
+    outbox_mutex.lock();
+    while (!stopping && outbox.empty())
+    {
+      spill_mutex.lock();
+      bool replay = spill_depth > 0;
+      spill_mutex.unlock();
+      if (replay)
+        break;
+
+      outbox_changed.wait(outbox_mutex);
+    }
+
+    // Everything queued up while the last batch was being sent goes out together
+    batch.assign(outbox.begin(), outbox.end());
+    outbox.clear();
+    bool stop = stopping;
+    outbox_mutex.unlock();
+
+    if (connect() && replaySpill())
+      send(batch);
+    else
+      spill(batch, 0);
+
+    if (stop)
+      break;
+
+    if (!client.is_connected())
+      waitForRetry();
+  }
+
+  disconnect();
+
+  // Only possible without a spill file, when beanstalkd was down at shutdown
+  if (outbox.size() > 0)
+  {
+    LOG4CPLUS_WARN(logger, "Beanstalk is not available.  " << outbox.size() << " results have not been saved.");
+    countDropped(outbox.size());
+  }
+}
+
+bool QueueWriter::connect()
+{
+  if (client.is_connected())
+    return true;
+
+  try
+  {
+    client.connect(host, port, QUEUE_CONNECT_TIMEOUT);
+  }
+  catch (const std::runtime_error& error)
+  {
+    LOG4CPLUS_WARN(logger, "Error connecting to Beanstalk.  Will retry in " << retry_delay_ms / 1000 << " seconds.");
+    return false;
+  }
+
+  if (!client.use(tube))
+  {
+    LOG4CPLUS_WARN(logger, "Unable to use Beanstalk tube " << tube << ".  Will retry.");
+    disconnect();
+    return false;
+  }
+
+  statistics_mutex.lock();
+  reconnects++;
+  statistics_mutex.unlock();
+
+  LOG4CPLUS_INFO(logger, "Connected to Beanstalk at " << host << ":" << port);
+  retry_delay_ms = QUEUE_MIN_RETRY_MS;
+  return true;
+}
+
+void QueueWriter::disconnect()
+{
+  if (client.is_connected())
+    client.disconnect();
+}
+
+QueueWriter::PutResult QueueWriter::put(const std::string& json)
+{
+  timespec startTime;
+  getTimeMonotonic(&startTime);
+
+  int64_t id = client.putJob(json);
+
+  timespec endTime;
+  getTimeMonotonic(&endTime);
+  put_latency.record(diffclock(startTime, endTime));
+
+  if (id > 0)
+  {
+    LOG4CPLUS_DEBUG(logger, "put job id: " << id );
+    return PUT_OK;
+  }
+
+  // The socket failed, or the reply could not be read
+  if (id == BS_STATUS_FAIL || id == 0)
+  {
+    LOG4CPLUS_ERROR(logger, "Failed to write data to queue");
+    return PUT_FAILED;
+  }
+
+  if (id == BS_STATUS_JOB_TOO_BIG)
+    LOG4CPLUS_ERROR(logger, "Queue rejected a result of " << json.length() << " bytes as too big");
+  else if (id == BS_STATUS_DRAINING)
+    LOG4CPLUS_ERROR(logger, "Queue rejected a result because beanstalkd is draining");
+  else
+    LOG4CPLUS_ERROR(logger, "Queue rejected a result (status " << id << ")");
+
+  return PUT_REJECTED;
+}
+
+// Counts a result beanstalkd refused, and sets it aside in the dead letter file so it does not
+// hold up the results behind it.  Only called from the writer thread
+void QueueWriter::reject(const std::string& json)
+{
+  statistics_mutex.lock();
+  rejected++;
+  statistics_mutex.unlock();
+
+  if (spill_file.length() == 0)
+    return;
+
+  std::string rejected_file = spill_file + ".rejected";
+  std::ofstream outfile(rejected_file.c_str(), std::ios::out | std::ios::app);
+  outfile << json << "\n";
+  outfile.close();
+
+  if (outfile.fail())
+    LOG4CPLUS_ERROR(logger, "Unable to write to " << rejected_file << ".  A rejected result has not been saved.");
+}
+
+// Puts the batch back to back over the open connection.  If the connection fails part way,
+// the rest of the batch is spilled and the connection is dropped so it will be reopened
+void QueueWriter::send(std::vector<PendingResult>& batch)
+{
+  for (unsigned int i = 0; i < batch.size(); i++)
+  {
+    PutResult result = put(batch[i].json);
+    if (result == PUT_FAILED)
+    {
+      disconnect();
+      spill(batch, i);
+      return;
+    }
+
+    if (result == PUT_REJECTED)
+    {
+      reject(batch[i].json);
+      continue;
+    }
+
+    delivery_latency.record(getTimeMonotonicMs() - batch[i].queued_time);
+
+    statistics_mutex.lock();
+    written++;
+    statistics_mutex.unlock();
+  }
+}
+
+// Appends batch[first...] to the spill file, one result per line.  Without a spill file, the results
+// go back to the front of the outbox, as far as it has room for them
+void QueueWriter::spill(const std::vector<PendingResult>& batch, unsigned int first)
+{
+  if (first >= batch.size())
+    return;
+
+  if (spill_file.length() == 0)
+  {
+    int64_t lost = 0;
+
+    outbox_mutex.lock();
+    for (int i = batch.size() - 1; i >= (int) first; i--)
+    {
+      if (outbox.size() < max_outbox)
+        outbox.push_front(batch[i]);
+      else
+        lost++;
+    }
+    outbox_mutex.unlock();
+
+    if (lost > 0)
+    {
+      LOG4CPLUS_WARN(logger, "Queue outbox is full.  " << lost << " results have not been saved.");
+      countDropped(lost);
+    }
+    return;
+  }
+
+  spill_mutex.lock();
+
+  std::ofstream outfile(spill_file.c_str(), std::ios::out | std::ios::app);
+  for (unsigned int i = first; i < batch.size(); i++)
+    outfile << batch[i].json << "\n";
+  outfile.close();
+
+  int64_t count = batch.size() - first;
+  if (outfile.fail())
+  {
+    spill_mutex.unlock();
+    LOG4CPLUS_ERROR(logger, "Unable to write to queue spill file " << spill_file << ".  " << count << " results have not been saved.");
+    countDropped(count);
+    return;
+  }
+
+  spill_depth += count;
+  spill_mutex.unlock();
+
+  statistics_mutex.lock();
+  spilled += count;
+  statistics_mutex.unlock();
+}
+
+// Sends the spilled results.  Returns false if the connection failed, in which case the
+// results not sent yet are kept in the spill file.  The spill file is only locked while it is
+// read and rewritten, so write() can keep spilling while the results are on the network
+bool QueueWriter::replaySpill()
+{
+  std::vector<std::string> lines;
+  unsigned int sent;
+  {
+    tthread::lock_guard<tthread::mutex> guard(spill_mutex);
+
+    if (spill_depth == 0)
+      return true;
+
+    readLines(spill_file, lines);
+    sent = std::min((int64_t) lines.size(), spill_sent);
+  }
+
+  // Rejected results are set aside, so they count as sent
+  int64_t delivered = 0;
+  bool connected = true;
+  for (; sent < lines.size(); sent++)
+  {
+    PutResult result = put(lines[sent]);
+    if (result == PUT_FAILED)
+    {
+      connected = false;
+      break;
+    }
+
+    if (result == PUT_REJECTED)
+      reject(lines[sent]);
+    else
+      delivered++;
+  }
+
+  statistics_mutex.lock();
+  written += delivered;
+  statistics_mutex.unlock();
+
+  if (!connected)
+    disconnect();
+
+  if (delivered > 0)
+    LOG4CPLUS_INFO(logger, "Replayed " << delivered << " spilled results to the queue");
+
+  tthread::lock_guard<tthread::mutex> guard(spill_mutex);
+
+  // Keep what was not sent, followed by anything spilled during the replay
+  std::vector<std::string> current;
+  readLines(spill_file, current);
+
+  std::vector<std::string> remaining(lines.begin() + sent, lines.end());
+  if (current.size() > lines.size())
+    remaining.insert(remaining.end(), current.begin() + lines.size(), current.end());
+
+  bool rewritten;
+  if (remaining.size() == 0)
+  {
+    rewritten = std::remove(spill_file.c_str()) == 0 || !fileExists(spill_file.c_str());
+  }
+  else
+  {
+    // The new file is swapped in whole, so a crash can not lose the old one
+    std::string temp_file = spill_file + ".tmp";
+    std::ofstream outfile(temp_file.c_str(), std::ios::out | std::ios::trunc);
+    for (unsigned int i = 0; i < remaining.size(); i++)
+      outfile << remaining[i] << "\n";
+    outfile.close();
+
+    rewritten = !outfile.fail() && std::rename(temp_file.c_str(), spill_file.c_str()) == 0;
+  }
+
+  if (rewritten)
+  {
+    spill_sent = 0;
+    spill_depth = remaining.size();
+  }
+  else
+  {
+    // The results already sent are still at the start of the file.  Remember how many there are,
+    // so they are not put again while the daemon is running
+    spill_sent = sent;
+    spill_depth = remaining.size();
+    LOG4CPLUS_ERROR(logger, "Unable to rewrite queue spill file " << spill_file << ".  The " << sent
+                    << " results already sent will be skipped, but will be sent again if the daemon restarts.");
+  }
+
+  return connected;
+}
+
+void QueueWriter::waitForRetry()
+{
+  for (int waited = 0; waited < retry_delay_ms; waited += 100)
+  {
+    outbox_mutex.lock();
+    bool stop = stopping;
+    outbox_mutex.unlock();
+
+    if (stop)
+      return;
+
+    sleep_ms(100);
+  }
+
+  retry_delay_ms = std::min(retry_delay_ms * 2, QUEUE_MAX_RETRY_MS);
+}
+
+void QueueWriter::countDropped(int64_t count)
+{
+  statistics_mutex.lock();
+  dropped += count;
+  statistics_mutex.unlock();
+}
+
+QueueWriterStatistics QueueWriter::getStatistics()
+{
+  QueueWriterStatistics statistics;
+
+  outbox_mutex.lock();
+  statistics.outbox_depth = outbox.size();
+  outbox_mutex.unlock();
+
+  spill_mutex.lock();
+  statistics.spill_depth = spill_depth;
+  spill_mutex.unlock();
+
+  statistics_mutex.lock();
+  statistics.written = written;
+  statistics.spilled = spilled;
+  statistics.dropped = dropped;
+  statistics.reconnects = reconnects > 0 ? reconnects : 0;
+  statistics.rejected = rejected;
+  statistics_mutex.unlock();
+
+  statistics.put_latency = put_latency.summarize("put");
+  statistics.delivery_latency = delivery_latency.summarize("delivery");
+
+  return statistics;
+}
+
+std::string QueueWriter::toJson(const QueueWriterStatistics& statistics)
+{
+  std::string response;
+
+  JsonWriter writer(response);
+  writer.beginObject();
+  writer.addNumber("outbox_depth",	statistics.outbox_depth);
+  writer.addNumber("spill_depth",	statistics.spill_depth);
+  writer.addNumber("written",	statistics.written);
+  writer.addNumber("spilled",	statistics.spilled);
+  writer.addNumber("dropped",	statistics.dropped);
+  writer.addNumber("reconnects",	statistics.reconnects);
+  writer.addNumber("rejected",	statistics.rejected);
+
+  const alpr::AlprStageStatistics* latencies[2] = { &statistics.put_latency, &statistics.delivery_latency };
+  for (int i = 0; i < 2; i++)
+  {
+    std::string name = latencies[i]->stage + "_latency";
+    writer.beginObject(name.c_str());
+    writer.addNumber("count",  latencies[i]->count);
+    writer.addNumber("mean_ms",  latencies[i]->mean_ms);
+    writer.addNumber("p50_ms",  latencies[i]->p50_ms);
+    writer.addNumber("p99_ms",  latencies[i]->p99_ms);
+    writer.addNumber("max_ms",  latencies[i]->max_ms);
+    writer.endObject();
+  }
+
+  writer.endObject();
+
+  return response;
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2016 OpenALPR Technology, Inc.
+ * Open source Automated License Plate Recognition [http://www.openalpr.com]
+ *
+ * This file is part of OpenALPR.
+ *
+ * OpenALPR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPENALPR_QUEUEWRITER_H
+#define OPENALPR_QUEUEWRITER_H
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <log4cplus/logger.h>
+
+#include "beanstalk.hpp"
+#include "alpr.h"
+#include "openalpr/pipeline_statistics.h"
+#include "support/tinythread.h"
+
+struct QueueWriterStatistics
+{
+  // Results waiting in memory, and on disk in the spill file
+  int64_t outbox_depth;
+  int64_t spill_depth;
+
+  int64_t written;
+  int64_t spilled;
+  int64_t dropped;
+  int64_t reconnects;
+
+  // Results beanstalkd refused (e.g., too big, or the server is draining).  They are set aside
+  // in the dead letter file instead of being retried
+  int64_t rejected;
+
+  // Time taken by each put, and from write() until the result was in the queue
+  alpr::AlprStageStatistics put_latency;
+  alpr::AlprStageStatistics delivery_latency;
+};
+
+// Beanstalk::Client::put returns 0 for every failure.  This keeps the beanstalkd status, so a result
+// the server refuses can be told apart from a lost connection
+class QueueClient : public Beanstalk::Client
+{
+  public:
+    // Returns the job id, or one of the BS_STATUS_* failure codes
+    int64_t putJob(const std::string& json);
+};
+
+// Pushes results to a beanstalkd tube from a background thread, over one persistent connection.
+// Results wait in a bounded outbox while the queue is slow.  When beanstalkd can not be reached,
+// or the outbox is full, they are appended to a spill file and replayed once the queue is back.
+// Results beanstalkd refuses are appended to the spill file name + ".rejected", and not retried
+class QueueWriter
+{
+  public:
+    // An empty spill_file disables spilling: results that do not fit in the outbox are dropped
+    QueueWriter(std::string host, int port, std::string tube, int max_outbox, std::string spill_file,
+                log4cplus::Logger logger);
+    virtual ~QueueWriter();
+
+    // Queues the result and returns immediately.  Returns false if it had to be dropped
+    bool write(const std::string& json);
+
+    QueueWriterStatistics getStatistics();
+    static std::string toJson(const QueueWriterStatistics& statistics);
+
+  private:
+
+    struct PendingResult
+    {
+      std::string json;
+      int64_t queued_time;
+    };
+
+    enum PutResult
+    {
+      PUT_OK,
+      PUT_FAILED,     // The connection failed, the result should be retried
+      PUT_REJECTED    // beanstalkd refused this result, retrying will not help
+    };
+
+    std::string host;
+    int port;
+    std::string tube;
+    unsigned int max_outbox;
+    std::string spill_file;
+    log4cplus::Logger logger;
+
+    std::deque<PendingResult> outbox;
+    bool stopping;
+    tthread::mutex outbox_mutex;
+    tthread::condition_variable outbox_changed;
+
+    // Guards the spill file, spill_depth and spill_sent
+    tthread::mutex spill_mutex;
+    int64_t spill_depth;
+
+    // Lines at the start of the spill file that were already sent, but could not be removed from it.
+    // They are skipped by the next replay
+    int64_t spill_sent;
+
+    // Only used by the writer thread
+    QueueClient client;
+    int retry_delay_ms;
+
+    tthread::mutex statistics_mutex;
+    int64_t written;
+    int64_t spilled;
+    int64_t dropped;
+    int64_t reconnects;
+    int64_t rejected;
+    alpr::LatencyHistogram put_latency;
+    alpr::LatencyHistogram delivery_latency;
+
+    tthread::thread* writer_thread;
+
+    static void writerThread(void* arg);
+    void run();
+
+    bool connect();
+    void disconnect();
+    PutResult put(const std::string& json);
+    void reject(const std::string& json);
+
+    void send(std::vector<PendingResult>& batch);
+    void spill(const std::vector<PendingResult>& batch, unsigned int first);
+    bool replaySpill();
+    void waitForRetry();
+    void countDropped(int64_t count);
+};
+
+#endif // OPENALPR_QUEUEWRITER_H
@@ -0,0 +1,399 @@
+/*
+ * Copyright (c) 2016 OpenALPR Technology, Inc.
+ * Open source Automated License Plate Recognition [http://www.openalpr.com]
+ *
+ * This file is part of OpenALPR.
+ *
+ * OpenALPR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "uploader.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+#include <log4cplus/loggingmacros.h>
+
+#include "openalpr/json_writer.h"
+#include "support/platform.h"
+#include "support/timing.h"
+
+using namespace alpr;
+
+// A request that takes longer is failed and retried.  Must be well under the job TTR (60s),
+// or beanstalkd hands the job out again while it is still being posted
+const long UPLOAD_REQUEST_TIMEOUT = 30;
+
+// Consecutive failures back off exponentially between these delays
+const int UPLOAD_MIN_BACKOFF_MS = 1000;
+const int UPLOAD_MAX_BACKOFF_MS = 60000;
+
+// How often the tube depth is read from beanstalkd.  Also how quickly a lost connection is noticed
+const int UPLOAD_QUEUE_STATS_INTERVAL_MS = 5000;
+
+// Priority of the jobs released after a failed upload.  New results (priority 0) go first
+const uint32_t UPLOAD_RETRY_PRIORITY = 1;
+
+HttpUploader::HttpUploader(std::string url, std::string queue_host, int queue_port, std::string tube,
+                           int max_in_flight, int batch_size, log4cplus::Logger logger)
+{
+  this->url = url;
+  this->queue_host = queue_host;
+  this->queue_port = queue_port;
+  this->tube = tube;
+  this->max_in_flight = max_in_flight > 0 ? max_in_flight : 1;
+  this->batch_size = batch_size > 0 ? batch_size : 1;
+  this->logger = logger;
+
+  stopping = false;
+  backoff_until = 0;
+
+  queue_ready = 0;
+  queue_delayed = 0;
+  requests = 0;
+  active_requests = 0;
+  failed_requests = 0;
+  uploaded = 0;
+  retries = 0;
+  backoff_ms = 0;
+
+  /* In windows, this will init the winsock stuff */ 
+  curl_global_init(CURL_GLOBAL_ALL);
+
+  multi = curl_multi_init();
+
+  // The same headers go with every request
+  headers = NULL;
+  headers = curl_slist_append(headers, "Accept: application/json");
+  headers = curl_slist_append(headers, "Content-Type: application/json");
+  headers = curl_slist_append(headers, "charsets: utf-8");
+}
+
+HttpUploader::~HttpUploader()
+{
+  for (unsigned int i = 0; i < idle_handles.size(); i++)
+    curl_easy_cleanup(idle_handles[i]);
+
+  curl_multi_cleanup(multi);
+  curl_slist_free_all(headers);
+
+  curl_global_cleanup();
+}
+
+void HttpUploader::stop()
+{
+  statistics_mutex.lock();
+  stopping = true;
+  statistics_mutex.unlock();
+}
+
+bool HttpUploader::isStopping()
+{
+  tthread::lock_guard<tthread::mutex> guard(statistics_mutex);
+  return stopping;
+}
+
+void HttpUploader::run()
+{
+  int64_t next_queue_statistics = 0;
+
+  while (!isStopping())
+  {
+    if (!connectQueue())
+    {
+      // wait 5 seconds
+      for (int i = 0; i < 50 && !isStopping(); i++)
+        sleep_ms(100);
+      continue;
+    }
+
+    startRequests();
+
+    if (in_flight.size() > 0)
+    {
+      int running;
+      curl_multi_perform(multi, &running);
+      curl_multi_wait(multi, NULL, 0, 100, NULL);
+      curl_multi_perform(multi, &running);
+
+      CURLMsg* message;
+      int remaining;
+      while ((message = curl_multi_info_read(multi, &remaining)) != NULL)
+      {
+        if (message->msg == CURLMSG_DONE)
+          finishRequest(message->easy_handle, message->data.result);
+      }
+    }
+    else if (getTimeMonotonicMs() < backoff_until)
+    {
+      sleep_ms(100);
+    }
+
+    if (getTimeMonotonicMs() >= next_queue_statistics)
+    {
+      refreshQueueStatistics();
+      next_queue_statistics = getTimeMonotonicMs() + UPLOAD_QUEUE_STATS_INTERVAL_MS;
+    }
+  }
+
+  // Whatever is still being posted goes back in the queue, to be sent again straight away
+  while (in_flight.size() > 0)
+    releaseRequest(in_flight.back(), 0);
+
+  if (client.is_connected())
+    client.disconnect();
+}
+
+bool HttpUploader::connectQueue()
+{
+  if (client.is_connected())
+    return true;
+
+  try
+  {
+    client.connect(queue_host, queue_port);
+  }
+  catch (const std::runtime_error& error)
+  {
+    LOG4CPLUS_WARN(logger, "Error connecting to Beanstalk.  Will retry." );
+    return false;
+  }
+
+  if (!client.watch(tube))
+  {
+    LOG4CPLUS_WARN(logger, "Unable to watch Beanstalk tube " << tube << ".  Will retry." );
+    client.disconnect();
+    return false;
+  }
+
+  return true;
+}
+
+void HttpUploader::refreshQueueStatistics()
+{
+  Beanstalk::info_hash_t tube_stats = client.stats_tube(tube);
+
+  if (tube_stats.size() == 0)
+  {
+    // The connection is gone.  Jobs reserved on it are released by beanstalkd, and will be
+    // reserved again once reconnected, so the requests still in flight are abandoned
+    LOG4CPLUS_WARN(logger, "Lost the connection to Beanstalk.  Will reconnect." );
+    while (in_flight.size() > 0)
+      releaseRequest(in_flight.back(), 0);
+    client.disconnect();
+    return;
+  }
+
+  statistics_mutex.lock();
+  queue_ready = atol(tube_stats["current-jobs-ready"].c_str());
+  queue_delayed = atol(tube_stats["current-jobs-delayed"].c_str());
+  statistics_mutex.unlock();
+}
+
+// Reserves the jobs that are ready, in batches, while there is room for more requests
+void HttpUploader::startRequests()
+{
+  while (in_flight.size() < max_in_flight && getTimeMonotonicMs() >= backoff_until)
+  {
+    std::vector<Beanstalk::Job> jobs;
+    Beanstalk::Job job;
+
+    // Only block (briefly) when there is nothing else to do.  A batch never waits to be filled
+    uint32_t timeout = in_flight.size() == 0 ? 1 : 0;
+    while (jobs.size() < batch_size && client.reserve(job, jobs.size() == 0 ? timeout : 0))
+    {
+      if (job.id() > 0)
+        jobs.push_back(job);
+    }
+
+    if (jobs.size() == 0)
+      return;
+
+    startRequest(jobs);
+  }
+}
+
+void HttpUploader::startRequest(std::vector<Beanstalk::Job>& jobs)
+{
+  UploadRequest* request = new UploadRequest();
+
+  if (idle_handles.size() > 0)
+  {
+    request->curl = idle_handles.back();
+    idle_handles.pop_back();
+  }
+  else
+  {
+    request->curl = curl_easy_init();
+  }
+
+  for (unsigned int i = 0; i < jobs.size(); i++)
+    request->job_ids.push_back(jobs[i].id());
+
+  if (jobs.size() == 1)
+  {
+    request->body = jobs[0].body();
+  }
+  else
+  {
+    request->body = "[";
+    for (unsigned int i = 0; i < jobs.size(); i++)
+    {
+      if (i > 0)
+        request->body += ",";
+      request->body += jobs[i].body();
+    }
+    request->body += "]";
+  }
+
+  CURL* curl = request->curl;
+  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request->body.c_str());
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long) request->body.length());
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT, UPLOAD_REQUEST_TIMEOUT);
+  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discardResponse);
+  curl_easy_setopt(curl, CURLOPT_PRIVATE, (char*) request);
+
+  getTimeMonotonic(&request->start_time);
+  curl_multi_add_handle(multi, curl);
+  in_flight.push_back(request);
+
+  statistics_mutex.lock();
+  requests++;
+  active_requests++;
+  statistics_mutex.unlock();
+}
+
+void HttpUploader::finishRequest(CURL* curl, CURLcode result)
+{
+  UploadRequest* request;
+  curl_easy_getinfo(curl, CURLINFO_PRIVATE, (char**) &request);
+
+  long status = 0;
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+
+  timespec endTime;
+  getTimeMonotonic(&endTime);
+  request_latency.record(diffclock(request->start_time, endTime));
+
+  if (result == CURLE_OK && status >= 200 && status < 300)
+  {
+    for (unsigned int i = 0; i < request->job_ids.size(); i++)
+    {
+      client.del(request->job_ids[i]);
+      LOG4CPLUS_INFO(logger, "Job: " << request->job_ids[i] << " successfully uploaded" );
+    }
+
+    statistics_mutex.lock();
+    uploaded += request->job_ids.size();
+    backoff_ms = 0;
+    statistics_mutex.unlock();
+
+    retireRequest(request);
+    return;
+  }
+
+  statistics_mutex.lock();
+  failed_requests++;
+  retries += request->job_ids.size();
+  backoff_ms = std::min(std::max(backoff_ms * 2, UPLOAD_MIN_BACKOFF_MS), UPLOAD_MAX_BACKOFF_MS);
+  int delay_ms = backoff_ms;
+  statistics_mutex.unlock();
+
+  if (result != CURLE_OK)
+    LOG4CPLUS_WARN(logger, request->job_ids.size() << " jobs failed to upload: " << curl_easy_strerror(result) << ".  Will retry in " << delay_ms / 1000 << " seconds." );
+  else
+    LOG4CPLUS_WARN(logger, request->job_ids.size() << " jobs failed to upload: HTTP " << status << ".  Will retry in " << delay_ms / 1000 << " seconds." );
+
+  // Stop posting to the endpoint until the backoff expires.  The jobs themselves are delayed by the queue
+  backoff_until = getTimeMonotonicMs() + delay_ms;
+  releaseRequest(request, delay_ms / 1000);
+}
+
+// Gives the jobs of the request back to the queue and frees it
+void HttpUploader::releaseRequest(UploadRequest* request, int delay_seconds)
+{
+  for (unsigned int i = 0; i < request->job_ids.size(); i++)
+    client.release(request->job_ids[i], UPLOAD_RETRY_PRIORITY, delay_seconds);
+
+  retireRequest(request);
+}
+
+// Keeps the curl handle for the next request and frees the rest
+void HttpUploader::retireRequest(UploadRequest* request)
+{
+  in_flight.erase(std::find(in_flight.begin(), in_flight.end(), request));
+  curl_multi_remove_handle(multi, request->curl);
+  idle_handles.push_back(request->curl);
+  delete request;
+
+  statistics_mutex.lock();
+  active_requests--;
+  statistics_mutex.unlock();
+}
+
+size_t HttpUploader::discardResponse(char* data, size_t size, size_t count, void* userdata)
+{
+  return size * count;
+}
+
+UploaderStatistics HttpUploader::getStatistics()
+{
+  UploaderStatistics statistics;
+
+  statistics_mutex.lock();
+  statistics.queue_ready = queue_ready;
+  statistics.queue_delayed = queue_delayed;
+  statistics.in_flight = active_requests;
+  statistics.requests = requests;
+  statistics.failed_requests = failed_requests;
+  statistics.uploaded = uploaded;
+  statistics.retries = retries;
+  statistics.backoff_ms = backoff_ms;
+  statistics_mutex.unlock();
+
+  statistics.request_latency = request_latency.summarize("request");
+
+  return statistics;
+}
+
+std::string HttpUploader::toJson(const UploaderStatistics& statistics)
+{
+  std::string response;
+
+  JsonWriter writer(response);
+  writer.beginObject();
+  writer.addNumber("queue_ready",	statistics.queue_ready);
+  writer.addNumber("queue_delayed",	statistics.queue_delayed);
+  writer.addNumber("in_flight",	statistics.in_flight);
+  writer.addNumber("requests",	statistics.requests);
+  writer.addNumber("failed_requests",	statistics.failed_requests);
+  writer.addNumber("uploaded",	statistics.uploaded);
+  writer.addNumber("retries",	statistics.retries);
+  writer.addNumber("backoff_ms",	statistics.backoff_ms);
+
+  writer.beginObject("request_latency");
+  writer.addNumber("count",  statistics.request_latency.count);
+  writer.addNumber("mean_ms",  statistics.request_latency.mean_ms);
+  writer.addNumber("p50_ms",  statistics.request_latency.p50_ms);
+  writer.addNumber("p99_ms",  statistics.request_latency.p99_ms);
+  writer.addNumber("max_ms",  statistics.request_latency.max_ms);
+  writer.endObject();
+
+  writer.endObject();
+
+  return response;
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2016 OpenALPR Technology, Inc.
+ * Open source Automated License Plate Recognition [http://www.openalpr.com]
+ *
+ * This file is part of OpenALPR.
+ *
+ * OpenALPR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPENALPR_UPLOADER_H
+#define OPENALPR_UPLOADER_H
+
+#include <string>
+#include <vector>
+
+#include <curl/curl.h>
+#include <log4cplus/logger.h>
+
+#include "beanstalk.hpp"
+#include "alpr.h"
+#include "openalpr/pipeline_statistics.h"
+#include "support/tinythread.h"
+
+struct UploaderStatistics
+{
+  // Jobs in the beanstalk tube that are ready to go, and waiting out a retry delay
+  int64_t queue_ready;
+  int64_t queue_delayed;
+
+  int64_t in_flight;
+  int64_t requests;
+  int64_t failed_requests;
+  int64_t uploaded;
+  int64_t retries;
+
+  // The current delay before the endpoint is tried again, 0 while it is healthy
+  int backoff_ms;
+
+  alpr::AlprStageStatistics request_latency;
+};
+
+// Posts the results waiting in a beanstalk tube to an HTTP endpoint.  Up to max_in_flight
+// requests run concurrently on one curl multi handle, each carrying up to batch_size results.
+// A batch of more than one result is posted as a JSON array.  After a failure the jobs are
+// released with a delay and no new requests are started until the endpoint's backoff expires
+class HttpUploader
+{
+  public:
+    HttpUploader(std::string url, std::string queue_host, int queue_port, std::string tube,
+                 int max_in_flight, int batch_size, log4cplus::Logger logger);
+    virtual ~HttpUploader();
+
+    // Uploads until stop() is called
+    void run();
+    void stop();
+
+    UploaderStatistics getStatistics();
+    static std::string toJson(const UploaderStatistics& statistics);
+
+  private:
+
+    struct UploadRequest
+    {
+      CURL* curl;
+      std::vector<int64_t> job_ids;
+      std::string body;
+      timespec start_time;
+    };
+
+    std::string url;
+    std::string queue_host;
+    int queue_port;
+    std::string tube;
+    unsigned int max_in_flight;
+    unsigned int batch_size;
+    log4cplus::Logger logger;
+
+    bool stopping;
+
+    // Only used by the upload thread
+    Beanstalk::Client client;
+    CURLM* multi;
+    struct curl_slist* headers;
+    std::vector<UploadRequest*> in_flight;
+    std::vector<CURL*> idle_handles;
+    int64_t backoff_until;
+
+    tthread::mutex statistics_mutex;
+    int64_t queue_ready;
+    int64_t queue_delayed;
+    int64_t requests;
+    int64_t active_requests;
+    int64_t failed_requests;
+    int64_t uploaded;
+    int64_t retries;
+    int backoff_ms;
+    alpr::LatencyHistogram request_latency;
+
+    bool isStopping();
+    bool connectQueue();
+    void refreshQueueStatistics();
+
+    void startRequests();
+    void startRequest(std::vector<Beanstalk::Job>& jobs);
+    void finishRequest(CURL* curl, CURLcode result);
+    void releaseRequest(UploadRequest* request, int delay_seconds);
+    void retireRequest(UploadRequest* request);
+
+    static size_t discardResponse(char* data, size_t size, size_t count, void* userdata);
+};
+
+#endif // OPENALPR_UPLOADER_H
@@ -32,6 +32,7 @@
 #include "support/platform.h"
 #include "video/videobuffer.h"
 #include "motiondetector.h"
+#include "plate_tracker.h"
 #include "alpr.h"
 
 using namespace alpr;
@@ -43,14 +44,20 @@ const std::string LAST_VIDEO_STILL_LOCATION = "/tmp/laststill.jpg";
 const std::string WEBCAM_PREFIX = "/dev/video";
 MotionDetector motiondetector;
 bool do_motiondetection = true;
+PlateTracker platetracker;
+bool do_plategroups = false;
 
 /** Function Headers */
-bool detectandshow(Alpr* alpr, cv::Mat frame, std::string region, bool writeJson);
+bool detectandshow(Alpr* alpr, cv::Mat frame, std::string region, bool writeJson, PlateTracker* tracker = NULL);
+void printPlateGroups(std::vector<AlprPlateGroup> groups, bool writeJson);
 bool is_supported_image(std::string image_file);
 
 bool measureProcessingTime = false;
 std::string templatePattern;
 
+// Reused for the JSON output of every frame
+std::string json_buffer;
+
 // This boolean is set to false when the user hits terminates (e.g., CTRL+C )
 // so we can end infinite loops for things like video processing.
 bool program_active = true;
@@ -82,6 +89,7 @@ int main( int argc, const char** argv )
   TCLAP::SwitchArg detectRegionSwitch("d","detect_region","Attempt to detect the region of the plate image.  [Experimental]  Default=off", cmd, false);
   TCLAP::SwitchArg clockSwitch("","clock","Measure/print the total time to process image and all plates.  Default=off", cmd, false);
   TCLAP::SwitchArg motiondetect("", "motion", "Use motion detection on video file or stream.  Default=off", cmd, false);
+  TCLAP::SwitchArg plategroupSwitch("g", "group", "Group the plates found on a video file or stream and print one result per plate once it leaves the scene.  Default=off", cmd, false);
 
   try
   {
@@ -111,6 +119,7 @@ int main( int argc, const char** argv )
     topn = topNArg.getValue();
     measureProcessingTime = clockSwitch.getValue();
 	do_motiondetection = motiondetect.getValue();
+    do_plategroups = plategroupSwitch.getValue();
   }
   catch (TCLAP::ArgException &e)    // catch any exceptions
   {
@@ -204,10 +213,13 @@ int main( int argc, const char** argv )
       {
         if (framenum == 0)
           motiondetector.ResetMotionDetection(&frame);
-        detectandshow(&alpr, frame, "", outputJson);
+        detectandshow(&alpr, frame, "", outputJson, do_plategroups ? &platetracker : NULL);
         sleep_ms(10);
         framenum++;
       }
+
+      if (do_plategroups)
+        printPlateGroups(platetracker.flush(), outputJson);
     }
     else if (startsWith(filename, "http://") || startsWith(filename, "https://"))
     {
@@ -228,7 +240,7 @@ int main( int argc, const char** argv )
         {
           if (framenum == 0)
             motiondetector.ResetMotionDetection(&latestFrame);
-          detectandshow(&alpr, latestFrame, "", outputJson);
+          detectandshow(&alpr, latestFrame, "", outputJson, do_plategroups ? &platetracker : NULL);
         }
 
         // Sleep 10ms
@@ -238,6 +250,9 @@ int main( int argc, const char** argv )
 
       videoBuffer.disconnect();
 
+      if (do_plategroups)
+        printPlateGroups(platetracker.flush(), outputJson);
+
       std::cout << "Video processing ended" << std::endl;
     }
     else if (hasEndingInsensitive(filename, ".avi") || hasEndingInsensitive(filename, ".mp4") ||
@@ -266,11 +281,14 @@ int main( int argc, const char** argv )
           
           if (framenum == 0)
             motiondetector.ResetMotionDetection(&frame);
-          detectandshow(&alpr, frame, "", outputJson);
+          detectandshow(&alpr, frame, "", outputJson, do_plategroups ? &platetracker : NULL);
           //create a 1ms delay
           sleep_ms(1);
           framenum++;
         }
+
+        if (do_plategroups)
+          printPlateGroups(platetracker.flush(), outputJson);
       }
       else
       {
@@ -335,7 +353,7 @@ bool is_supported_image(std::string image_file)
 }
 
 
-bool detectandshow( Alpr* alpr, cv::Mat frame, std::string region, bool writeJson)
+bool detectandshow( Alpr* alpr, cv::Mat frame, std::string region, bool writeJson, PlateTracker* tracker)
 {
 
   timespec startTime;
@@ -344,12 +362,20 @@ bool detectandshow( Alpr* alpr, cv::Mat frame, std::string region, bool writeJso
   std::vector<AlprRegionOfInterest> regionsOfInterest;
   if (do_motiondetection)
   {
-	  cv::Rect rectan = motiondetector.MotionDetect(&frame);
-	  if (rectan.width>0) regionsOfInterest.push_back(AlprRegionOfInterest(rectan.x, rectan.y, rectan.width, rectan.height));
+	  Config* config = alpr->getConfig();
+	  std::vector<cv::Rect> motion = motiondetector.MotionDetectRegions(&frame, config->minPlateSizeHeightPx,
+	                                                                    cv::Size(config->minPlateSizeWidthPx, config->minPlateSizeHeightPx));
+	  for (unsigned int i = 0; i < motion.size(); i++)
+	    regionsOfInterest.push_back(AlprRegionOfInterest(motion[i].x, motion[i].y, motion[i].width, motion[i].height));
   }
   else regionsOfInterest.push_back(AlprRegionOfInterest(0, 0, frame.cols, frame.rows));
   AlprResults results;
-  if (regionsOfInterest.size()>0) results = alpr->recognize(frame.data, frame.elemSize(), frame.cols, frame.rows, regionsOfInterest);
+  std::vector<AlprPlateGroup> finishedGroups;
+  if (tracker != NULL && regionsOfInterest.size() == 0)
+    results = tracker->skipRecognition(frame, finishedGroups);
+  else if (tracker != NULL)
+    results = tracker->recognize(alpr, frame, regionsOfInterest, finishedGroups);
+  else if (regionsOfInterest.size()>0) results = alpr->recognize(frame.data, frame.elemSize(), frame.cols, frame.rows, regionsOfInterest);
 
   timespec endTime;
   getTimeMonotonic(&endTime);
@@ -358,9 +384,16 @@ bool detectandshow( Alpr* alpr, cv::Mat frame, std::string region, bool writeJso
     std::cout << "Total Time to process image: " << totalProcessingTime << "ms." << std::endl;
   
   
-  if (writeJson)
+  if (tracker != NULL)
+  {
+    // Only report plates once they have left the scene
+    printPlateGroups(finishedGroups, writeJson);
+  }
+  else if (writeJson)
   {
-    std::cout << alpr->toJson( results ) << std::endl;
+    json_buffer.clear();
+    Alpr::toJson( results, json_buffer );
+    std::cout << json_buffer << std::endl;
   }
   else
   {
@@ -394,3 +427,29 @@ bool detectandshow( Alpr* alpr, cv::Mat frame, std::string region, bool writeJso
   return results.plates.size() > 0;
 }
 
+void printPlateGroups(std::vector<AlprPlateGroup> groups, bool writeJson)
+{
+  for (unsigned int i = 0; i < groups.size(); i++)
+  {
+    if (writeJson)
+    {
+      json_buffer.clear();
+      PlateTracker::toJson(groups[i], json_buffer);
+      std::cout << json_buffer << std::endl;
+      continue;
+    }
+
+    std::cout << "group" << groups[i].track_id << ": " << groups[i].frame_count << " frames" << std::endl;
+    for (unsigned int k = 0; k < groups[i].candidates.size(); k++)
+    {
+      std::string no_newline = groups[i].candidates[k].characters;
+      std::replace(no_newline.begin(), no_newline.end(), '\n','-');
+
+      std::cout << "    - " << no_newline << "\t confidence: " << groups[i].candidates[k].overall_confidence;
+      if (templatePattern.size() > 0)
+        std::cout << "\t pattern_match: " << groups[i].candidates[k].matches_template;
+
+      std::cout << std::endl;
+    }
+  }
+}
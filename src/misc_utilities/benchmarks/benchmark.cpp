@@ -27,11 +27,18 @@
 #include <numeric>      // std::accumulate
 
 #include "alpr_impl.h"
+#include "binarize_wolf.h"
 
 #include "endtoendtest.h"
 
+#ifndef SKIP_STATE_DETECTION
+#include "../../statedetection/featurematcher.h"
+#endif
+
 #include "detection/detectorfactory.h"
 #include "ocr/ocrfactory.h"
+#include "ocr/tesseract_ocr.h"
+#include "ocr/glyph_ocr.h"
 #include "support/filesystem.h"
 
 using namespace std;
@@ -68,7 +75,7 @@ int main( int argc, const char** argv )
     printf("Use:\n\t%s [country] [benchmark name] [img input dir] [results output dir]\n",argv[0]);
     printf("\tex: %s us speed ./speed/usimages ./speed\n",argv[0]);
     printf("\n");
-    printf("\ttest names are: speed, segocr, detection\n\n" );
+    printf("\ttest names are: speed, segocr, detection, endtoend, binarize, statematch, ocrbatch, glyphocr, jsonparse\n\n" );
     return 0;
   }
 
@@ -284,6 +291,368 @@ int main( int argc, const char** argv )
     outputStats(postProcessTimes);
     cout << endl;
   }
+  else if (benchmarkName.compare("binarize") == 0)
+  {
+    // Compares the single pass binarizer against the per-threshold reference implementation.
+    // Expects a directory of plate crops.  Any pixel that differs is a bug.
+
+    timespec startTime;
+    timespec endTime;
+
+    vector<NiblackParams> params;
+    params.push_back(niblackParams(WOLFJOLION, 18, 18, 0.05));
+    params.push_back(niblackParams(WOLFJOLION, 22, 22, 0.05 + 0.35));
+    params.push_back(niblackParams(SAUVOLA, 12, 12, 0.18));
+
+    vector<double> referenceTimes;
+    vector<double> multiTimes;
+    long long totalPixels = 0;
+    long long mismatchedPixels = 0;
+
+    for (int i = 0; i< files.size(); i++)
+    {
+      if (hasEnding(files[i], ".png") || hasEnding(files[i], ".jpg"))
+      {
+        string fullpath = inDir + "/" + files[i];
+        Mat img_gray = imread( fullpath.c_str(), CV_LOAD_IMAGE_GRAYSCALE );
+
+        getTimeMonotonic(&startTime);
+        vector<Mat> reference;
+        for (unsigned int p = 0; p < params.size(); p++)
+        {
+          reference.push_back(Mat(img_gray.size(), CV_8U));
+          NiblackSauvolaWolfJolion (img_gray, reference[p], params[p].version, params[p].winx, params[p].winy, params[p].k, params[p].dR);
+          bitwise_not(reference[p], reference[p]);
+        }
+        getTimeMonotonic(&endTime);
+        referenceTimes.push_back(diffclock(startTime, endTime));
+
+        getTimeMonotonic(&startTime);
+        vector<Mat> multi;
+        NiblackSauvolaWolfJolionMulti(img_gray, multi, params, true);
+        getTimeMonotonic(&endTime);
+        multiTimes.push_back(diffclock(startTime, endTime));
+
+        int imageMismatches = 0;
+        for (unsigned int p = 0; p < params.size(); p++)
+        {
+          Mat diff;
+          compare(reference[p], multi[p], diff, CMP_NE);
+          imageMismatches += countNonZero(diff);
+          totalPixels += img_gray.rows * img_gray.cols;
+        }
+        mismatchedPixels += imageMismatches;
+
+        if (imageMismatches > 0)
+          cout << files[i] << ": " << imageMismatches << " mismatched pixels" << endl;
+      }
+    }
+
+    cout << "Reference Binarization Time Statistics:" << endl;
+    outputStats(referenceTimes);
+    cout << endl;
+
+    cout << "Single Pass Binarization Time Statistics:" << endl;
+    outputStats(multiTimes);
+    cout << endl;
+
+    cout << "Mismatched pixels: " << mismatchedPixels << " / " << totalPixels << endl;
+  }
+  else if (benchmarkName.compare("ocrbatch") == 0)
+  {
+    // Compares recognizing the characters of a plate in one OCR pass against one pass per character.
+    // Expects a directory of images with plates.  Reports every image where the best plates differ.
+
+    AlprImpl alpr(country);
+    alpr.config->setDebug(false);
+
+    vector<double> perCharacterTimes;
+    vector<double> batchTimes;
+    int differences = 0;
+
+    for (int i = 0; i< files.size(); i++)
+    {
+      if (hasEnding(files[i], ".png") || hasEnding(files[i], ".jpg"))
+      {
+        string fullpath = inDir + "/" + files[i];
+        frame = imread( fullpath.c_str() );
+
+        vector<Rect> regionsOfInterest;
+        regionsOfInterest.push_back(Rect(0, 0, frame.cols, frame.rows));
+
+        AlprResults results[2];
+        for (int batch = 0; batch < 2; batch++)
+        {
+          alpr.config->ocrBatchCharacters = (batch == 1);
+
+          timespec startTime;
+          timespec endTime;
+          getTimeMonotonic(&startTime);
+          results[batch] = alpr.recognize(frame, regionsOfInterest);
+          getTimeMonotonic(&endTime);
+
+          if (batch == 0)
+            perCharacterTimes.push_back(diffclock(startTime, endTime));
+          else
+            batchTimes.push_back(diffclock(startTime, endTime));
+        }
+
+        bool same = results[0].plates.size() == results[1].plates.size();
+        for (unsigned int p = 0; same && p < results[0].plates.size(); p++)
+          same = results[0].plates[p].bestPlate.characters == results[1].plates[p].bestPlate.characters;
+
+        if (!same)
+        {
+          differences++;
+          cout << files[i] << ":";
+          for (int batch = 0; batch < 2; batch++)
+          {
+            cout << (batch == 0 ? "  per character: " : "  batched: ");
+            for (unsigned int p = 0; p < results[batch].plates.size(); p++)
+              cout << results[batch].plates[p].bestPlate.characters << " ";
+          }
+          cout << endl;
+        }
+      }
+    }
+
+    cout << "Per Character OCR Time Statistics (end to end):" << endl;
+    outputStats(perCharacterTimes);
+    cout << endl;
+
+    cout << "Batched OCR Time Statistics (end to end):" << endl;
+    outputStats(batchTimes);
+    cout << endl;
+
+    cout << "Images with different results: " << differences << " / " << perCharacterTimes.size() << endl;
+  }
+  else if (benchmarkName.compare("glyphocr") == 0)
+  {
+    // Compares the glyph classifier OCR backend against Tesseract on the same plate regions.
+    // Expects a directory of images with plates and a trained glyph file for the country.
+
+    Config config(country);
+    config.setDebug(false);
+
+    PreWarp prewarp(&config);
+    Detector* plateDetector = createDetector(&config, &prewarp);
+
+    TesseractOcr tesseractOcr(&config);
+    GlyphOcr glyphOcr(&config);
+    if (!glyphOcr.isLoaded())
+    {
+      cout << "Unable to load glyph file " << GlyphOcr::getGlyphFile(&config) << endl;
+      return 1;
+    }
+
+    OCR* ocrs[2] = { &tesseractOcr, &glyphOcr };
+    vector<double> ocrTimes[2];
+    int plates = 0;
+    int agreements = 0;
+
+    for (int i = 0; i< files.size(); i++)
+    {
+      if (hasEnding(files[i], ".png") || hasEnding(files[i], ".jpg"))
+      {
+        string fullpath = inDir + "/" + files[i];
+        frame = imread( fullpath.c_str() );
+
+        vector<PlateRegion> regions = plateDetector->detect(frame);
+
+        for (int z = 0; z < regions.size(); z++)
+        {
+          string bestChars[2];
+          bool disqualified = false;
+
+          // Segmentation writes into the pipeline data, so each backend gets its own
+          for (int o = 0; o < 2 && !disqualified; o++)
+          {
+            PipelineData pipeline_data(frame, regions[z].rect, &config);
+            LicensePlateCandidate lp(&pipeline_data);
+            lp.recognize();
+            if (pipeline_data.disqualified)
+            {
+              disqualified = true;
+              break;
+            }
+
+            timespec startTime;
+            timespec endTime;
+            getTimeMonotonic(&startTime);
+            ocrs[o]->performOCR(&pipeline_data);
+            getTimeMonotonic(&endTime);
+            ocrTimes[o].push_back(diffclock(startTime, endTime));
+
+            ocrs[o]->postProcessor.analyze("", 25);
+            bestChars[o] = ocrs[o]->postProcessor.bestChars;
+          }
+
+          if (disqualified)
+            continue;
+
+          plates++;
+          if (bestChars[0] == bestChars[1])
+            agreements++;
+          else
+            cout << files[i] << " region " << z << ":  tesseract: " << bestChars[0] << "  glyph: " << bestChars[1] << endl;
+        }
+      }
+    }
+
+    cout << "Tesseract OCR Time Statistics:" << endl;
+    outputStats(ocrTimes[0]);
+    cout << endl;
+
+    cout << "Glyph OCR Time Statistics:" << endl;
+    outputStats(ocrTimes[1]);
+    cout << endl;
+
+    cout << "Plates with the same best result: " << agreements << " / " << plates << endl;
+  }
+  else if (benchmarkName.compare("statematch") == 0)
+  {
+#ifndef SKIP_STATE_DETECTION
+    // Compares region detection using the LSH index against the brute force matcher.
+    // Expects a directory of plate crops named [statecode]*.png, like the keypoint images.
+
+    Config config(country);
+
+    // Brute force first, then increasing LSH probe levels
+    const int NUM_MATCHERS = 4;
+    string matcherNames[NUM_MATCHERS] = { "Brute force", "LSH probe level 0", "LSH probe level 1", "LSH probe level 2" };
+    FeatureMatcher matchers[NUM_MATCHERS];
+    for (int m = 0; m < NUM_MATCHERS; m++)
+    {
+      if (m > 0)
+        matchers[m].setIndexedMatching(true, m - 1);
+      matchers[m].loadRecognitionSet(config.runtimeBaseDir, country);
+    }
+
+    vector<double> matchTimes[NUM_MATCHERS];
+    int correct[NUM_MATCHERS] = { 0, 0, 0, 0 };
+    int agreesWithBruteForce[NUM_MATCHERS] = { 0, 0, 0, 0 };
+    int total = 0;
+
+    for (int i = 0; i< files.size(); i++)
+    {
+      if (hasEnding(files[i], ".png") || hasEnding(files[i], ".jpg"))
+      {
+        string fullpath = inDir + "/" + files[i];
+        Mat img = imread( fullpath.c_str() );
+        string expected = files[i].substr(0, 2);
+        total++;
+
+        string bruteForceWinner;
+        for (int m = 0; m < NUM_MATCHERS; m++)
+        {
+          timespec startTime;
+          timespec endTime;
+          vector<int> matchesArray(matchers[m].numTrainingElements());
+
+          getTimeMonotonic(&startTime);
+          RecognitionResult result = matchers[m].recognize(img, false, NULL, false, matchesArray);
+          getTimeMonotonic(&endTime);
+          matchTimes[m].push_back(diffclock(startTime, endTime));
+
+          string winner = result.haswinner ? result.winner : "";
+          if (m == 0)
+            bruteForceWinner = winner;
+
+          if (winner == expected)
+            correct[m]++;
+          if (winner == bruteForceWinner)
+            agreesWithBruteForce[m]++;
+        }
+      }
+    }
+
+    for (int m = 0; m < NUM_MATCHERS; m++)
+    {
+      cout << matcherNames[m] << " (" << matchers[m].numTrainingElements() << " templates):" << endl;
+      outputStats(matchTimes[m]);
+      cout << "\tcorrect: " << correct[m] << " / " << total << ",  same result as brute force: " << agreesWithBruteForce[m] << " / " << total << endl;
+      cout << endl;
+    }
+#else
+    cout << "Region detection is not compiled in (WITH_STATEDETECTION is off)" << endl;
+#endif
+  }
+  else if (benchmarkName.compare("jsonparse") == 0)
+  {
+    // Benchmarks reading archived results back in.  The input dir holds .json or .jsonl files
+    // with one alpr_results document per line
+    vector<string> lines;
+    double totalBytes = 0;
+
+    for (int i = 0; i< files.size(); i++)
+    {
+      if (hasEnding(files[i], ".json") || hasEnding(files[i], ".jsonl"))
+      {
+        string fullpath = inDir + "/" + files[i];
+        ifstream infile(fullpath.c_str());
+
+        string line;
+        while (getline(infile, line))
+        {
+          if (line.length() == 0)
+            continue;
+
+          lines.push_back(line);
+          totalBytes += line.length();
+        }
+      }
+    }
+
+    if (lines.size() == 0)
+    {
+      cout << "No results found in .json or .jsonl files in " << inDir << endl;
+      return 0;
+    }
+
+    const int NUM_PASSES = 5;
+    vector<double> parserTimes;
+    vector<double> treeTimes;
+    int invalidLines = 0;
+
+    for (int pass = 0; pass < NUM_PASSES; pass++)
+    {
+      timespec startTime;
+      timespec endTime;
+
+      invalidLines = 0;
+      AlprResults results;
+      string error;
+
+      getTimeMonotonic(&startTime);
+      for (unsigned int i = 0; i < lines.size(); i++)
+      {
+        if (!AlprImpl::fromJson(lines[i], results, error))
+          invalidLines++;
+      }
+      getTimeMonotonic(&endTime);
+      parserTimes.push_back(diffclock(startTime, endTime));
+
+      // For comparison, only building and freeing the cJSON tree, without reading any fields
+      getTimeMonotonic(&startTime);
+      for (unsigned int i = 0; i < lines.size(); i++)
+        cJSON_Delete(cJSON_Parse(lines[i].c_str()));
+      getTimeMonotonic(&endTime);
+      treeTimes.push_back(diffclock(startTime, endTime));
+    }
+
+    double megabytes = totalBytes / (1024 * 1024);
+    cout << lines.size() << " results, " << megabytes << " MB, " << invalidLines << " could not be parsed" << endl;
+
+    double parserMs = std::accumulate(parserTimes.begin(), parserTimes.end(), 0.0) / parserTimes.size();
+    cout << "Results parser (per pass):" << endl;
+    outputStats(parserTimes);
+    cout << "\t" << megabytes / (parserMs / 1000) << " MB/s" << endl;
+
+    double treeMs = std::accumulate(treeTimes.begin(), treeTimes.end(), 0.0) / treeTimes.size();
+    cout << "cJSON tree only (per pass):" << endl;
+    outputStats(treeTimes);
+    cout << "\t" << megabytes / (treeMs / 1000) << " MB/s" << endl;
+  }
   else if (benchmarkName.compare("endtoend") == 0)
   {
     EndToEndTest e2eTest(inDir, outDir);
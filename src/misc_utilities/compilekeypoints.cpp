@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2015 OpenALPR Technology, Inc.
+ * Open source Automated License Plate Recognition [http://www.openalpr.com]
+ *
+ * This file is part of OpenALPR.
+ *
+ * OpenALPR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <iostream>
+
+#include "support/filesystem.h"
+#include "../tclap/CmdLine.h"
+#include "../statedetection/featurematcher.h"
+#include "alpr.h"
+
+using namespace std;
+using namespace alpr;
+
+// Computes the state detection keypoints for every image in runtime_data/keypoints/<country>/
+// and writes them to runtime_data/keypoints/<country>.kpdb.  The state detector loads that file
+// instead of the images, which avoids recomputing the keypoints every time it starts.
+
+int main( int argc, const char** argv )
+{
+  string runtimeDir;
+  string country;
+  string outputFile;
+
+  TCLAP::CmdLine cmd("OpenAlpr Keypoint Compiler", ' ', Alpr::getVersion());
+
+  TCLAP::ValueArg<std::string> runtimeDirArg("r","runtime_dir","Path to the OpenALPR runtime_data directory",true, "" ,"runtime_dir");
+  TCLAP::ValueArg<std::string> countryArg("c","country","Country code of the keypoint images to compile.  Default=us",false, "us" ,"country_code");
+  TCLAP::ValueArg<std::string> outputFileArg("o","output","Output file.  Default=<runtime_dir>/keypoints/<country>.kpdb",false, "" ,"output_file");
+
+  try
+  {
+    cmd.add( runtimeDirArg );
+    cmd.add( countryArg );
+    cmd.add( outputFileArg );
+
+    if (cmd.parse( argc, argv ) == false)
+    {
+      // Error occurred while parsing.  Exit now.
+      return 1;
+    }
+
+    runtimeDir = runtimeDirArg.getValue();
+    country = countryArg.getValue();
+    outputFile = outputFileArg.getValue();
+  }
+  catch (TCLAP::ArgException &e)    // catch any exceptions
+  {
+    std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+    return 1;
+  }
+
+  if (outputFile.empty())
+    outputFile = runtimeDir + "/keypoints/" + country + ".kpdb";
+
+  string imageDir = runtimeDir + "/keypoints/" + country + "/";
+  if (DirectoryExists(imageDir.c_str()) == false)
+  {
+    cerr << "Keypoint image directory does not exist: " << imageDir << endl;
+    return 1;
+  }
+
+  FeatureMatcher featureMatcher;
+  if (featureMatcher.loadRecognitionImages(imageDir) == false || featureMatcher.numTrainingElements() == 0)
+  {
+    cerr << "No keypoint images could be loaded from " << imageDir << endl;
+    return 1;
+  }
+
+  if (featureMatcher.saveRecognitionSet(outputFile) == false)
+  {
+    cerr << "Error writing " << outputFile << endl;
+    return 1;
+  }
+
+  // Make sure the file reads back
+  FeatureMatcher verifyMatcher;
+  if (verifyMatcher.loadCompiledRecognitionSet(outputFile, imageDir) == false ||
+      verifyMatcher.numTrainingElements() != featureMatcher.numTrainingElements())
+  {
+    cerr << "Error verifying " << outputFile << endl;
+    return 1;
+  }
+
+  cout << "Compiled " << featureMatcher.numTrainingElements() << " keypoint images into " << outputFile << endl;
+
+  return 0;
+}
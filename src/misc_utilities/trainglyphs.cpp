@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2015 OpenALPR Technology, Inc.
+ * Open source Automated License Plate Recognition [http://www.openalpr.com]
+ *
+ * This file is part of OpenALPR.
+ *
+ * OpenALPR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <stdio.h>
+
+#include "opencv2/highgui/highgui.hpp"
+#include "support/filesystem.h"
+#include "support/utf8.h"
+#include "../tclap/CmdLine.h"
+#include "ocr/glyph_classifier.h"
+
+using namespace std;
+using namespace cv;
+using namespace alpr;
+
+// Builds the glyph file used by the "glyph" OCR backend from a directory of single character
+// images, as written by openalpr-utils-classifychars.  The first character of each file name is the label
+int main( int argc, const char** argv )
+{
+  string inDir;
+  string outFile;
+
+  TCLAP::CmdLine cmd("OpenAlpr Glyph Classifier Training Utility", ' ', "1.0.0");
+
+  TCLAP::UnlabeledValueArg<std::string>  inputDirArg( "input_dir", "Folder containing individual character images", true, "", "input_dir_path"  );
+  TCLAP::UnlabeledValueArg<std::string>  outputFileArg( "output_file", "Glyph file to write (e.g., runtime_data/ocr/glyphs/lus.glyphs)", true, "", "output_file_path"  );
+
+  try
+  {
+    cmd.add( inputDirArg );
+    cmd.add( outputFileArg );
+
+    if (cmd.parse( argc, argv ) == false)
+    {
+      // Error occurred while parsing.  Exit now.
+      return 1;
+    }
+
+    inDir = inputDirArg.getValue();
+    outFile = outputFileArg.getValue();
+  }
+  catch (TCLAP::ArgException &e)    // catch any exceptions
+  {
+    std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+    return 1;
+  }
+
+  if (DirectoryExists(inDir.c_str()) == false)
+  {
+    printf("Input dir does not exist\n");
+    return 1;
+  }
+
+  vector<string> files = getFilesInDir(inDir.c_str());
+  sort( files.begin(), files.end(), stringCompare );
+
+  GlyphClassifier classifier;
+  int skipped = 0;
+
+  for (unsigned int i = 0; i < files.size(); i++)
+  {
+    if (!hasEnding(files[i], ".png") && !hasEnding(files[i], ".jpg"))
+      continue;
+
+    string::iterator utf_iterator = files[i].begin();
+    int cp = utf8::next(utf_iterator, files[i].end());
+    string charcode = utf8chr(cp);
+
+    Mat characterImg = imread(inDir + "/" + files[i], CV_LOAD_IMAGE_GRAYSCALE);
+    if (characterImg.empty() || !classifier.addGlyph(charcode, characterImg))
+    {
+      cout << "Skipping " << files[i] << endl;
+      skipped++;
+    }
+  }
+
+  if (classifier.save(outFile) == false)
+  {
+    cerr << "Unable to write " << outFile << endl;
+    return 1;
+  }
+
+  cout << "Wrote " << classifier.numGlyphs() << " glyphs to " << outFile << " (" << skipped << " images skipped)" << endl;
+
+  return 0;
+}
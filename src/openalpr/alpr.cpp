@@ -19,12 +19,30 @@
 
 #include "alpr.h"
 #include "alpr_impl.h"
+#include "json_writer.h"
 
 namespace alpr
 {
 
-  // ALPR code
+  AlprJsonField::AlprJsonField(std::string key, std::string value)
+  {
+    this->key = key;
+    JsonWriter::appendString(json_value, value);
+  }
+
+  AlprJsonField::AlprJsonField(std::string key, const char* value)
+  {
+    this->key = key;
+    JsonWriter::appendString(json_value, value);
+  }
+
+  AlprJsonField::AlprJsonField(std::string key, double value)
+  {
+    this->key = key;
+    JsonWriter::appendNumber(json_value, value);
+  }
 
+  // ALPR code
   Alpr::Alpr(const std::string country, const std::string configFile, const std::string runtimeDir)
   {
     impl = new AlprImpl(country, configFile, runtimeDir);
@@ -37,30 +55,7 @@ namespace alpr
 
   AlprResults Alpr::recognize(std::string filepath)
   {
-    
-    std::ifstream ifs(filepath.c_str(), std::ios::binary|std::ios::ate);
-    
-    if (ifs)
-      {
-      std::ifstream::pos_type pos = ifs.tellg();
-
-      std::vector<char>  buffer(pos);
-
-      ifs.seekg(0, std::ios::beg);
-      ifs.read(&buffer[0], pos);
-
-      return this->recognize( buffer );
-    }
-    else
-    {
-      std::cerr << "file does not exist: " << filepath << std::endl;
-      AlprResults emptyResults;
-      emptyResults.epoch_time = getEpochTimeMs();
-      emptyResults.img_width = 0;
-      emptyResults.img_height = 0;
-      emptyResults.total_processing_time_ms = 0;
-      return emptyResults;
-    }
+    return impl->recognize(filepath);
   }
 
   AlprResults Alpr::recognize(std::vector<char> imageBytes)
@@ -78,6 +73,16 @@ namespace alpr
     return impl->recognize(pixelData, bytesPerPixel, imgWidth, imgHeight, regionsOfInterest);
   }
 
+  std::vector<AlprResults> Alpr::recognizeBatch(std::vector<std::string> filepaths)
+  {
+    return impl->recognizeBatch(filepaths);
+  }
+
+  std::vector<AlprResults> Alpr::recognizeBatch(std::vector<std::vector<char> > imagesBytes)
+  {
+    return impl->recognizeBatch(imagesBytes);
+  }
+
   std::string Alpr::toJson( AlprResults results )
   {
     return AlprImpl::toJson(results);
@@ -87,10 +92,35 @@ namespace alpr
     return AlprImpl::toJson(result);
   }
 
+  void Alpr::toJson( const AlprResults& results, std::string& output, const std::vector<AlprJsonField>& extraFields )
+  {
+    AlprImpl::toJson(results, output, extraFields);
+  }
+
   AlprResults Alpr::fromJson(std::string json) {
     return AlprImpl::fromJson(json);
   }
 
+  bool Alpr::fromJson(const std::string& json, AlprResults& results, std::string& error)
+  {
+    return AlprImpl::fromJson(json, results, error);
+  }
+
+  AlprStatistics Alpr::getStatistics()
+  {
+    return impl->getStatistics();
+  }
+
+  void Alpr::resetStatistics()
+  {
+    impl->resetStatistics();
+  }
+
+  std::string Alpr::toJson( AlprStatistics statistics )
+  {
+    return AlprImpl::toJson(statistics);
+  }
+
   void Alpr::setCountry(std::string country) {
     impl->setCountry(country);
   }
@@ -21,6 +21,7 @@
 #define OPENALPR_ALPR_H
 
 #include <iostream>
+#include <map>
 #include <vector>
 #include <fstream> 
 #include <stdint.h>
@@ -128,8 +129,82 @@ namespace alpr
   };
 
 
+  // A caller-supplied field added to the top level of the JSON output (e.g., a UUID or camera ID).
+  // The value is encoded once, when the field is created
+  class OPENALPR_DLL_EXPORT AlprJsonField
+  {
+    public:
+      AlprJsonField(std::string key, std::string value);
+      AlprJsonField(std::string key, const char* value);
+      AlprJsonField(std::string key, double value);
+
+      std::string key;
+      std::string json_value;
+  };
+
+  // Reads newline-delimited alpr_results JSON (e.g., archived alprd output) one line at a time.
+  // Lines that can not be parsed are skipped and counted, so one damaged line does not end the stream
+  class OPENALPR_DLL_EXPORT AlprJsonLinesReader
+  {
+    public:
+      AlprJsonLinesReader(std::istream& input);
+
+      // Parses the next valid line into results.  Returns false at the end of the input
+      bool next(AlprResults& results);
+
+      int64_t lineNumber();
+      int64_t errorCount();
+      int64_t bytesRead();
+
+      // The line number and description of the most recent line that was skipped
+      std::string lastError();
+
+    private:
+      std::istream& input;
+      std::string line;
+
+      int64_t line_number;
+      int64_t error_count;
+      int64_t bytes_read;
+      std::string last_error;
+  };
+
+  // Latency of one pipeline stage, over every call since the statistics were last reset
+  struct AlprStageStatistics
+  {
+    std::string stage;
+
+    int64_t count;
+    double total_ms;
+    double mean_ms;
+    double p50_ms;
+    double p90_ms;
+    double p99_ms;
+    double max_ms;
+  };
+
+  // Always-on instrumentation for an Alpr instance.  The percentiles are read from
+  // log scale histograms and are accurate to within about 6%
+  struct AlprStatistics
+  {
+    std::vector<AlprStageStatistics> stages;
+
+    // Images, plate candidates, disqualified candidates and plates returned
+    std::map<std::string, int64_t> counters;
+
+    // How many plate candidates were dropped for each reason
+    std::map<std::string, int64_t> disqualify_reasons;
+  };
+
+
   class Config;
   class AlprImpl;
+
+  // A single Alpr instance may be shared between threads.  The recognize() functions
+  // can be called concurrently.  setCountry(), setPrewarp() and setMask() may be called at any time,
+  // setCountry() and setPrewarp() wait for the recognitions in progress to finish first.  The other setters
+  // must not be called while a recognition is in progress.  Concurrent calls share at most max_threads
+  // (or batch_threads, if larger) detector and OCR instances per country, and wait for one to be free beyond that.
   class OPENALPR_DLL_EXPORT Alpr
   {
 
@@ -161,11 +236,36 @@ namespace alpr
       // Recognize from raw pixel data.  
       AlprResults recognize(unsigned char* pixelData, int bytesPerPixel, int imgWidth, int imgHeight, std::vector<AlprRegionOfInterest> regionsOfInterest);
 
+      // Recognize a batch of images on disk.  The images are read, decoded and analyzed concurrently
+      // on batch_threads threads (see openalpr.conf), one per CPU core by default.
+      // The results are returned in the same order as the input
+      std::vector<AlprResults> recognizeBatch(std::vector<std::string> filepaths);
+
+      // Recognize a batch of encoded images (e.g., BMP, PNG, JPG, GIF etc).
+      // The results are returned in the same order as the input
+      std::vector<AlprResults> recognizeBatch(std::vector<std::vector<char> > imagesBytes);
+
 
       static std::string toJson(const AlprResults results);
       static std::string toJson(const AlprPlateResult result);
+
+      // Appends the JSON for the results to output, followed by the extra fields.  Reusing the
+      // same output string for every frame avoids allocating a new one each time
+      static void toJson(const AlprResults& results, std::string& output,
+                         const std::vector<AlprJsonField>& extraFields = std::vector<AlprJsonField>());
       static AlprResults fromJson(std::string json);
 
+      // Parses JSON produced by toJson.  Optional fields that are missing keep their defaults.
+      // Returns false, with a description of the problem in error, if the JSON is malformed,
+      // a required field is missing or a field has the wrong type
+      static bool fromJson(const std::string& json, AlprResults& results, std::string& error);
+
+      // Per-stage latencies and counters for every recognition made by this instance.
+      // Safe to call while recognitions are in progress
+      AlprStatistics getStatistics();
+      void resetStatistics();
+      static std::string toJson(const AlprStatistics statistics);
+
       bool isLoaded();
 
       static std::string getVersion();
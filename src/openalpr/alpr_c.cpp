@@ -106,6 +106,45 @@ OPENALPRC_DLL_EXPORT char* openalpr_recognize_encodedimage(OPENALPR* instance, u
 }
 
 
+OPENALPRC_DLL_EXPORT char* openalpr_recognize_encodedimage_batch(OPENALPR* instance, unsigned char** images, long long* lengths, int count)
+{
+  std::vector<std::vector<char> > images_bytes(count);
+  for (int i = 0; i < count; i++)
+    images_bytes[i].assign(images[i], images[i] + lengths[i]);
+
+  std::vector<alpr::AlprResults> results = ((alpr::Alpr*) instance)->recognizeBatch(images_bytes);
+
+  std::string json_string = "[";
+  for (unsigned int i = 0; i < results.size(); i++)
+  {
+    if (i > 0)
+      json_string += ",";
+    alpr::Alpr::toJson(results[i], json_string);
+  }
+  json_string += "]";
+
+  char* result_obj = strdup(json_string.c_str());
+
+  return result_obj;
+}
+
+
+OPENALPRC_DLL_EXPORT char* openalpr_get_statistics(OPENALPR* instance)
+{
+  alpr::AlprStatistics statistics = ((alpr::Alpr*) instance)->getStatistics();
+  std::string json_string = alpr::Alpr::toJson(statistics);
+
+  char* result_obj = strdup(json_string.c_str());
+
+  return result_obj;
+}
+
+OPENALPRC_DLL_EXPORT void openalpr_reset_statistics(OPENALPR* instance)
+{
+  ((alpr::Alpr*) instance)->resetStatistics();
+}
+
+
 OPENALPRC_DLL_EXPORT void openalpr_free_response_string(char* response)
 {
   free(response);
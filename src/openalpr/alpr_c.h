@@ -68,6 +68,17 @@ char* openalpr_recognize_rawimage(OPENALPR* instance, unsigned char* pixelData,
 // Recognizes the encoded (e.g., JPEG, PNG) image.  bytes are the raw bytes for the image data.
 char* openalpr_recognize_encodedimage(OPENALPR* instance, unsigned char* bytes, long long length, struct AlprCRegionOfInterest roi);
 
+// Recognizes a batch of encoded images concurrently.  images and lengths each hold count entries.
+// Responds with a JSON array holding one result object per image, in the same order as the input
+// Caller must call free() on the returned object
+char* openalpr_recognize_encodedimage_batch(OPENALPR* instance, unsigned char** images, long long* lengths, int count);
+
+// Responds with JSON holding the per-stage latencies (count, mean, p50, p90, p99, max) and counters
+// for every recognition made by this instance since it was created or last reset
+// Caller must call free() on the returned object
+char* openalpr_get_statistics(OPENALPR* instance);
+void openalpr_reset_statistics(OPENALPR* instance);
+
 // Frees a char* response that was provided from a recognition request.
 // This is required for interoperating with managed languages (e.g., C#) that can't free the memory themselves
 void openalpr_free_response_string(char* response);
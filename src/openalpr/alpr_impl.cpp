@@ -22,6 +22,9 @@
 
 
 void plateAnalysisThread(void* arg);
+void sharedPlateAnalysisThread(void* arg);
+void analysisIterationThread(void* arg);
+void batchRecognitionThread(void* arg);
 
 using namespace std;
 using namespace cv;
@@ -35,8 +38,14 @@ namespace alpr
     getTimeMonotonic(&startTime);
     
     config = new Config(country, configFile, runtimeDir);
+    config->statistics = &statistics;
 
     prewarp = ALPR_NULL_PTR;
+    workerPool = ALPR_NULL_PTR;
+    batchPool = ALPR_NULL_PTR;
+    activeRecognitions = 0;
+    engineUpdating = false;
+    maskVersion = 0;
 
     
     // Config file or runtime dir not found.  Don't process any further.
@@ -46,6 +55,15 @@ namespace alpr
     }
 
     prewarp = new PreWarp(config);
+    workerPool = new WorkerPool(config->maxThreads);
+
+    batchThreads = config->batchThreads;
+    if (batchThreads <= 0)
+      batchThreads = tthread::thread::hardware_concurrency();
+    if (batchThreads <= 0)
+      batchThreads = 1;
+
+    recognizerInstanceLimit = max(workerPool->getNumThreads(), batchThreads);
     
     loadRecognizers();
 
@@ -69,11 +87,19 @@ namespace alpr
     typedef std::map<std::string, AlprRecognizers>::iterator it_type;
     for(it_type iterator = recognizers.begin(); iterator != recognizers.end(); iterator++) {
 
-      delete iterator->second.plateDetector;
       delete iterator->second.stateDetector;
-      delete iterator->second.ocr;
+
+      // The primary detector and OCR instances live in the idle pools along with any extra instances
+      for (unsigned int i = 0; i < iterator->second.idleDetectors.size(); i++)
+        delete iterator->second.idleDetectors[i];
+      for (unsigned int i = 0; i < iterator->second.idleOcrs.size(); i++)
+        delete iterator->second.idleOcrs[i];
+
+      delete iterator->second.config;
     }
 
+    delete batchPool;
+    delete workerPool;
     delete prewarp;
   }
 
@@ -112,39 +138,69 @@ namespace alpr
       return response;
     }
 
+    // Pick up any changes made to the engine config since the last call.  They can not
+    // change again until this call is done
+    RecognitionScope recognition(this);
+
     // Convert image to grayscale if required
     Mat grayImg = img;
     if (img.channels() > 2)
       cvtColor( img, grayImg, CV_BGR2GRAY );
     
-    // Prewarp the image and ROIs if configured]
+    // Prewarp the image and ROIs if configured.  The copy keeps the transform
+    // for this image private to this call
+    PreWarp call_prewarp(*prewarp);
     std::vector<cv::Rect> warpedRegionsOfInterest = regionsOfInterest;
     // Warp the image if prewarp is provided
-    grayImg = prewarp->warpImage(grayImg);
-    warpedRegionsOfInterest = prewarp->projectRects(regionsOfInterest, grayImg.cols, grayImg.rows, false);
+    grayImg = call_prewarp.warpImage(grayImg);
+    warpedRegionsOfInterest = call_prewarp.projectRects(regionsOfInterest, grayImg.cols, grayImg.rows, false);
 
-    // Iterate through each country provided (typically just one)
-    // and aggregate the results if necessary
-    ResultAggregator country_aggregator(MERGE_PICK_BEST, topN, config);
+    vector<RecognitionContext> contexts(config->loaded_countries.size());
     for (unsigned int i = 0; i < config->loaded_countries.size(); i++)
     {
-      if (config->debugGeneral)
-        cout << "Analyzing: " << config->loaded_countries[i] << endl;
+      contexts[i].recognizers = &recognizers.find(config->loaded_countries[i])->second;
+      contexts[i].config = contexts[i].recognizers->config;
+      contexts[i].prewarp = &call_prewarp;
+      contexts[i].topN = topN;
+      contexts[i].detectRegion = detectRegion;
+      contexts[i].defaultRegion = defaultRegion;
+    }
 
-      config->setCountry(config->loaded_countries[i]);
-      
-      // Reapply analysis for each multiple analysis value set in the config,
-      // make a minor imperceptible tweak to the input image each time
-      ResultAggregator iter_aggregator(MERGE_COMBINE, topN, config);
-      for (unsigned int iteration = 0; iteration < config->analysis_count; iteration++)
+    // Reapply analysis for each multiple analysis value set in the config,
+    // make a minor imperceptible tweak to the input image each time
+    vector<ResultAggregator*> iter_aggregators;
+    for (unsigned int i = 0; i < contexts.size(); i++)
+      iter_aggregators.push_back(new ResultAggregator(MERGE_COMBINE, topN, contexts[i].config));
+
+    if (config->sharedCountryAnalysis && contexts.size() > 1)
+    {
+      // Detect and analyze the plate candidates once, and let every country read the text
+      vector<RecognitionContext*> context_ptrs;
+      for (unsigned int i = 0; i < contexts.size(); i++)
+        context_ptrs.push_back(&contexts[i]);
+
+      runAnalysisIterations(context_ptrs, img, grayImg, warpedRegionsOfInterest, iter_aggregators);
+    }
+    else
+    {
+      // Iterate through each country provided (typically just one)
+      for (unsigned int i = 0; i < contexts.size(); i++)
       {
-        Mat iteration_image = iter_aggregator.applyImperceptibleChange(grayImg, iteration);
-        //drawAndWait(iteration_image);
-        AlprFullDetails iter_results = analyzeSingleCountry(img, iteration_image, warpedRegionsOfInterest);
-        iter_aggregator.addResults(iter_results);
+        if (config->debugGeneral)
+          cout << "Analyzing: " << config->loaded_countries[i] << endl;
+
+        vector<RecognitionContext*> context_ptrs(1, &contexts[i]);
+        vector<ResultAggregator*> country_iter_aggregators(1, iter_aggregators[i]);
+        runAnalysisIterations(context_ptrs, img, grayImg, warpedRegionsOfInterest, country_iter_aggregators);
       }
-      
-      AlprFullDetails sub_results = iter_aggregator.getAggregateResults();
+    }
+
+    // Aggregate the results of each country if necessary
+    ResultAggregator country_aggregator(MERGE_PICK_BEST, topN, config);
+    for (unsigned int i = 0; i < contexts.size(); i++)
+    {
+      AlprFullDetails sub_results = iter_aggregators[i]->getAggregateResults();
+      delete iter_aggregators[i];
       sub_results.results.epoch_time = start_time;
       sub_results.results.img_width = img.cols;
       sub_results.results.img_height = img.rows;
@@ -156,6 +212,9 @@ namespace alpr
 
     timespec endTime;
     getTimeMonotonic(&endTime);
+    statistics.recordStage(STAGE_TOTAL, diffclock(startTime, endTime));
+    statistics.increment(COUNTER_IMAGES);
+    statistics.increment(COUNTER_PLATES_FOUND, response.results.plates.size());
     if (config->debugTiming)
     {
       cout << "Total Time to process image: " << diffclock(startTime, endTime) << "ms." << endl;
@@ -214,11 +273,12 @@ namespace alpr
     return response;
   }
 
-  AlprFullDetails AlprImpl::analyzeSingleCountry(cv::Mat colorImg, cv::Mat grayImg, std::vector<cv::Rect> warpedRegionsOfInterest)
+  AlprFullDetails AlprImpl::analyzeSingleCountry(RecognitionContext* context, cv::Mat colorImg, cv::Mat grayImg, std::vector<cv::Rect> warpedRegionsOfInterest)
   {
     AlprFullDetails response;
     
-    AlprRecognizers country_recognizers = recognizers[config->country];
+    Config* config = context->config;
+    AlprRecognizers* country_recognizers = context->recognizers;
     timespec startTime;
     getTimeMonotonic(&startTime);
 
@@ -226,7 +286,9 @@ namespace alpr
     // Find all the candidate regions
     if (config->skipDetection == false)
     {
-      warpedPlateRegions = country_recognizers.plateDetector->detect(grayImg, warpedRegionsOfInterest);
+      Detector* plateDetector = checkoutDetector(country_recognizers);
+      warpedPlateRegions = plateDetector->detect(grayImg, warpedRegionsOfInterest);
+      returnDetector(country_recognizers, plateDetector);
     }
     else
     {
@@ -240,170 +302,593 @@ namespace alpr
       }
     }
 
-    queue<PlateRegion> plateQueue;
-    for (unsigned int i = 0; i < warpedPlateRegions.size(); i++)
-      plateQueue.push(warpedPlateRegions[i]);
+    // Analyze the regions in waves.  Every region in a wave is independent, so they are
+    // fanned out to the worker pool.  Regions that do not produce a plate send their children
+    // into the next wave, which preserves the order of a first-in-first-out queue.
+    vector<PlateRegion> plateWave = warpedPlateRegions;
 
     int platecount = 0;
-    while(!plateQueue.empty())
+    while (!plateWave.empty())
     {
-      PlateRegion plateRegion = plateQueue.front();
-      plateQueue.pop();
+      vector<PlateAnalysisJob> jobs(plateWave.size());
+      vector<void*> jobArgs;
+      for (unsigned int i = 0; i < plateWave.size(); i++)
+      {
+        jobs[i].alpr = this;
+        jobs[i].context = context;
+        jobs[i].colorImg = colorImg;
+        jobs[i].grayImg = grayImg;
+        jobs[i].plateRegion = plateWave[i];
+        jobs[i].plateDetected = false;
+        jobArgs.push_back(&jobs[i]);
+      }
 
-      PipelineData pipeline_data(colorImg, grayImg, plateRegion.rect, config);
-      pipeline_data.prewarp = prewarp;
+      // Debug windows must be drawn from a single thread
+      if (config->debugShowImages)
+      {
+        for (unsigned int i = 0; i < jobArgs.size(); i++)
+          plateAnalysisThread(jobArgs[i]);
+      }
+      else
+      {
+        workerPool->run(plateAnalysisThread, jobArgs);
+      }
+
+      vector<PlateRegion> nextWave;
+      for (unsigned int i = 0; i < jobs.size(); i++)
+      {
+        if (jobs[i].plateDetected)
+        {
+          jobs[i].plateResult.plate_index = platecount++;
+          response.results.plates.push_back(jobs[i].plateResult);
+        }
+        else
+        {
+          // Not a valid plate
+          // Check if this plate has any children, if so, send them back up for processing
+          for (unsigned int childidx = 0; childidx < jobs[i].plateRegion.children.size(); childidx++)
+          {
+            nextWave.push_back(jobs[i].plateRegion.children[childidx]);
+          }
+        }
+      }
+
+      plateWave = nextWave;
+    }
+
+    // Unwarp plate regions if necessary
+    context->prewarp->projectPlateRegions(warpedPlateRegions, grayImg.cols, grayImg.rows, true);
+    response.plateRegions = warpedPlateRegions;
+
+    timespec endTime;
+    getTimeMonotonic(&endTime);
+    response.results.total_processing_time_ms = diffclock(startTime, endTime);
 
-      timespec platestarttime;
-      getTimeMonotonic(&platestarttime);
+    return response;
+  }
 
-      LicensePlateCandidate lp(&pipeline_data);
+  void AlprImpl::runAnalysisIterations(std::vector<RecognitionContext*>& contexts, cv::Mat colorImg, cv::Mat grayImg,
+                                       std::vector<cv::Rect> warpedRegionsOfInterest, std::vector<ResultAggregator*>& aggregators)
+  {
+    Config* config = contexts[0]->config;
 
-      lp.recognize();
+    // The iterations are independent, so they run concurrently.  With an early exit policy
+    // the first few run on their own, and the rest are skipped if those agree
+    int totalIterations = config->analysis_count;
+    int firstIterations = totalIterations;
+    if (config->analysisEarlyExitCount > 0 && config->analysisEarlyExitCount < totalIterations)
+      firstIterations = config->analysisEarlyExitCount;
 
-      bool plateDetected = false;
-      if (pipeline_data.disqualified && config->debugGeneral)
+    int completed = 0;
+    while (completed < totalIterations)
+    {
+      int batchEnd = (completed == 0) ? firstIterations : totalIterations;
+
+      vector<AnalysisIterationJob> jobs(batchEnd - completed);
+      vector<void*> jobArgs;
+      for (unsigned int i = 0; i < jobs.size(); i++)
       {
-        cout << "Disqualify reason: " << pipeline_data.disqualify_reason << endl;
+        jobs[i].alpr = this;
+        jobs[i].contexts = &contexts;
+        jobs[i].aggregator = aggregators[0];
+        jobs[i].colorImg = colorImg;
+        jobs[i].grayImg = grayImg;
+        jobs[i].regionsOfInterest = warpedRegionsOfInterest;
+        jobs[i].iteration = completed + i;
+        jobArgs.push_back(&jobs[i]);
       }
-      if (!pipeline_data.disqualified)
-      {
-        AlprPlateResult plateResult;
-        
-        plateResult.country = config->country;
-        
-        // If there's only one pattern for a country, use it.  Otherwise use the default
-        if (country_recognizers.ocr->postProcessor.getPatterns().size() == 1)
-          plateResult.region = country_recognizers.ocr->postProcessor.getPatterns()[0];
-        else
-          plateResult.region = defaultRegion;
-        
-        plateResult.regionConfidence = 0;
-        plateResult.plate_index = platecount++;
-        plateResult.requested_topn = topN;
 
-        // If using prewarp, remap the plate corners to the original image
-        vector<Point2f> cornerPoints = pipeline_data.plate_corners;
-        cornerPoints = prewarp->projectPoints(cornerPoints, true);
+      // Debug windows must be drawn from a single thread
+      if (config->debugShowImages)
+      {
+        for (unsigned int i = 0; i < jobArgs.size(); i++)
+          analysisIterationThread(jobArgs[i]);
+      }
+      else
+      {
+        workerPool->run(analysisIterationThread, jobArgs);
+      }
 
-        for (int pointidx = 0; pointidx < 4; pointidx++)
+      bool platesFound = false;
+      for (unsigned int i = 0; i < jobs.size(); i++)
+      {
+        for (unsigned int c = 0; c < aggregators.size(); c++)
         {
-          plateResult.plate_points[pointidx].x = (int) cornerPoints[pointidx].x;
-          plateResult.plate_points[pointidx].y = (int) cornerPoints[pointidx].y;
+          platesFound = platesFound || jobs[i].results[c].results.plates.size() > 0;
+          aggregators[c]->addResults(jobs[i].results[c]);
         }
+      }
 
-        
-        #ifndef SKIP_STATE_DETECTION
-        if (detectRegion && country_recognizers.stateDetector->isLoaded())
-        {
-          std::vector<StateCandidate> state_candidates = country_recognizers.stateDetector->detect(pipeline_data.color_deskewed.data,
-                                                                               pipeline_data.color_deskewed.elemSize(),
-                                                                               pipeline_data.color_deskewed.cols,
-                                                                               pipeline_data.color_deskewed.rows);
+      completed = batchEnd;
 
-          if (state_candidates.size() > 0)
-          {
-            plateResult.region = state_candidates[0].state_code;
-            plateResult.regionConfidence = (int) state_candidates[0].confidence;
-          }
-        }
-        #endif
+      if (completed < totalIterations && platesFound)
+      {
+        bool agree = true;
+        for (unsigned int c = 0; c < aggregators.size(); c++)
+          agree = agree && aggregators[c]->resultsAgree(completed, config->analysisEarlyExitConfidence);
 
-        if (plateResult.region.length() > 0 && country_recognizers.ocr->postProcessor.regionIsValid(plateResult.region) == false)
+        if (agree)
         {
-          std::cerr << "Invalid pattern provided: " << plateResult.region << std::endl;
-          std::cerr << "Valid patterns are located in the " << config->country << ".patterns file" << std::endl;
+          if (config->debugGeneral)
+            cout << "First " << completed << " analysis iterations agree, skipping the remaining " << (totalIterations - completed) << endl;
+          break;
         }
+      }
+    }
+  }
+
+  void AlprImpl::analyzeIteration(AnalysisIterationJob* job)
+  {
+    Mat iteration_image = job->aggregator->applyImperceptibleChange(job->grayImg, job->iteration);
+    //drawAndWait(iteration_image);
 
-        country_recognizers.ocr->performOCR(&pipeline_data);
-        country_recognizers.ocr->postProcessor.analyze(plateResult.region, topN);
+    if (job->contexts->size() == 1)
+      job->results.push_back(analyzeSingleCountry((*job->contexts)[0], job->colorImg, iteration_image, job->regionsOfInterest));
+    else
+      job->results = analyzeMultiCountry(*job->contexts, job->colorImg, iteration_image, job->regionsOfInterest);
+  }
 
-        timespec resultsStartTime;
-        getTimeMonotonic(&resultsStartTime);
+  std::vector<AlprFullDetails> AlprImpl::analyzeMultiCountry(std::vector<RecognitionContext*>& contexts, cv::Mat colorImg, cv::Mat grayImg, std::vector<cv::Rect> warpedRegionsOfInterest)
+  {
+    vector<AlprFullDetails> responses(contexts.size());
+    Config* config = contexts[0]->config;
 
-        const vector<PPResult> ppResults = country_recognizers.ocr->postProcessor.getResults();
+    timespec startTime;
+    getTimeMonotonic(&startTime);
 
-        int bestPlateIndex = 0;
+    // Each country has its own cascade.  A region found by several of them is only kept
+    // for the first country that found it, which then owns its analysis
+    vector<PlateRegion> warpedPlateRegions;
+    vector<int> regionOwners;
+    if (config->skipDetection == false)
+    {
+      for (unsigned int i = 0; i < contexts.size(); i++)
+      {
+        Detector* plateDetector = checkoutDetector(contexts[i]->recognizers);
+        vector<PlateRegion> countryRegions = plateDetector->detect(grayImg, warpedRegionsOfInterest);
+        returnDetector(contexts[i]->recognizers, plateDetector);
 
-        cv::Mat charTransformMatrix = getCharacterTransformMatrix(&pipeline_data);
-        bool isBestPlateSelected = false;
-        for (unsigned int pp = 0; pp < ppResults.size(); pp++)
+        for (unsigned int r = 0; r < countryRegions.size(); r++)
         {
-
-          // Set our "best plate" match to either the first entry, or the first entry with a postprocessor template match
-          if (isBestPlateSelected == false && ppResults[pp].matchesTemplate){
-            bestPlateIndex = plateResult.topNPlates.size();
-            isBestPlateSelected = true;
+          bool duplicate = false;
+          for (unsigned int k = 0; k < warpedPlateRegions.size() && !duplicate; k++)
+          {
+            Rect intersection = countryRegions[r].rect & warpedPlateRegions[k].rect;
+            Rect smaller = countryRegions[r].rect.area() < warpedPlateRegions[k].rect.area() ? countryRegions[r].rect : warpedPlateRegions[k].rect;
+            duplicate = intersection.area() > smaller.area() * 0.8;
           }
 
-          AlprPlate aplate;
-          aplate.characters = ppResults[pp].letters;
-          aplate.overall_confidence = ppResults[pp].totalscore;
-          aplate.matches_template = ppResults[pp].matchesTemplate;
-
-          // Grab detailed results for each character
-          for (unsigned int c_idx = 0; c_idx < ppResults[pp].letter_details.size(); c_idx++)
+          if (!duplicate)
           {
-            AlprChar character_details;
-            Letter l = ppResults[pp].letter_details[c_idx];
-            
-            character_details.character = l.letter;
-            character_details.confidence = l.totalscore;
-            cv::Rect char_rect = pipeline_data.charRegionsFlat[l.charposition];
-            std::vector<AlprCoordinate> charpoints = getCharacterPoints(char_rect, charTransformMatrix );
-            for (int cpt = 0; cpt < 4; cpt++)
-              character_details.corners[cpt] = charpoints[cpt];
-            aplate.character_details.push_back(character_details);
+            warpedPlateRegions.push_back(countryRegions[r]);
+            regionOwners.push_back(i);
           }
-          plateResult.topNPlates.push_back(aplate);
         }
+      }
+    }
+    else
+    {
+      for (unsigned int i = 0; i < warpedRegionsOfInterest.size(); i++)
+      {
+        PlateRegion pr;
+        pr.rect = cv::Rect(warpedRegionsOfInterest[i]);
+        warpedPlateRegions.push_back(pr);
+        regionOwners.push_back(0);
+      }
+    }
 
-        if (plateResult.topNPlates.size() > bestPlateIndex)
-        {
-          AlprPlate bestPlate;
-          bestPlate.characters = plateResult.topNPlates[bestPlateIndex].characters;
-          bestPlate.matches_template = plateResult.topNPlates[bestPlateIndex].matches_template;
-          bestPlate.overall_confidence = plateResult.topNPlates[bestPlateIndex].overall_confidence;
-          bestPlate.character_details = plateResult.topNPlates[bestPlateIndex].character_details;
+    // Same wave processing as analyzeSingleCountry.  A region's children are only
+    // analyzed when no country could read a plate from the region itself
+    vector<PlateRegion> plateWave = warpedPlateRegions;
+    vector<int> waveOwners = regionOwners;
 
-          plateResult.bestPlate = bestPlate;
-        }
+    vector<int> platecounts(contexts.size(), 0);
+    while (!plateWave.empty())
+    {
+      vector<SharedPlateAnalysisJob> jobs(plateWave.size());
+      vector<void*> jobArgs;
+      for (unsigned int i = 0; i < plateWave.size(); i++)
+      {
+        jobs[i].alpr = this;
+        jobs[i].contexts = &contexts;
+        jobs[i].ownerIndex = waveOwners[i];
+        jobs[i].colorImg = colorImg;
+        jobs[i].grayImg = grayImg;
+        jobs[i].plateRegion = plateWave[i];
+        jobArgs.push_back(&jobs[i]);
+      }
 
-        timespec plateEndTime;
-        getTimeMonotonic(&plateEndTime);
-        plateResult.processing_time_ms = diffclock(platestarttime, plateEndTime);
-        if (config->debugTiming)
-        {
-          cout << "Result Generation Time: " << diffclock(resultsStartTime, plateEndTime) << "ms." << endl;
-        }
+      // Debug windows must be drawn from a single thread
+      if (config->debugShowImages)
+      {
+        for (unsigned int i = 0; i < jobArgs.size(); i++)
+          sharedPlateAnalysisThread(jobArgs[i]);
+      }
+      else
+      {
+        workerPool->run(sharedPlateAnalysisThread, jobArgs);
+      }
 
-        if (plateResult.topNPlates.size() > 0)
+      vector<PlateRegion> nextWave;
+      vector<int> nextOwners;
+      for (unsigned int i = 0; i < jobs.size(); i++)
+      {
+        bool anyDetected = false;
+        for (unsigned int c = 0; c < jobs[i].plateDetected.size(); c++)
         {
-          plateDetected = true;
-          response.results.plates.push_back(plateResult);
+          if (jobs[i].plateDetected[c])
+          {
+            jobs[i].plateResults[c].plate_index = platecounts[c]++;
+            responses[c].results.plates.push_back(jobs[i].plateResults[c]);
+            anyDetected = true;
+          }
         }
-      }
 
-      if (!plateDetected)
-      {
-        // Not a valid plate
-        // Check if this plate has any children, if so, send them back up for processing
-        for (unsigned int childidx = 0; childidx < plateRegion.children.size(); childidx++)
+        if (!anyDetected)
         {
-          plateQueue.push(plateRegion.children[childidx]);
+          for (unsigned int childidx = 0; childidx < jobs[i].plateRegion.children.size(); childidx++)
+          {
+            nextWave.push_back(jobs[i].plateRegion.children[childidx]);
+            nextOwners.push_back(jobs[i].ownerIndex);
+          }
         }
       }
 
+      plateWave = nextWave;
+      waveOwners = nextOwners;
     }
 
-    // Unwarp plate regions if necessary
-    prewarp->projectPlateRegions(warpedPlateRegions, grayImg.cols, grayImg.rows, true);
-    response.plateRegions = warpedPlateRegions;
+    // Unwarp plate regions if necessary.  They are only reported once, with the first country
+    contexts[0]->prewarp->projectPlateRegions(warpedPlateRegions, grayImg.cols, grayImg.rows, true);
+    responses[0].plateRegions = warpedPlateRegions;
 
     timespec endTime;
     getTimeMonotonic(&endTime);
-    response.results.total_processing_time_ms = diffclock(startTime, endTime);
+    for (unsigned int i = 0; i < responses.size(); i++)
+      responses[i].results.total_processing_time_ms = diffclock(startTime, endTime);
 
-    return response;
+    return responses;
+  }
+
+  void AlprImpl::analyzePlate(PlateAnalysisJob* job)
+  {
+    RecognitionContext* context = job->context;
+    Config* config = context->config;
+
+    PipelineData pipeline_data(job->colorImg, job->grayImg, job->plateRegion.rect, config);
+    pipeline_data.prewarp = context->prewarp;
+
+    timespec platestarttime;
+    getTimeMonotonic(&platestarttime);
+
+    LicensePlateCandidate lp(&pipeline_data);
+
+    lp.recognize();
+
+    statistics.increment(COUNTER_PLATE_CANDIDATES);
+
+    job->plateDetected = false;
+    if (pipeline_data.disqualified && config->debugGeneral)
+    {
+      cout << "Disqualify reason: " << pipeline_data.disqualify_reason << endl;
+    }
+    if (pipeline_data.disqualified)
+    {
+      statistics.recordDisqualified(pipeline_data.disqualify_reason);
+      return;
+    }
+
+    job->plateDetected = recognizePlateText(context, &pipeline_data, platestarttime, job->plateResult);
+  }
+
+  void AlprImpl::analyzeSharedPlate(SharedPlateAnalysisJob* job)
+  {
+    RecognitionContext* owner = (*job->contexts)[job->ownerIndex];
+
+    PipelineData pipeline_data(job->colorImg, job->grayImg, job->plateRegion.rect, owner->config);
+    pipeline_data.prewarp = owner->prewarp;
+
+    timespec platestarttime;
+    getTimeMonotonic(&platestarttime);
+
+    // Character analysis, edge finding and the deskew run once, with the settings of the
+    // country whose detector found the region
+    LicensePlateCandidate lp(&pipeline_data);
+
+    lp.recognize();
+
+    statistics.increment(COUNTER_PLATE_CANDIDATES);
+
+    job->plateDetected.assign(job->contexts->size(), false);
+    job->plateResults.resize(job->contexts->size());
+    if (pipeline_data.disqualified && owner->config->debugGeneral)
+    {
+      cout << "Disqualify reason: " << pipeline_data.disqualify_reason << endl;
+    }
+    if (pipeline_data.disqualified)
+    {
+      statistics.recordDisqualified(pipeline_data.disqualify_reason);
+      return;
+    }
+
+    // The segmentation thresholds only depend on the deskewed crop, so every country reuses one set
+    Mat segmentation_crop;
+    if (pipeline_data.plate_inverted)
+      bitwise_not(pipeline_data.crop_gray, segmentation_crop);
+    else
+      segmentation_crop = pipeline_data.crop_gray;
+    pipeline_data.sharedThresholds = produceThresholds(segmentation_crop, owner->config);
+
+    for (unsigned int i = 0; i < job->contexts->size(); i++)
+    {
+      PipelineData country_data = pipeline_data;
+      country_data.config = (*job->contexts)[i]->config;
+      country_data.prewarp = (*job->contexts)[i]->prewarp;
+
+      // The segmenter inverts and blurs the crop in place
+      country_data.crop_gray = pipeline_data.crop_gray.clone();
+
+      job->plateDetected[i] = recognizePlateText((*job->contexts)[i], &country_data, platestarttime, job->plateResults[i]);
+    }
+  }
+
+  bool AlprImpl::recognizePlateText(RecognitionContext* context, PipelineData* pipeline_data, timespec platestarttime, AlprPlateResult& plateResult)
+  {
+    Config* config = context->config;
+    AlprRecognizers* country_recognizers = context->recognizers;
+
+    plateResult.country = config->country;
+
+    // If there's only one pattern for a country, use it.  Otherwise use the default
+    if (country_recognizers->ocr->postProcessor.getPatterns().size() == 1)
+      plateResult.region = country_recognizers->ocr->postProcessor.getPatterns()[0];
+    else
+      plateResult.region = context->defaultRegion;
+
+    plateResult.regionConfidence = 0;
+    plateResult.requested_topn = context->topN;
+
+    // If using prewarp, remap the plate corners to the original image
+    vector<Point2f> cornerPoints = pipeline_data->plate_corners;
+    cornerPoints = context->prewarp->projectPoints(cornerPoints, true);
+
+    for (int pointidx = 0; pointidx < 4; pointidx++)
+    {
+      plateResult.plate_points[pointidx].x = (int) cornerPoints[pointidx].x;
+      plateResult.plate_points[pointidx].y = (int) cornerPoints[pointidx].y;
+    }
+
+
+    #ifndef SKIP_STATE_DETECTION
+    if (context->detectRegion && country_recognizers->stateDetector->isLoaded())
+    {
+      // The feature matcher keeps per-image state, only one plate may use it at a time
+      tthread::lock_guard<tthread::mutex> guard(stateDetectorMutex);
+
+      timespec stateStartTime;
+      getTimeMonotonic(&stateStartTime);
+
+      std::vector<StateCandidate> state_candidates = country_recognizers->stateDetector->detect(pipeline_data->color_deskewed.data,
+                                                                           pipeline_data->color_deskewed.elemSize(),
+                                                                           pipeline_data->color_deskewed.cols,
+                                                                           pipeline_data->color_deskewed.rows);
+
+      timespec stateEndTime;
+      getTimeMonotonic(&stateEndTime);
+      statistics.recordStage(STAGE_STATE_ID, diffclock(stateStartTime, stateEndTime));
+
+      if (state_candidates.size() > 0)
+      {
+        plateResult.region = state_candidates[0].state_code;
+        plateResult.regionConfidence = (int) state_candidates[0].confidence;
+      }
+    }
+    #endif
+
+    if (plateResult.region.length() > 0 && country_recognizers->ocr->postProcessor.regionIsValid(plateResult.region) == false)
+    {
+      std::cerr << "Invalid pattern provided: " << plateResult.region << std::endl;
+      std::cerr << "Valid patterns are located in the " << config->country << ".patterns file" << std::endl;
+    }
+
+    OCR* ocr = checkoutOcr(country_recognizers);
+    ocr->performOCR(pipeline_data);
+    ocr->postProcessor.analyze(plateResult.region, context->topN);
+
+    timespec resultsStartTime;
+    getTimeMonotonic(&resultsStartTime);
+
+    const vector<PPResult> ppResults = ocr->postProcessor.getResults();
+    returnOcr(country_recognizers, ocr);
+
+    int bestPlateIndex = 0;
+
+    cv::Mat charTransformMatrix = getCharacterTransformMatrix(pipeline_data);
+    bool isBestPlateSelected = false;
+    for (unsigned int pp = 0; pp < ppResults.size(); pp++)
+    {
+
+      // Set our "best plate" match to either the first entry, or the first entry with a postprocessor template match
+      if (isBestPlateSelected == false && ppResults[pp].matchesTemplate){
+        bestPlateIndex = plateResult.topNPlates.size();
+        isBestPlateSelected = true;
+      }
+
+      AlprPlate aplate;
+      aplate.characters = ppResults[pp].letters;
+      aplate.overall_confidence = ppResults[pp].totalscore;
+      aplate.matches_template = ppResults[pp].matchesTemplate;
+
+      // Grab detailed results for each character
+      for (unsigned int c_idx = 0; c_idx < ppResults[pp].letter_details.size(); c_idx++)
+      {
+        AlprChar character_details;
+        Letter l = ppResults[pp].letter_details[c_idx];
+
+        character_details.character = l.letter;
+        character_details.confidence = l.totalscore;
+        cv::Rect char_rect = pipeline_data->charRegionsFlat[l.charposition];
+        std::vector<AlprCoordinate> charpoints = getCharacterPoints(char_rect, charTransformMatrix, context->prewarp);
+        for (int cpt = 0; cpt < 4; cpt++)
+          character_details.corners[cpt] = charpoints[cpt];
+        aplate.character_details.push_back(character_details);
+      }
+      plateResult.topNPlates.push_back(aplate);
+    }
+
+    if (plateResult.topNPlates.size() > bestPlateIndex)
+    {
+      AlprPlate bestPlate;
+      bestPlate.characters = plateResult.topNPlates[bestPlateIndex].characters;
+      bestPlate.matches_template = plateResult.topNPlates[bestPlateIndex].matches_template;
+      bestPlate.overall_confidence = plateResult.topNPlates[bestPlateIndex].overall_confidence;
+      bestPlate.character_details = plateResult.topNPlates[bestPlateIndex].character_details;
+
+      plateResult.bestPlate = bestPlate;
+    }
+
+    timespec plateEndTime;
+    getTimeMonotonic(&plateEndTime);
+    plateResult.processing_time_ms = diffclock(platestarttime, plateEndTime);
+    if (config->debugTiming)
+    {
+      cout << "Result Generation Time: " << diffclock(resultsStartTime, plateEndTime) << "ms." << endl;
+    }
+
+    return plateResult.topNPlates.size() > 0;
+  }
+
+  Detector* AlprImpl::checkoutDetector(AlprRecognizers* country_recognizers)
+  {
+    Detector* detector = NULL;
+    cv::Mat detector_mask;
+    unsigned int detector_mask_version;
+    {
+      tthread::lock_guard<tthread::mutex> guard(recognizerPoolMutex);
+
+      while (country_recognizers->idleDetectors.size() == 0 &&
+             country_recognizers->detectorInstances >= recognizerInstanceLimit)
+        recognizerReturned.wait(recognizerPoolMutex);
+
+      detector_mask = mask;
+      detector_mask_version = maskVersion;
+
+      if (country_recognizers->idleDetectors.size() > 0)
+      {
+        detector = country_recognizers->idleDetectors.back();
+        country_recognizers->idleDetectors.pop_back();
+
+        // Up to date unless setMask() was called since it was last used
+        if (country_recognizers->detectorMaskVersions[detector] == maskVersion)
+          return detector;
+
+        country_recognizers->detectorMaskVersions[detector] = maskVersion;
+      }
+      else
+      {
+        // Every instance is busy with another image and the pool has room for one more
+        country_recognizers->detectorInstances++;
+      }
+    }
+
+    if (detector == NULL)
+    {
+      // Loading the cascade is slow, so it is done outside the lock
+      detector = createDetector(country_recognizers->config, prewarp);
+
+      tthread::lock_guard<tthread::mutex> guard(recognizerPoolMutex);
+      country_recognizers->detectorMaskVersions[detector] = detector_mask_version;
+    }
+
+    // The detector is ours alone now.  A mask that is replaced meanwhile is applied on the next checkout
+    detector->setMask(detector_mask);
+
+    return detector;
+  }
+
+  void AlprImpl::returnDetector(AlprRecognizers* country_recognizers, Detector* detector)
+  {
+    tthread::lock_guard<tthread::mutex> guard(recognizerPoolMutex);
+    country_recognizers->idleDetectors.push_back(detector);
+    recognizerReturned.notify_all();
+  }
+
+  OCR* AlprImpl::checkoutOcr(AlprRecognizers* country_recognizers)
+  {
+    {
+      tthread::lock_guard<tthread::mutex> guard(recognizerPoolMutex);
+
+      while (country_recognizers->idleOcrs.size() == 0 &&
+             country_recognizers->ocrInstances >= recognizerInstanceLimit)
+        recognizerReturned.wait(recognizerPoolMutex);
+
+      if (country_recognizers->idleOcrs.size() > 0)
+      {
+        OCR* ocr = country_recognizers->idleOcrs.back();
+        country_recognizers->idleOcrs.pop_back();
+        return ocr;
+      }
+
+      // Every instance is busy on another plate and the pool has room for one more
+      country_recognizers->ocrInstances++;
+    }
+
+    // Loading the OCR language data is slow, so it is done outside the lock
+    return createOcr(country_recognizers->config);
+  }
+
+  void AlprImpl::returnOcr(AlprRecognizers* country_recognizers, OCR* ocr)
+  {
+    tthread::lock_guard<tthread::mutex> guard(recognizerPoolMutex);
+    country_recognizers->idleOcrs.push_back(ocr);
+    recognizerReturned.notify_all();
+  }
+
+  AlprResults AlprImpl::recognize( std::string filepath )
+  {
+    std::ifstream ifs(filepath.c_str(), std::ios::binary|std::ios::ate);
+
+    if (ifs)
+    {
+      std::ifstream::pos_type pos = ifs.tellg();
+
+      std::vector<char>  buffer(pos);
+
+      ifs.seekg(0, std::ios::beg);
+      ifs.read(&buffer[0], pos);
+
+      return this->recognize( buffer );
+    }
+    else
+    {
+      std::cerr << "file does not exist: " << filepath << std::endl;
+      AlprResults emptyResults;
+      emptyResults.epoch_time = getEpochTimeMs();
+      emptyResults.img_width = 0;
+      emptyResults.img_height = 0;
+      emptyResults.total_processing_time_ms = 0;
+      return emptyResults;
+    }
   }
 
   AlprResults AlprImpl::recognize( std::vector<char> imageBytes)
@@ -481,6 +966,73 @@ namespace alpr
   }
 
 
+  std::vector<AlprResults> AlprImpl::recognizeBatch( const std::vector<std::string>& filepaths )
+  {
+    std::vector<BatchRecognitionJob> jobs(filepaths.size());
+    for (unsigned int i = 0; i < filepaths.size(); i++)
+    {
+      jobs[i].filepath = &filepaths[i];
+      jobs[i].imageBytes = ALPR_NULL_PTR;
+    }
+
+    return runBatch(jobs);
+  }
+
+  std::vector<AlprResults> AlprImpl::recognizeBatch( const std::vector<std::vector<char> >& imagesBytes )
+  {
+    std::vector<BatchRecognitionJob> jobs(imagesBytes.size());
+    for (unsigned int i = 0; i < imagesBytes.size(); i++)
+    {
+      jobs[i].filepath = ALPR_NULL_PTR;
+      jobs[i].imageBytes = &imagesBytes[i];
+    }
+
+    return runBatch(jobs);
+  }
+
+  std::vector<AlprResults> AlprImpl::runBatch(std::vector<BatchRecognitionJob>& jobs)
+  {
+    // Each image is read, decoded and analyzed on a batch pool thread.  The plate analysis inside
+    // each image runs on the worker pool, as it does for a single image
+    std::vector<void*> jobArgs;
+    for (unsigned int i = 0; i < jobs.size(); i++)
+    {
+      jobs[i].alpr = this;
+      jobArgs.push_back(&jobs[i]);
+    }
+
+    if (config->debugShowImages)
+    {
+      for (unsigned int i = 0; i < jobArgs.size(); i++)
+        batchRecognitionThread(jobArgs[i]);
+    }
+    else
+    {
+      batchPoolMutex.lock();
+      if (batchPool == ALPR_NULL_PTR)
+        batchPool = new WorkerPool(batchThreads);
+      batchPoolMutex.unlock();
+
+      batchPool->run(batchRecognitionThread, jobArgs);
+    }
+
+    std::vector<AlprResults> results;
+    results.reserve(jobs.size());
+    for (unsigned int i = 0; i < jobs.size(); i++)
+      results.push_back(jobs[i].results);
+
+    return results;
+  }
+
+  void AlprImpl::recognizeBatchItem(BatchRecognitionJob* job)
+  {
+    // The recognize() functions catch OpenCV exceptions, nothing may escape a pool thread
+    if (job->filepath != ALPR_NULL_PTR)
+      job->results = recognize(*job->filepath);
+    else
+      job->results = recognize(*job->imageBytes);
+  }
+
    std::vector<cv::Rect> AlprImpl::convertRects(std::vector<AlprRegionOfInterest> regionsOfInterest)
    {
      std::vector<cv::Rect> rectRegions;
@@ -494,220 +1046,205 @@ namespace alpr
 
   string AlprImpl::toJson( const AlprResults results )
   {
-    cJSON *root, *jsonResults;
-    root = cJSON_CreateObject();
+    string response;
+    toJson(results, response, vector<AlprJsonField>());
+    return response;
+  }
 
+  void AlprImpl::toJson( const AlprResults& results, std::string& output, const std::vector<AlprJsonField>& extraFields )
+  {
+    JsonWriter writer(output);
+    writer.beginObject();
 
-    cJSON_AddNumberToObject(root,"version",	2	  );
-    cJSON_AddStringToObject(root,"data_type",	"alpr_results"	  );
+    writer.addNumber("version",	2	  );
+    writer.addString("data_type",	"alpr_results"	  );
 
-    cJSON_AddNumberToObject(root,"epoch_time",	results.epoch_time	  );
-    cJSON_AddNumberToObject(root,"img_width",	results.img_width	  );
-    cJSON_AddNumberToObject(root,"img_height",	results.img_height	  );
-    cJSON_AddNumberToObject(root,"processing_time_ms", results.total_processing_time_ms );
+    writer.addNumber("epoch_time",	results.epoch_time	  );
+    writer.addNumber("img_width",	results.img_width	  );
+    writer.addNumber("img_height",	results.img_height	  );
+    writer.addNumber("processing_time_ms", results.total_processing_time_ms );
 
     // Add the regions of interest to the JSON
-    cJSON *rois;
-    cJSON_AddItemToObject(root, "regions_of_interest", 		rois=cJSON_CreateArray());
+    writer.beginArray("regions_of_interest");
     for (unsigned int i=0;i<results.regionsOfInterest.size();i++)
     {
-      cJSON *roi_object;
-      roi_object = cJSON_CreateObject();
-      cJSON_AddNumberToObject(roi_object, "x",  results.regionsOfInterest[i].x);
-      cJSON_AddNumberToObject(roi_object, "y",  results.regionsOfInterest[i].y);
-      cJSON_AddNumberToObject(roi_object, "width",  results.regionsOfInterest[i].width);
-      cJSON_AddNumberToObject(roi_object, "height",  results.regionsOfInterest[i].height);
-
-      cJSON_AddItemToArray(rois, roi_object);
+      writer.beginObject();
+      writer.addNumber("x",  results.regionsOfInterest[i].x);
+      writer.addNumber("y",  results.regionsOfInterest[i].y);
+      writer.addNumber("width",  results.regionsOfInterest[i].width);
+      writer.addNumber("height",  results.regionsOfInterest[i].height);
+      writer.endObject();
     }
+    writer.endArray();
 
-
-    cJSON_AddItemToObject(root, "results", 		jsonResults=cJSON_CreateArray());
+    writer.beginArray("results");
     for (unsigned int i = 0; i < results.plates.size(); i++)
     {
-      cJSON *resultObj = createJsonObj( &results.plates[i] );
-      cJSON_AddItemToArray(jsonResults, resultObj);
+      writer.beginObject();
+      writePlateJson(writer, results.plates[i]);
+      writer.endObject();
     }
+    writer.endArray();
 
-    // Print the JSON object to a string and return
-    char *out;
-    out=cJSON_PrintUnformatted(root);
+    for (unsigned int i = 0; i < extraFields.size(); i++)
+      writer.addRaw(extraFields[i].key.c_str(), extraFields[i].json_value);
 
-    cJSON_Delete(root);
-
-    string response(out);
-
-    free(out);
-    return response;
+    writer.endObject();
   }
 
 
 
   std::string AlprImpl::toJson( const AlprPlateResult result )
   {
-    cJSON *resultObj = createJsonObj( &result );
-    
-    char *out;
-    out=cJSON_PrintUnformatted(resultObj);
-
-    cJSON_Delete(resultObj);
+    string response;
 
-    string response(out);
+    JsonWriter writer(response);
+    writer.beginObject();
+    writePlateJson(writer, result);
+    writer.endObject();
 
-    free(out);
-    
     return response;
   }
-  cJSON* AlprImpl::createJsonObj(const AlprPlateResult* result)
-  {
-    cJSON *root, *coords, *candidates;
-
-    root=cJSON_CreateObject();
 
-    cJSON_AddStringToObject(root,"plate",		result->bestPlate.characters.c_str());
-    cJSON_AddNumberToObject(root,"confidence",		result->bestPlate.overall_confidence);
-    cJSON_AddNumberToObject(root,"matches_template",	result->bestPlate.matches_template);
+  void AlprImpl::writePlateJson(JsonWriter& writer, const AlprPlateResult& result)
+  {
+    writer.addString("plate",		result.bestPlate.characters);
+    writer.addNumber("confidence",		result.bestPlate.overall_confidence);
+    writer.addNumber("matches_template",	result.bestPlate.matches_template);
 
-    cJSON_AddNumberToObject(root,"plate_index",               result->plate_index);
+    writer.addNumber("plate_index",               result.plate_index);
 
-    cJSON_AddStringToObject(root,"region",		result->region.c_str());
-    cJSON_AddNumberToObject(root,"region_confidence",	result->regionConfidence);
+    writer.addString("region",		result.region);
+    writer.addNumber("region_confidence",	result.regionConfidence);
 
-    cJSON_AddNumberToObject(root,"processing_time_ms",	result->processing_time_ms);
-    cJSON_AddNumberToObject(root,"requested_topn",	result->requested_topn);
+    writer.addNumber("processing_time_ms",	result.processing_time_ms);
+    writer.addNumber("requested_topn",	result.requested_topn);
 
-    cJSON_AddItemToObject(root, "coordinates", 		coords=cJSON_CreateArray());
+    writer.beginArray("coordinates");
     for (int i=0;i<4;i++)
     {
-      cJSON *coords_object;
-      coords_object = cJSON_CreateObject();
-      cJSON_AddNumberToObject(coords_object, "x",  result->plate_points[i].x);
-      cJSON_AddNumberToObject(coords_object, "y",  result->plate_points[i].y);
-
-      cJSON_AddItemToArray(coords, coords_object);
+      writer.beginObject();
+      writer.addNumber("x",  result.plate_points[i].x);
+      writer.addNumber("y",  result.plate_points[i].y);
+      writer.endObject();
     }
+    writer.endArray();
 
-
-    cJSON_AddItemToObject(root, "candidates", 		candidates=cJSON_CreateArray());
-    for (unsigned int i = 0; i < result->topNPlates.size(); i++)
+    writer.beginArray("candidates");
+    for (unsigned int i = 0; i < result.topNPlates.size(); i++)
     {
-      cJSON *candidate_object;
-      candidate_object = cJSON_CreateObject();
-      cJSON_AddStringToObject(candidate_object, "plate",  result->topNPlates[i].characters.c_str());
-      cJSON_AddNumberToObject(candidate_object, "confidence",  result->topNPlates[i].overall_confidence);
-      cJSON_AddNumberToObject(candidate_object, "matches_template",  result->topNPlates[i].matches_template);
-
-      cJSON_AddItemToArray(candidates, candidate_object);
+      writer.beginObject();
+      writer.addString("plate",  result.topNPlates[i].characters);
+      writer.addNumber("confidence",  result.topNPlates[i].overall_confidence);
+      writer.addNumber("matches_template",  result.topNPlates[i].matches_template);
+      writer.endObject();
     }
-
-    return root;
+    writer.endArray();
   }
 
-  AlprResults AlprImpl::fromJson(std::string json) {
-    AlprResults allResults;
+  AlprStatistics AlprImpl::getStatistics()
+  {
+    return statistics.getStatistics();
+  }
 
-    cJSON* root = cJSON_Parse(json.c_str());
+  void AlprImpl::resetStatistics()
+  {
+    statistics.reset();
+  }
 
-    int version = cJSON_GetObjectItem(root, "version")->valueint;
-    allResults.epoch_time = (int64_t) cJSON_GetObjectItem(root, "epoch_time")->valuedouble;
-    allResults.img_width = cJSON_GetObjectItem(root, "img_width")->valueint;
-    allResults.img_height = cJSON_GetObjectItem(root, "img_height")->valueint;
-    allResults.total_processing_time_ms = cJSON_GetObjectItem(root, "processing_time_ms")->valueint;
+  std::string AlprImpl::toJson( const AlprStatistics statistics )
+  {
+    string response;
 
+    JsonWriter writer(response);
+    writer.beginObject();
+    writer.addString("data_type",	"alpr_statistics"	  );
 
-    cJSON* rois = cJSON_GetObjectItem(root,"regions_of_interest");
-    int numRois = cJSON_GetArraySize(rois);
-    for (int c = 0; c < numRois; c++)
+    writer.beginObject("stages");
+    for (unsigned int i = 0; i < statistics.stages.size(); i++)
     {
-      cJSON* roi = cJSON_GetArrayItem(rois, c);
-      int x = cJSON_GetObjectItem(roi, "x")->valueint;
-      int y = cJSON_GetObjectItem(roi, "y")->valueint;
-      int width = cJSON_GetObjectItem(roi, "width")->valueint;
-      int height = cJSON_GetObjectItem(roi, "height")->valueint;
-
-      AlprRegionOfInterest alprRegion(x,y,width,height);
-      allResults.regionsOfInterest.push_back(alprRegion);
+      const AlprStageStatistics& stage = statistics.stages[i];
+
+      writer.beginObject(stage.stage.c_str());
+      writer.addNumber("count",  stage.count);
+      writer.addNumber("total_ms",  stage.total_ms);
+      writer.addNumber("mean_ms",  stage.mean_ms);
+      writer.addNumber("p50_ms",  stage.p50_ms);
+      writer.addNumber("p90_ms",  stage.p90_ms);
+      writer.addNumber("p99_ms",  stage.p99_ms);
+      writer.addNumber("max_ms",  stage.max_ms);
+      writer.endObject();
     }
+    writer.endObject();
 
-    cJSON* resultsArray = cJSON_GetObjectItem(root,"results");
-    int resultsSize = cJSON_GetArraySize(resultsArray);
-
-    for (int i = 0; i < resultsSize; i++)
-    {
-      cJSON* item = cJSON_GetArrayItem(resultsArray, i);
-      AlprPlateResult plate;
-
-      //plate.bestPlate = cJSON_GetObjectItem(item, "plate")->valuestring;
-      plate.processing_time_ms = cJSON_GetObjectItem(item, "processing_time_ms")->valuedouble;
-      plate.plate_index = cJSON_GetObjectItem(item, "plate_index")->valueint;
-      plate.region = std::string(cJSON_GetObjectItem(item, "region")->valuestring);
-      plate.regionConfidence = cJSON_GetObjectItem(item, "region_confidence")->valueint;
-      plate.requested_topn = cJSON_GetObjectItem(item, "requested_topn")->valueint;
-
+    writer.beginObject("counters");
+    for (std::map<std::string, int64_t>::const_iterator it = statistics.counters.begin(); it != statistics.counters.end(); it++)
+      writer.addNumber(it->first.c_str(), it->second);
+    writer.endObject();
 
-      cJSON* coordinates = cJSON_GetObjectItem(item,"coordinates");
-      for (int c = 0; c < 4; c++)
-      {
-        cJSON* coordinate = cJSON_GetArrayItem(coordinates, c);
-        AlprCoordinate alprcoord;
-        alprcoord.x = cJSON_GetObjectItem(coordinate, "x")->valueint;
-        alprcoord.y = cJSON_GetObjectItem(coordinate, "y")->valueint;
-
-        plate.plate_points[c] = alprcoord;
-      }
+    writer.beginObject("disqualify_reasons");
+    for (std::map<std::string, int64_t>::const_iterator it = statistics.disqualify_reasons.begin(); it != statistics.disqualify_reasons.end(); it++)
+      writer.addNumber(it->first.c_str(), it->second);
+    writer.endObject();
 
-      cJSON* candidates = cJSON_GetObjectItem(item,"candidates");
-      int numCandidates = cJSON_GetArraySize(candidates);
-      for (int c = 0; c < numCandidates; c++)
-      {
-        cJSON* candidate = cJSON_GetArrayItem(candidates, c);
-        AlprPlate plateCandidate;
-        plateCandidate.characters = std::string(cJSON_GetObjectItem(candidate, "plate")->valuestring);
-        plateCandidate.overall_confidence = cJSON_GetObjectItem(candidate, "confidence")->valuedouble;
-        plateCandidate.matches_template = (cJSON_GetObjectItem(candidate, "matches_template")->valueint) != 0;
+    writer.endObject();
 
-        plate.topNPlates.push_back(plateCandidate);
+    return response;
+  }
 
-        if (c == 0)
-        {
-          plate.bestPlate = plateCandidate;
-        }
-      }
+  AlprResults AlprImpl::fromJson(std::string json) {
+    AlprResults allResults;
+    std::string error;
 
-      allResults.plates.push_back(plate);
+    // Invalid JSON gives no plates rather than some of them
+    if (!fromJson(json, allResults, error))
+    {
+      std::cerr << "Unable to parse results JSON: " << error << std::endl;
+      allResults.plates.clear();
+      allResults.regionsOfInterest.clear();
     }
 
-
-    cJSON_Delete(root);
-
-
     return allResults;
   }
 
+  bool AlprImpl::fromJson(const std::string& json, AlprResults& results, std::string& error)
+  {
+    return parseAlprResults(json.data(), json.length(), results, error);
+  }
+
+
   void AlprImpl::setCountry(std::string country) {
+    EngineUpdateScope update(this);
+
     config->load_countries(country);
     loadRecognizers();
   }
 
   void AlprImpl::setPrewarp(std::string prewarp_config)
   {
+    // The detectors read the engine prewarp while they work
+    EngineUpdateScope update(this);
+
     if (prewarp_config.length() == 0)
       prewarp ->clear();
     else
       prewarp->initialize(prewarp_config);
   }
   
+  // Detectors pick up the new mask the next time they are checked out, so the ones in use
+  // by a recognition finish the image with the mask they started with
   void AlprImpl::setMask(unsigned char* pixelData, int bytesPerPixel, int imgWidth, int imgHeight) {
 
     try
     {
       int arraySize = imgWidth * imgHeight * bytesPerPixel;
       cv::Mat imgData = cv::Mat(arraySize, 1, CV_8U, pixelData);
-      cv::Mat mask = imgData.reshape(bytesPerPixel, imgHeight);
+      // Keep a copy, detectors created later need it too
+      cv::Mat new_mask = imgData.reshape(bytesPerPixel, imgHeight).clone();
 
-      typedef std::map<std::string, AlprRecognizers>::iterator it_type;
-      for (it_type iterator = recognizers.begin(); iterator != recognizers.end(); iterator++)
-        iterator->second.plateDetector->setMask(mask);
+      tthread::lock_guard<tthread::mutex> guard(recognizerPoolMutex);
+      this->mask = new_mask;
+      maskVersion++;
     }
     catch (cv::Exception& e)
     {
@@ -745,27 +1282,135 @@ namespace alpr
   void AlprImpl::loadRecognizers() {
     for (unsigned int i = 0; i < config->loaded_countries.size(); i++)
     {
-      config->setCountry(config->loaded_countries[i]);
+      std::string country = config->loaded_countries[i];
 
-      if (recognizers.find(config->country) == recognizers.end())
+      if (recognizers.find(country) == recognizers.end())
       {
         // Country training data has not already been loaded.  Load it.
         AlprRecognizers recognizer;
-        recognizer.plateDetector = createDetector(config, prewarp);
-        recognizer.ocr = createOcr(config);
+
+        // Each country gets its own copy of the config, so recognition never has to
+        // switch the shared config between countries
+        recognizer.config = new Config(*config);
+        recognizer.config->setCountry(country);
+
+        recognizer.plateDetector = createDetector(recognizer.config, prewarp);
+        recognizer.ocr = createOcr(recognizer.config);
+        recognizer.idleDetectors.push_back(recognizer.plateDetector);
+        recognizer.idleOcrs.push_back(recognizer.ocr);
+        recognizer.detectorInstances = 1;
+        recognizer.ocrInstances = 1;
+
+        {
+          tthread::lock_guard<tthread::mutex> guard(recognizerPoolMutex);
+          if (!mask.empty())
+            recognizer.plateDetector->setMask(mask);
+          recognizer.detectorMaskVersions[recognizer.plateDetector] = maskVersion;
+        }
 
         #ifndef SKIP_STATE_DETECTION
-        recognizer.stateDetector = new StateDetector(this->config->country, this->config->config_file_path, this->config->runtimeBaseDir);
+        recognizer.stateDetector = new StateDetector(country, recognizer.config->config_file_path, recognizer.config->runtimeBaseDir);
+        recognizer.stateDetector->setIndexedMatching(recognizer.config->stateIdLsh, recognizer.config->stateIdLshProbeLevel);
         #else
         recognizer.stateDetector = NULL;
         #endif
 
-        recognizers[config->country] = recognizer;
+        recognizers[country] = recognizer;
       }
 
     }
   }
 
+  // Must be called with configMutex held
+  bool AlprImpl::countryConfigsChanged() {
+    typedef std::map<std::string, AlprRecognizers>::iterator it_type;
+    for (it_type iterator = recognizers.begin(); iterator != recognizers.end(); iterator++)
+    {
+      if (iterator->second.config->commonValuesDiffer(*config))
+        return true;
+    }
+    return false;
+  }
+
+  // Settings changed through getConfig() must reach the per-country configs, which the
+  // detectors and OCR read while they work.  They are only written while no recognition
+  // is in progress, so a call that finds them out of date waits for the others to finish.
+  // The calls arriving meanwhile see the same change and wait too
+  void AlprImpl::beginRecognition() {
+    tthread::lock_guard<tthread::mutex> guard(configMutex);
+
+    while (true)
+    {
+      // A pending setCountry() or setPrewarp() goes first
+      if (!engineUpdating)
+      {
+        if (!countryConfigsChanged())
+          break;
+
+        if (activeRecognitions == 0)
+        {
+          typedef std::map<std::string, AlprRecognizers>::iterator it_type;
+          for (it_type iterator = recognizers.begin(); iterator != recognizers.end(); iterator++)
+            iterator->second.config->copyCommonValues(*config);
+          break;
+        }
+      }
+
+      recognitionsFinished.wait(configMutex);
+    }
+
+    activeRecognitions++;
+  }
+
+  void AlprImpl::endRecognition() {
+    tthread::lock_guard<tthread::mutex> guard(configMutex);
+
+    activeRecognitions--;
+    if (activeRecognitions == 0)
+      recognitionsFinished.notify_all();
+  }
+
+  // configMutex stays locked until endEngineUpdate(), so no recognition can start in between
+  void AlprImpl::beginEngineUpdate() {
+    configMutex.lock();
+
+    while (engineUpdating)
+      recognitionsFinished.wait(configMutex);
+
+    engineUpdating = true;
+    while (activeRecognitions > 0)
+      recognitionsFinished.wait(configMutex);
+  }
+
+  void AlprImpl::endEngineUpdate() {
+    engineUpdating = false;
+    recognitionsFinished.notify_all();
+
+    configMutex.unlock();
+  }
+
+  RecognitionScope::RecognitionScope(AlprImpl* alpr)
+  {
+    this->alpr = alpr;
+    alpr->beginRecognition();
+  }
+
+  RecognitionScope::~RecognitionScope()
+  {
+    alpr->endRecognition();
+  }
+
+  EngineUpdateScope::EngineUpdateScope(AlprImpl* alpr)
+  {
+    this->alpr = alpr;
+    alpr->beginEngineUpdate();
+  }
+
+  EngineUpdateScope::~EngineUpdateScope()
+  {
+    alpr->endEngineUpdate();
+  }
+
   
   cv::Mat AlprImpl::getCharacterTransformMatrix(PipelineData* pipeline_data ) {
     std::vector<Point2f> crop_corners;
@@ -780,7 +1425,7 @@ namespace alpr
     return transmtx;
   }
   
-  std::vector<AlprCoordinate> AlprImpl::getCharacterPoints(cv::Rect char_rect, cv::Mat transmtx ) {
+  std::vector<AlprCoordinate> AlprImpl::getCharacterPoints(cv::Rect char_rect, cv::Mat transmtx, PreWarp* prewarp ) {
     
 
     std::vector<Point2f> points;
@@ -809,3 +1454,28 @@ namespace alpr
 
 
 }
+
+
+void plateAnalysisThread(void* arg)
+{
+  alpr::PlateAnalysisJob* job = (alpr::PlateAnalysisJob*) arg;
+  job->alpr->analyzePlate(job);
+}
+
+void analysisIterationThread(void* arg)
+{
+  alpr::AnalysisIterationJob* job = (alpr::AnalysisIterationJob*) arg;
+  job->alpr->analyzeIteration(job);
+}
+
+void sharedPlateAnalysisThread(void* arg)
+{
+  alpr::SharedPlateAnalysisJob* job = (alpr::SharedPlateAnalysisJob*) arg;
+  job->alpr->analyzeSharedPlate(job);
+}
+
+void batchRecognitionThread(void* arg)
+{
+  alpr::BatchRecognitionJob* job = (alpr::BatchRecognitionJob*) arg;
+  job->alpr->recognizeBatchItem(job);
+}
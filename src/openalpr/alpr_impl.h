@@ -42,8 +42,11 @@
 #include "constants.h"
 
 #include "cjson.h"
+#include "json_reader.h"
+#include "json_writer.h"
 
 #include "pipeline_data.h"
+#include "pipeline_statistics.h"
 
 #include "prewarp.h"
 
@@ -51,6 +54,8 @@
    
 #include "support/platform.h"
 #include "support/utf8.h"
+#include "support/tinythread.h"
+#include "support/worker_pool.h"
 
 #define DEFAULT_TOPN 25
 #define DEFAULT_DETECT_REGION false
@@ -68,9 +73,130 @@ namespace alpr
 
   struct AlprRecognizers
   {
+    // The engine configuration with this country's values loaded.
+    // Shared (read-only) by every recognizer below
+    Config* config;
+
     Detector* plateDetector;
     StateDetector* stateDetector;
     OCR* ocr;
+
+    // Detectors and OCR instances not currently in use by a recognition thread.
+    // Cascade classifiers and the PostProcess state are not reentrant, so a thread
+    // must have exclusive use of one while it works.  The primary instances above live here too
+    std::vector<Detector*> idleDetectors;
+    std::vector<OCR*> idleOcrs;
+
+    // Every instance created, idle or not.  Each one loads its own copy of the models
+    int detectorInstances;
+    int ocrInstances;
+
+    // The mask version last applied to each detector.  See AlprImpl::setMask()
+    std::map<Detector*, unsigned int> detectorMaskVersions;
+  };
+
+  // Everything specific to a single recognize() call for one country.  The loaded
+  // models are shared between concurrent calls, everything else is kept here.
+  struct RecognitionContext
+  {
+    AlprRecognizers* recognizers;
+    Config* config;
+
+    // A per-call copy of the engine prewarp.  warpImage() updates the transform
+    // used by the projections, so it cannot be shared
+    PreWarp* prewarp;
+
+    int topN;
+    bool detectRegion;
+    std::string defaultRegion;
+  };
+
+  class AlprImpl;
+  class ResultAggregator;
+
+  // Marks a recognition as in progress for as long as it is in scope.  See AlprImpl::beginRecognition()
+  class RecognitionScope
+  {
+    public:
+      RecognitionScope(AlprImpl* alpr);
+      ~RecognitionScope();
+
+    private:
+      AlprImpl* alpr;
+  };
+
+  // Holds off new recognitions, and waits for the ones in progress, for as long as it is in scope.
+  // Used to change the countries and the prewarp, which every recognition reads
+  class EngineUpdateScope
+  {
+    public:
+      EngineUpdateScope(AlprImpl* alpr);
+      ~EngineUpdateScope();
+
+    private:
+      AlprImpl* alpr;
+  };
+
+  // The work for a single plate region, handed to plateAnalysisThread
+  struct PlateAnalysisJob
+  {
+    AlprImpl* alpr;
+    RecognitionContext* context;
+
+    cv::Mat colorImg;
+    cv::Mat grayImg;
+    PlateRegion plateRegion;
+
+    bool plateDetected;
+    AlprPlateResult plateResult;
+  };
+
+  // A plate region analyzed once and then read by every loaded country,
+  // handed to sharedPlateAnalysisThread
+  struct SharedPlateAnalysisJob
+  {
+    AlprImpl* alpr;
+    std::vector<RecognitionContext*>* contexts;
+
+    // The country whose detector found the region.  Its settings drive the plate analysis
+    int ownerIndex;
+
+    cv::Mat colorImg;
+    cv::Mat grayImg;
+    PlateRegion plateRegion;
+
+    // One entry per context
+    std::vector<bool> plateDetected;
+    std::vector<AlprPlateResult> plateResults;
+  };
+
+  // One of the analysis_count passes over an image, handed to analysisIterationThread.
+  // Covers every context at once when they share their analysis, otherwise a single one
+  struct AnalysisIterationJob
+  {
+    AlprImpl* alpr;
+    std::vector<RecognitionContext*>* contexts;
+    ResultAggregator* aggregator;
+
+    cv::Mat colorImg;
+    cv::Mat grayImg;
+    std::vector<cv::Rect> regionsOfInterest;
+    int iteration;
+
+    // One entry per context
+    std::vector<AlprFullDetails> results;
+  };
+
+  // One image of a recognizeBatch() call, handed to batchRecognitionThread.
+  // Exactly one of filepath or imageBytes is set
+  struct BatchRecognitionJob
+  {
+    AlprImpl* alpr;
+
+    const std::string* filepath;
+    const std::vector<char>* imageBytes;
+
+    AlprResults results;
   };
 
   class AlprImpl
@@ -82,13 +208,24 @@ namespace alpr
 
       AlprFullDetails recognizeFullDetails(cv::Mat img, std::vector<cv::Rect> regionsOfInterest);
 
+      AlprResults recognize( std::string filepath );
       AlprResults recognize( std::vector<char> imageBytes );
       AlprResults recognize( std::vector<char> imageBytes, std::vector<AlprRegionOfInterest> regionsOfInterest );
       AlprResults recognize( unsigned char* pixelData, int bytesPerPixel, int imgWidth, int imgHeight, std::vector<AlprRegionOfInterest> regionsOfInterest );
       AlprResults recognize( cv::Mat img );
       AlprResults recognize( cv::Mat img, std::vector<cv::Rect> regionsOfInterest );
 
-      AlprFullDetails analyzeSingleCountry(cv::Mat colorImg, cv::Mat grayImg, std::vector<cv::Rect> regionsOfInterest);
+      std::vector<AlprResults> recognizeBatch( const std::vector<std::string>& filepaths );
+      std::vector<AlprResults> recognizeBatch( const std::vector<std::vector<char> >& imagesBytes );
+      void recognizeBatchItem(BatchRecognitionJob* job);
+
+      AlprFullDetails analyzeSingleCountry(RecognitionContext* context, cv::Mat colorImg, cv::Mat grayImg, std::vector<cv::Rect> regionsOfInterest);
+
+      std::vector<AlprFullDetails> analyzeMultiCountry(std::vector<RecognitionContext*>& contexts, cv::Mat colorImg, cv::Mat grayImg, std::vector<cv::Rect> regionsOfInterest);
+
+      void analyzeIteration(AnalysisIterationJob* job);
+      void analyzePlate(PlateAnalysisJob* job);
+      void analyzeSharedPlate(SharedPlateAnalysisJob* job);
 
       void setCountry(std::string country);
       void setPrewarp(std::string prewarp_config);
@@ -100,11 +237,18 @@ namespace alpr
 
       static std::string toJson( const AlprResults results );
       static std::string toJson( const AlprPlateResult result );
+      static void toJson( const AlprResults& results, std::string& output, const std::vector<AlprJsonField>& extraFields );
       
       static AlprResults fromJson(std::string json);
+      static bool fromJson(const std::string& json, AlprResults& results, std::string& error);
       static std::string getVersion();
 
-      static cJSON* createJsonObj(const AlprPlateResult* result);
+      AlprStatistics getStatistics();
+      void resetStatistics();
+      static std::string toJson( const AlprStatistics statistics );
+
+      // Writes the members of a plate result into an object the caller has already begun
+      static void writePlateJson(JsonWriter& writer, const AlprPlateResult& result);
       
       Config* config;
 
@@ -116,16 +260,59 @@ namespace alpr
 
       PreWarp* prewarp;
 
+      WorkerPool* workerPool;
+
+      // Runs the images of recognizeBatch() calls.  Created on first use
+      WorkerPool* batchPool;
+      int batchThreads;
+      tthread::mutex batchPoolMutex;
+      PipelineStatistics statistics;
+      // Guards the per-country configs while they are updated, activeRecognitions and engineUpdating
+      tthread::mutex configMutex;
+      tthread::condition_variable recognitionsFinished;
+      int activeRecognitions;
+      bool engineUpdating;
+      // Guards the detector and OCR pools, and the mask
+      tthread::mutex recognizerPoolMutex;
+      tthread::condition_variable recognizerReturned;
+
+      // Most detector and OCR instances each country may have.  Threads wait for one to be returned
+      // rather than loading another copy of the models
+      int recognizerInstanceLimit;
+      tthread::mutex stateDetectorMutex;
+
+      // Never modified in place, setMask() replaces it and increments maskVersion
+      cv::Mat mask;
+      unsigned int maskVersion;
+
       int topN;
       bool detectRegion;
       std::string defaultRegion;
 
       void loadRecognizers();
+      bool countryConfigsChanged();
+      void beginRecognition();
+      void endRecognition();
+      void beginEngineUpdate();
+      void endEngineUpdate();
+      friend class RecognitionScope;
+      friend class EngineUpdateScope;
+
+      Detector* checkoutDetector(AlprRecognizers* country_recognizers);
+      void returnDetector(AlprRecognizers* country_recognizers, Detector* detector);
+      OCR* checkoutOcr(AlprRecognizers* country_recognizers);
+      void returnOcr(AlprRecognizers* country_recognizers, OCR* ocr);
       
+      void runAnalysisIterations(std::vector<RecognitionContext*>& contexts, cv::Mat colorImg, cv::Mat grayImg,
+                                 std::vector<cv::Rect> regionsOfInterest, std::vector<ResultAggregator*>& aggregators);
+      bool recognizePlateText(RecognitionContext* context, PipelineData* pipeline_data, timespec platestarttime, AlprPlateResult& plateResult);
+
       cv::Mat getCharacterTransformMatrix(PipelineData* pipeline_data );
-      std::vector<AlprCoordinate> getCharacterPoints(cv::Rect char_rect, cv::Mat transmtx);
+      std::vector<AlprCoordinate> getCharacterPoints(cv::Rect char_rect, cv::Mat transmtx, PreWarp* prewarp);
       std::vector<cv::Rect> convertRects(std::vector<AlprRegionOfInterest> regionsOfInterest);
 
+      std::vector<AlprResults> runBatch(std::vector<BatchRecognitionJob>& jobs);
+
   };
 }
 
@@ -33,6 +33,21 @@
 
 #include "binarize_wolf.h"
 
+#include <algorithm>
+#include <stdint.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define BINARIZE_USE_SSE2
+  #include <emmintrin.h>
+  #if defined(__AVX2__)
+    #define BINARIZE_USE_AVX2
+    #include <immintrin.h>
+  #endif
+#elif defined(__aarch64__)
+  #define BINARIZE_USE_NEON
+  #include <arm_neon.h>
+#endif
+
 using namespace std;
 using namespace cv;
 
@@ -213,4 +228,402 @@ void NiblackSauvolaWolfJolion (Mat im, Mat output, NiblackVersion version,
     	}
     }
   }
-}
\ No newline at end of file
+
+  // *************************************************************
+  // Vectorized version.  Produces bit-identical output to the
+  // routines above, for several threshold surfaces at once.
+  // *************************************************************
+
+  NiblackParams niblackParams(NiblackVersion version, int winx, int winy, double k, double dR)
+  {
+    NiblackParams params;
+    params.version = version;
+    params.winx = winx;
+    params.winy = winy;
+    params.k = k;
+    params.dR = dR;
+    return params;
+  }
+
+  // Integral images of the pixels and their squares, (rows+1) x (cols+1), in wrapping 32 bit arithmetic.
+  // A window sum is the difference of four entries, which is exact as long as the true sum fits in 32 bits.
+  static void calcIntegrals (const Mat& im, std::vector<uint32_t>& sum, std::vector<uint32_t>& sum_sq)
+  {
+    int stride = im.cols + 1;
+    sum.assign(stride * (im.rows + 1), 0);
+    sum_sq.assign(stride * (im.rows + 1), 0);
+
+    for (int y = 0; y < im.rows; y++)
+    {
+      const unsigned char* row = im.ptr<unsigned char>(y);
+      const uint32_t* sum_above = &sum[y * stride];
+      const uint32_t* sq_above = &sum_sq[y * stride];
+      uint32_t* sum_row = &sum[(y + 1) * stride];
+      uint32_t* sq_row = &sum_sq[(y + 1) * stride];
+
+      uint32_t row_sum = 0, row_sq = 0;
+      for (int x = 0; x < im.cols; x++)
+      {
+        uint32_t v = row[x];
+        row_sum += v;
+        row_sq += v * v;
+        sum_row[x + 1] = sum_above[x + 1] + row_sum;
+        sq_row[x + 1] = sq_above[x + 1] + row_sq;
+      }
+    }
+  }
+
+  // Mean and standard deviation of one window, in the same order of operations as calcLocalStats
+  static inline void localStats (int32_t sum, int32_t sum_sq, double winarea, float* m_out, float* s_out, double& max_s)
+  {
+    double m = sum / winarea;
+    double s = sqrt ((sum_sq - m*sum) / winarea);
+    if (s > max_s) max_s = s;
+    *m_out = m;
+    *s_out = s;
+  }
+
+  static inline int32_t windowSum (const uint32_t* top, const uint32_t* bottom, int winx)
+  {
+    return (int32_t) (bottom[winx] - top[winx] - bottom[0] + top[0]);
+  }
+
+#if defined(BINARIZE_USE_SSE2)
+  static inline __m128i windowSum4 (const uint32_t* top, const uint32_t* bottom, int winx)
+  {
+    __m128i a = _mm_loadu_si128((const __m128i*) (bottom + winx));
+    __m128i b = _mm_loadu_si128((const __m128i*) (top + winx));
+    __m128i c = _mm_loadu_si128((const __m128i*) bottom);
+    __m128i d = _mm_loadu_si128((const __m128i*) top);
+    return _mm_add_epi32(_mm_sub_epi32(_mm_sub_epi32(a, b), c), d);
+  }
+#elif defined(BINARIZE_USE_NEON)
+  static inline int32x4_t windowSum4 (const uint32_t* top, const uint32_t* bottom, int winx)
+  {
+    uint32x4_t a = vld1q_u32(bottom + winx);
+    uint32x4_t b = vld1q_u32(top + winx);
+    uint32x4_t c = vld1q_u32(bottom);
+    uint32x4_t d = vld1q_u32(top);
+    return vreinterpretq_s32_u32(vaddq_u32(vsubq_u32(vsubq_u32(a, b), c), d));
+  }
+#endif
+
+  // Local statistics for n consecutive windows of one row.  top/bottom point at the
+  // integral rows above and below the windows, at the left edge of the first window
+  static double calcLocalStatsRow (const uint32_t* sum_top, const uint32_t* sum_bottom,
+                                   const uint32_t* sq_top, const uint32_t* sq_bottom,
+                                   int winx, int n, double winarea, float* map_m, float* map_s, double max_s)
+  {
+    int i = 0;
+
+#if defined(BINARIZE_USE_SSE2) || defined(BINARIZE_USE_NEON)
+    double lane_max[4] = { max_s, max_s, max_s, max_s };
+#endif
+
+#if defined(BINARIZE_USE_AVX2)
+    __m256d area = _mm256_set1_pd(winarea);
+    __m256d vmax = _mm256_loadu_pd(lane_max);
+    for (; i + 4 <= n; i += 4)
+    {
+      __m128i isum = windowSum4(sum_top + i, sum_bottom + i, winx);
+      __m128i isq = windowSum4(sq_top + i, sq_bottom + i, winx);
+      __m256d dsum = _mm256_cvtepi32_pd(isum);
+      __m256d dsq = _mm256_cvtepi32_pd(isq);
+
+      __m256d m = _mm256_div_pd(dsum, area);
+      __m256d s = _mm256_sqrt_pd(_mm256_div_pd(_mm256_sub_pd(dsq, _mm256_mul_pd(m, dsum)), area));
+      // Returns the second operand when s is NaN, like the scalar comparison
+      vmax = _mm256_max_pd(s, vmax);
+
+      _mm_storeu_ps(map_m + i, _mm256_cvtpd_ps(m));
+      _mm_storeu_ps(map_s + i, _mm256_cvtpd_ps(s));
+    }
+    _mm256_storeu_pd(lane_max, vmax);
+#elif defined(BINARIZE_USE_SSE2)
+    __m128d area = _mm_set1_pd(winarea);
+    __m128d vmax = _mm_loadu_pd(lane_max);
+    for (; i + 4 <= n; i += 4)
+    {
+      __m128i isum = windowSum4(sum_top + i, sum_bottom + i, winx);
+      __m128i isq = windowSum4(sq_top + i, sq_bottom + i, winx);
+
+      __m128d dsum_lo = _mm_cvtepi32_pd(isum);
+      __m128d dsum_hi = _mm_cvtepi32_pd(_mm_unpackhi_epi64(isum, isum));
+      __m128d dsq_lo = _mm_cvtepi32_pd(isq);
+      __m128d dsq_hi = _mm_cvtepi32_pd(_mm_unpackhi_epi64(isq, isq));
+
+      __m128d m_lo = _mm_div_pd(dsum_lo, area);
+      __m128d m_hi = _mm_div_pd(dsum_hi, area);
+      __m128d s_lo = _mm_sqrt_pd(_mm_div_pd(_mm_sub_pd(dsq_lo, _mm_mul_pd(m_lo, dsum_lo)), area));
+      __m128d s_hi = _mm_sqrt_pd(_mm_div_pd(_mm_sub_pd(dsq_hi, _mm_mul_pd(m_hi, dsum_hi)), area));
+      vmax = _mm_max_pd(s_lo, vmax);
+      vmax = _mm_max_pd(s_hi, vmax);
+
+      _mm_storeu_ps(map_m + i, _mm_movelh_ps(_mm_cvtpd_ps(m_lo), _mm_cvtpd_ps(m_hi)));
+      _mm_storeu_ps(map_s + i, _mm_movelh_ps(_mm_cvtpd_ps(s_lo), _mm_cvtpd_ps(s_hi)));
+    }
+    _mm_storeu_pd(lane_max, vmax);
+#elif defined(BINARIZE_USE_NEON)
+    float64x2_t area = vdupq_n_f64(winarea);
+    float64x2_t vmax = vld1q_f64(lane_max);
+    for (; i + 4 <= n; i += 4)
+    {
+      int32x4_t isum = windowSum4(sum_top + i, sum_bottom + i, winx);
+      int32x4_t isq = windowSum4(sq_top + i, sq_bottom + i, winx);
+
+      float64x2_t dsum_lo = vcvtq_f64_s64(vmovl_s32(vget_low_s32(isum)));
+      float64x2_t dsum_hi = vcvtq_f64_s64(vmovl_s32(vget_high_s32(isum)));
+      float64x2_t dsq_lo = vcvtq_f64_s64(vmovl_s32(vget_low_s32(isq)));
+      float64x2_t dsq_hi = vcvtq_f64_s64(vmovl_s32(vget_high_s32(isq)));
+
+      float64x2_t m_lo = vdivq_f64(dsum_lo, area);
+      float64x2_t m_hi = vdivq_f64(dsum_hi, area);
+      float64x2_t s_lo = vsqrtq_f64(vdivq_f64(vsubq_f64(dsq_lo, vmulq_f64(m_lo, dsum_lo)), area));
+      float64x2_t s_hi = vsqrtq_f64(vdivq_f64(vsubq_f64(dsq_hi, vmulq_f64(m_hi, dsum_hi)), area));
+      // maxnm ignores NaN, like the scalar comparison
+      vmax = vmaxnmq_f64(vmax, s_lo);
+      vmax = vmaxnmq_f64(vmax, s_hi);
+
+      vst1q_f32(map_m + i, vcombine_f32(vcvt_f32_f64(m_lo), vcvt_f32_f64(m_hi)));
+      vst1q_f32(map_s + i, vcombine_f32(vcvt_f32_f64(s_lo), vcvt_f32_f64(s_hi)));
+    }
+    vst1q_f64(lane_max, vmax);
+#endif
+
+#if defined(BINARIZE_USE_SSE2) || defined(BINARIZE_USE_NEON)
+    for (int lane = 0; lane < 4; lane++)
+      if (lane_max[lane] > max_s) max_s = lane_max[lane];
+#endif
+
+    for (; i < n; i++)
+    {
+      localStats(windowSum(sum_top + i, sum_bottom + i, winx), windowSum(sq_top + i, sq_bottom + i, winx),
+                 winarea, &map_m[i], &map_s[i], max_s);
+    }
+
+    return max_s;
+  }
+
+  // Threshold of a single window, in the same order of operations as NiblackSauvolaWolfJolion
+  static inline float localThreshold (const NiblackParams& params, double m, double s, double max_s, double min_I)
+  {
+    switch (params.version)
+    {
+      case NIBLACK:
+        return m + params.k*s;
+      case SAUVOLA:
+        return m * (1 + params.k*(s/params.dR-1));
+      case WOLFJOLION:
+      default:
+        return m + params.k * (s/max_s-1) * (m-min_I);
+    }
+  }
+
+  static void calcThresholdRow (const NiblackParams& params, const float* map_m, const float* map_s, int n,
+                                double max_s, double min_I, float* th)
+  {
+    int i = 0;
+
+#if defined(BINARIZE_USE_SSE2)
+    __m128d k = _mm_set1_pd(params.k);
+    __m128d one = _mm_set1_pd(1.0);
+    __m128d dR = _mm_set1_pd(params.dR);
+    __m128d vmax_s = _mm_set1_pd(max_s);
+    __m128d vmin_I = _mm_set1_pd(min_I);
+    for (; i + 4 <= n; i += 4)
+    {
+      __m128 mf = _mm_loadu_ps(map_m + i);
+      __m128 sf = _mm_loadu_ps(map_s + i);
+      __m128d m[2] = { _mm_cvtps_pd(mf), _mm_cvtps_pd(_mm_movehl_ps(mf, mf)) };
+      __m128d s[2] = { _mm_cvtps_pd(sf), _mm_cvtps_pd(_mm_movehl_ps(sf, sf)) };
+      __m128d t[2];
+
+      for (int h = 0; h < 2; h++)
+      {
+        if (params.version == NIBLACK)
+          t[h] = _mm_add_pd(m[h], _mm_mul_pd(k, s[h]));
+        else if (params.version == SAUVOLA)
+          t[h] = _mm_mul_pd(m[h], _mm_add_pd(one, _mm_mul_pd(k, _mm_sub_pd(_mm_div_pd(s[h], dR), one))));
+        else
+          t[h] = _mm_add_pd(m[h], _mm_mul_pd(_mm_mul_pd(k, _mm_sub_pd(_mm_div_pd(s[h], vmax_s), one)), _mm_sub_pd(m[h], vmin_I)));
+      }
+
+      _mm_storeu_ps(th + i, _mm_movelh_ps(_mm_cvtpd_ps(t[0]), _mm_cvtpd_ps(t[1])));
+    }
+#elif defined(BINARIZE_USE_NEON)
+    float64x2_t k = vdupq_n_f64(params.k);
+    float64x2_t one = vdupq_n_f64(1.0);
+    float64x2_t dR = vdupq_n_f64(params.dR);
+    float64x2_t vmax_s = vdupq_n_f64(max_s);
+    float64x2_t vmin_I = vdupq_n_f64(min_I);
+    for (; i + 4 <= n; i += 4)
+    {
+      float32x4_t mf = vld1q_f32(map_m + i);
+      float32x4_t sf = vld1q_f32(map_s + i);
+      float64x2_t m[2] = { vcvt_f64_f32(vget_low_f32(mf)), vcvt_f64_f32(vget_high_f32(mf)) };
+      float64x2_t s[2] = { vcvt_f64_f32(vget_low_f32(sf)), vcvt_f64_f32(vget_high_f32(sf)) };
+      float64x2_t t[2];
+
+      for (int h = 0; h < 2; h++)
+      {
+        if (params.version == NIBLACK)
+          t[h] = vaddq_f64(m[h], vmulq_f64(k, s[h]));
+        else if (params.version == SAUVOLA)
+          t[h] = vmulq_f64(m[h], vaddq_f64(one, vmulq_f64(k, vsubq_f64(vdivq_f64(s[h], dR), one))));
+        else
+          t[h] = vaddq_f64(m[h], vmulq_f64(vmulq_f64(k, vsubq_f64(vdivq_f64(s[h], vmax_s), one)), vsubq_f64(m[h], vmin_I)));
+      }
+
+      vst1q_f32(th + i, vcombine_f32(vcvt_f32_f64(t[0]), vcvt_f32_f64(t[1])));
+    }
+#endif
+
+    for (; i < n; i++)
+      th[i] = localThreshold(params, map_m[i], map_s[i], max_s, min_I);
+  }
+
+  // output = (im >= th) ? above : below
+  static void applyThresholdRow (const unsigned char* im, const float* th, int n,
+                                 unsigned char above, unsigned char below, unsigned char* output)
+  {
+    int x = 0;
+
+#if defined(BINARIZE_USE_SSE2)
+    __m128i zero = _mm_setzero_si128();
+    __m128i vabove = _mm_set1_epi8((char) above);
+    __m128i vbelow = _mm_set1_epi8((char) below);
+    for (; x + 16 <= n; x += 16)
+    {
+      __m128i px = _mm_loadu_si128((const __m128i*) (im + x));
+      __m128i px_lo = _mm_unpacklo_epi8(px, zero);
+      __m128i px_hi = _mm_unpackhi_epi8(px, zero);
+
+      __m128 c0 = _mm_cmpge_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(px_lo, zero)), _mm_loadu_ps(th + x));
+      __m128 c1 = _mm_cmpge_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(px_lo, zero)), _mm_loadu_ps(th + x + 4));
+      __m128 c2 = _mm_cmpge_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(px_hi, zero)), _mm_loadu_ps(th + x + 8));
+      __m128 c3 = _mm_cmpge_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(px_hi, zero)), _mm_loadu_ps(th + x + 12));
+
+      __m128i mask = _mm_packs_epi16(_mm_packs_epi32(_mm_castps_si128(c0), _mm_castps_si128(c1)),
+                                     _mm_packs_epi32(_mm_castps_si128(c2), _mm_castps_si128(c3)));
+      __m128i result = _mm_or_si128(_mm_and_si128(mask, vabove), _mm_andnot_si128(mask, vbelow));
+      _mm_storeu_si128((__m128i*) (output + x), result);
+    }
+#elif defined(BINARIZE_USE_NEON)
+    uint8x16_t vabove = vdupq_n_u8(above);
+    uint8x16_t vbelow = vdupq_n_u8(below);
+    for (; x + 16 <= n; x += 16)
+    {
+      uint8x16_t px = vld1q_u8(im + x);
+      uint16x8_t px_lo = vmovl_u8(vget_low_u8(px));
+      uint16x8_t px_hi = vmovl_u8(vget_high_u8(px));
+
+      uint32x4_t c0 = vcgeq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(px_lo))), vld1q_f32(th + x));
+      uint32x4_t c1 = vcgeq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(px_lo))), vld1q_f32(th + x + 4));
+      uint32x4_t c2 = vcgeq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(px_hi))), vld1q_f32(th + x + 8));
+      uint32x4_t c3 = vcgeq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(px_hi))), vld1q_f32(th + x + 12));
+
+      uint8x16_t mask = vcombine_u8(vmovn_u16(vcombine_u16(vmovn_u32(c0), vmovn_u32(c1))),
+                                    vmovn_u16(vcombine_u16(vmovn_u32(c2), vmovn_u32(c3))));
+      vst1q_u8(output + x, vbslq_u8(mask, vabove, vbelow));
+    }
+#endif
+
+    for (; x < n; x++)
+      output[x] = (im[x] >= th[x]) ? above : below;
+  }
+
+  void NiblackSauvolaWolfJolionMulti (Mat im, std::vector<Mat>& outputs,
+                                      const std::vector<NiblackParams>& params, bool invert)
+  {
+    // Largest window area whose sum of squares is guaranteed to fit in a signed 32 bit int
+    // (255 * 255 * 33025 < 2^31).  The window sums are widened from int32 to double
+    const int MAX_WINDOW_AREA = 33025;
+
+    unsigned char above = invert ? 0 : 255;
+    unsigned char below = invert ? 255 : 0;
+
+    outputs.resize(params.size());
+    for (unsigned int p = 0; p < params.size(); p++)
+      outputs[p].create(im.rows, im.cols, CV_8U);
+
+    std::vector<uint32_t> sum, sum_sq;
+    calcIntegrals(im, sum, sum_sq);
+    int stride = im.cols + 1;
+
+    double min_I, max_I;
+    minMaxLoc(im, &min_I, &max_I);
+
+    // Threshold surfaces for the rows with a full window.  Rows above and below copy the nearest one
+    std::vector<Mat> thsurfs(params.size());
+    std::vector<int> y_firstths(params.size());
+    std::vector<int> y_lastths(params.size());
+
+    for (unsigned int p = 0; p < params.size(); p++)
+    {
+      int winx = params[p].winx;
+      int winy = params[p].winy;
+      int wxh = winx/2;
+      int wyh = winy/2;
+      int y_firstth = wyh;
+      int y_lastth = im.rows-wyh-1;
+      int x_lastth = im.cols-wxh-1;
+      int num_windows = im.cols-winx+1;
+      double winarea = winx*winy;
+
+      if (num_windows <= 0 || y_lastth < y_firstth || winx*winy > MAX_WINDOW_AREA)
+      {
+        // Degenerate sizes are left to the reference implementation
+        NiblackSauvolaWolfJolion(im, outputs[p], params[p].version, winx, winy, params[p].k, params[p].dR);
+        if (invert)
+          bitwise_not(outputs[p], outputs[p]);
+        y_firstths[p] = -1;
+        continue;
+      }
+
+      int valid_rows = y_lastth - y_firstth + 1;
+      Mat map_m(valid_rows, num_windows, CV_32F);
+      Mat map_s(valid_rows, num_windows, CV_32F);
+
+      double max_s = 0;
+      for (int j = y_firstth; j <= y_lastth; j++)
+      {
+        int top = (j-wyh) * stride;
+        int bottom = (j-wyh+winy) * stride;
+        max_s = calcLocalStatsRow(&sum[top], &sum[bottom], &sum_sq[top], &sum_sq[bottom], winx, num_windows, winarea,
+                                  map_m.ptr<float>(j - y_firstth), map_s.ptr<float>(j - y_firstth), max_s);
+      }
+
+      thsurfs[p].create(valid_rows, im.cols, CV_32F);
+      for (int r = 0; r < valid_rows; r++)
+      {
+        float* th = thsurfs[p].ptr<float>(r);
+        calcThresholdRow(params[p], map_m.ptr<float>(r), map_s.ptr<float>(r), num_windows, max_s, min_I, th + wxh);
+
+        // Left and right borders repeat the first and last full window
+        for (int x = 0; x < wxh; x++)
+          th[x] = th[wxh];
+        float last_th = th[wxh + num_windows - 1];
+        for (int x = x_lastth; x < im.cols; x++)
+          th[x] = last_th;
+      }
+
+      y_firstths[p] = y_firstth;
+      y_lastths[p] = y_lastth;
+    }
+
+    // Single pass over the image producing every output
+    for (int y = 0; y < im.rows; y++)
+    {
+      const unsigned char* im_row = im.ptr<unsigned char>(y);
+      for (unsigned int p = 0; p < params.size(); p++)
+      {
+        if (y_firstths[p] < 0)
+          continue;
+
+        int j = std::min(std::max(y, y_firstths[p]), y_lastths[p]);
+        applyThresholdRow(im_row, thsurfs[p].ptr<float>(j - y_firstths[p]), im.cols, above, below, outputs[p].ptr<unsigned char>(y));
+      }
+    }
+  }
+
+}
@@ -47,6 +47,25 @@ namespace alpr
   void NiblackSauvolaWolfJolion (cv::Mat im, cv::Mat output, NiblackVersion version,
                                  int winx, int winy, double k, double dR=BINARIZEWOLF_DEFAULTDR);
 
+  // One threshold surface computed by NiblackSauvolaWolfJolionMulti
+  struct NiblackParams
+  {
+    NiblackVersion version;
+    int winx;
+    int winy;
+    double k;
+    double dR;
+  };
+
+  NiblackParams niblackParams(NiblackVersion version, int winx, int winy, double k, double dR=BINARIZEWOLF_DEFAULTDR);
+
+  // Produces the same output as calling NiblackSauvolaWolfJolion once per entry in params.
+  // The integral images are computed once and shared by every window size, the local statistics
+  // and thresholds are vectorized (SSE2/AVX2/NEON when available), and all of the outputs are
+  // written in a single pass over the image.  If invert is set, the outputs are inverted as they are written.
+  void NiblackSauvolaWolfJolionMulti (cv::Mat im, std::vector<cv::Mat>& outputs,
+                                      const std::vector<NiblackParams>& params, bool invert = false);
+
 }
 
 #endif // OPENALPR_BINARIZEWOLF_H
@@ -36,6 +36,7 @@ namespace alpr
     string debug_message = "";
 
     this->loaded = false;
+    this->statistics = NULL;
 
 
 
@@ -191,6 +192,8 @@ namespace alpr
     
     detection_iteration_increase = getFloat(ini, defaultIni, "", "detection_iteration_increase", 1.1);
     detectionStrictness = getInt(ini, defaultIni, "", "detection_strictness", 3);
+    detectionSharedPyramid = getBoolean(ini, defaultIni, "", "detection_shared_pyramid", false);
+    detectionThreads = getInt(ini, defaultIni, "", "detection_threads", 1);
     maxPlateWidthPercent = getFloat(ini, defaultIni, "", "max_plate_width_percent", 100);
     maxPlateHeightPercent = getFloat(ini, defaultIni, "", "max_plate_height_percent", 100);
     maxDetectionInputWidth = getInt(ini, defaultIni, "", "max_detection_input_width", 1280);
@@ -205,6 +208,13 @@ namespace alpr
     detection_mask_image = getString(ini, defaultIni, "", "detection_mask_image", "");
     
     analysis_count = getInt(ini, defaultIni, "", "analysis_count", 1);
+    analysisEarlyExitCount = getInt(ini, defaultIni, "", "analysis_early_exit_count", 0);
+    analysisEarlyExitConfidence = getFloat(ini, defaultIni, "", "analysis_early_exit_confidence", 90);
+
+    maxThreads = getInt(ini, defaultIni, "", "max_threads", 1);
+    batchThreads = getInt(ini, defaultIni, "", "batch_threads", 0);
+
+    sharedCountryAnalysis = getBoolean(ini, defaultIni, "", "shared_country_analysis", false);
     
     prewarp = getString(ini, defaultIni, "", "prewarp", "");
             
@@ -213,8 +223,11 @@ namespace alpr
 
     ocrImagePercent = getFloat(ini, defaultIni, "", "ocr_img_size_percent", 100);
     stateIdImagePercent = getFloat(ini, defaultIni, "", "state_id_img_size_percent", 100);
+    stateIdLsh = getBoolean(ini, defaultIni, "", "state_id_lsh", false);
+    stateIdLshProbeLevel = getInt(ini, defaultIni, "", "state_id_lsh_probe_level", 2);
 
     ocrMinFontSize = getInt(ini, defaultIni, "", "ocr_min_font_point", 100);
+    ocrBatchCharacters = getBoolean(ini, defaultIni, "", "ocr_batch_characters", false);
 
     postProcessMinConfidence = getFloat(ini, defaultIni, "", "postprocess_min_confidence", 100);
     postProcessConfidenceSkipLevel = getFloat(ini, defaultIni, "", "postprocess_confidence_skip_level", 100);
@@ -307,14 +320,12 @@ namespace alpr
     detectorFile = getString(ini, "", "detector_file", "");
     
     ocrLanguage = getString(ini, "", "ocr_language", "none");
+    ocrBackend = getString(ini, "", "ocr_backend", "tesseract");
 
     postProcessRegexLetters = getString(ini, "", "postprocess_regex_letters", "\\pL");
     postProcessRegexNumbers = getString(ini, "", "postprocess_regex_numbers", "\\pN");
 
-    ocrImageWidthPx = round(((float) templateWidthPx) * ocrImagePercent);
-    ocrImageHeightPx = round(((float)templateHeightPx) * ocrImagePercent);
-    stateIdImageWidthPx = round(((float)templateWidthPx) * stateIdImagePercent);
-    stateIdimageHeightPx = round(((float)templateHeightPx) * stateIdImagePercent);
+    computeImageSizes();
 
     postProcessMinCharacters = getInt(ini, "", "postprocess_min_characters", 4);
     postProcessMaxCharacters = getInt(ini, "", "postprocess_max_characters", 8);
@@ -339,6 +350,88 @@ namespace alpr
   }
 
 
+  // The OCR and state ID image sizes scale this country's plate template
+  void Config::computeImageSizes()
+  {
+    ocrImageWidthPx = round(((float) templateWidthPx) * ocrImagePercent);
+    ocrImageHeightPx = round(((float)templateHeightPx) * ocrImagePercent);
+    stateIdImageWidthPx = round(((float)templateWidthPx) * stateIdImagePercent);
+    stateIdimageHeightPx = round(((float)templateHeightPx) * stateIdImagePercent);
+  }
+
+  bool Config::copyCommonValues(const Config& other)
+  {
+    return syncCommonValues(other, true);
+  }
+
+  bool Config::commonValuesDiffer(const Config& other)
+  {
+    return syncCommonValues(other, false);
+  }
+
+  bool Config::syncCommonValues(const Config& other, bool write)
+  {
+    bool changed = false;
+
+    syncValue(runtimeBaseDir, other.runtimeBaseDir, write, changed);
+    syncValue(detector, other.detector, write, changed);
+    syncValue(detection_iteration_increase, other.detection_iteration_increase, write, changed);
+    syncValue(detectionStrictness, other.detectionStrictness, write, changed);
+    syncValue(detectionSharedPyramid, other.detectionSharedPyramid, write, changed);
+    syncValue(detectionThreads, other.detectionThreads, write, changed);
+    syncValue(maxPlateWidthPercent, other.maxPlateWidthPercent, write, changed);
+    syncValue(maxPlateHeightPercent, other.maxPlateHeightPercent, write, changed);
+    syncValue(maxDetectionInputWidth, other.maxDetectionInputWidth, write, changed);
+    syncValue(maxDetectionInputHeight, other.maxDetectionInputHeight, write, changed);
+    syncValue(contrastDetectionThreshold, other.contrastDetectionThreshold, write, changed);
+    syncValue(mustMatchPattern, other.mustMatchPattern, write, changed);
+    syncValue(skipDetection, other.skipDetection, write, changed);
+    syncValue(detection_mask_image, other.detection_mask_image, write, changed);
+    syncValue(analysis_count, other.analysis_count, write, changed);
+    syncValue(analysisEarlyExitCount, other.analysisEarlyExitCount, write, changed);
+    syncValue(analysisEarlyExitConfidence, other.analysisEarlyExitConfidence, write, changed);
+    syncValue(maxThreads, other.maxThreads, write, changed);
+    syncValue(batchThreads, other.batchThreads, write, changed);
+    syncValue(sharedCountryAnalysis, other.sharedCountryAnalysis, write, changed);
+    syncValue(prewarp, other.prewarp, write, changed);
+    syncValue(maxPlateAngleDegrees, other.maxPlateAngleDegrees, write, changed);
+
+    // The image sizes derived from these depend on the country, so they are recomputed rather than copied
+    bool sizes_changed = false;
+    syncValue(ocrImagePercent, other.ocrImagePercent, write, sizes_changed);
+    syncValue(stateIdImagePercent, other.stateIdImagePercent, write, sizes_changed);
+    if (sizes_changed)
+    {
+      if (write)
+        computeImageSizes();
+      changed = true;
+    }
+
+    syncValue(stateIdLsh, other.stateIdLsh, write, changed);
+    syncValue(stateIdLshProbeLevel, other.stateIdLshProbeLevel, write, changed);
+    syncValue(ocrMinFontSize, other.ocrMinFontSize, write, changed);
+    syncValue(ocrBatchCharacters, other.ocrBatchCharacters, write, changed);
+    syncValue(postProcessMinConfidence, other.postProcessMinConfidence, write, changed);
+    syncValue(postProcessConfidenceSkipLevel, other.postProcessConfidenceSkipLevel, write, changed);
+
+    syncValue(debugGeneral, other.debugGeneral, write, changed);
+    syncValue(debugTiming, other.debugTiming, write, changed);
+    syncValue(debugPrewarp, other.debugPrewarp, write, changed);
+    syncValue(debugDetector, other.debugDetector, write, changed);
+    syncValue(debugStateId, other.debugStateId, write, changed);
+    syncValue(debugPlateLines, other.debugPlateLines, write, changed);
+    syncValue(debugPlateCorners, other.debugPlateCorners, write, changed);
+    syncValue(debugCharSegmenter, other.debugCharSegmenter, write, changed);
+    syncValue(debugCharAnalysis, other.debugCharAnalysis, write, changed);
+    syncValue(debugColorFiler, other.debugColorFiler, write, changed);
+    syncValue(debugOcr, other.debugOcr, write, changed);
+    syncValue(debugPostProcess, other.debugPostProcess, write, changed);
+    syncValue(debugShowImages, other.debugShowImages, write, changed);
+    syncValue(debugPauseOnFrame, other.debugPauseOnFrame, write, changed);
+
+    return changed;
+  }
+
   string Config::getCascadeRuntimeDir()
   {
     return this->runtimeBaseDir + CASCADE_DIR;
@@ -33,6 +33,8 @@
 namespace alpr
 {
 
+  class PipelineStatistics;
+
   class Config
   {
 
@@ -52,6 +54,8 @@ namespace alpr
 
       float detection_iteration_increase;
       int detectionStrictness;
+      bool detectionSharedPyramid;
+      int detectionThreads;
       float maxPlateWidthPercent;
       float maxPlateHeightPercent;
       int maxDetectionInputWidth;
@@ -64,6 +68,12 @@ namespace alpr
       std::string detection_mask_image;
 
       int analysis_count;
+      int analysisEarlyExitCount;
+      float analysisEarlyExitConfidence;
+
+      int maxThreads;
+      int batchThreads;
+      bool sharedCountryAnalysis;
       
       bool auto_invert;
       bool always_invert;
@@ -115,7 +125,9 @@ namespace alpr
       std::string detectorFile;
       
       std::string ocrLanguage;
+      std::string ocrBackend;
       int ocrMinFontSize;
+      bool ocrBatchCharacters;
 
       bool mustMatchPattern;
       
@@ -144,6 +156,9 @@ namespace alpr
 
       void setDebug(bool value);
 
+      // Where the pipeline stages record their latencies and counters.  Not owned, NULL if unused
+      PipelineStatistics* statistics;
+
       std::string getKeypointsRuntimeDir();
       std::string getCascadeRuntimeDir();
       std::string getPostProcessRuntimeDir();
@@ -155,16 +170,38 @@ namespace alpr
 
       bool setCountry(std::string country);
 
+      // Copies the values loaded from openalpr.conf (everything except the country-specific values)
+      // Only fields that differ are written.  Returns true if anything changed
+      bool copyCommonValues(const Config& other);
+
+      // True if copyCommonValues() would change anything.  Only reads
+      bool commonValuesDiffer(const Config& other);
+
     private:
     
       float ocrImagePercent;
       float stateIdImagePercent;
+      bool stateIdLsh;
+      int stateIdLshProbeLevel;
 
       std::vector<std::string> parse_country_string(std::string countries);
       bool country_is_loaded(std::string country);
 
       void loadCommonValues(std::string configFile);
       void loadCountryValues(std::string configFile, std::string country);
+      void computeImageSizes();
+
+      bool syncCommonValues(const Config& other, bool write);
+
+      template <typename T> static void syncValue(T& dest, const T& src, bool write, bool& changed)
+      {
+        if (!(dest == src))
+        {
+          if (write)
+            dest = src;
+          changed = true;
+        }
+      }
 
   };
 
@@ -18,6 +18,7 @@
 */
 
 #include "detector.h"
+#include "pipeline_statistics.h"
 
 using namespace cv;
 using namespace std;
@@ -55,6 +56,11 @@ namespace alpr
     return this->loaded;
   }
 
+  bool Detector::find_plates_in_regions(cv::Mat frame, std::vector<cv::Rect> regions, std::vector<std::vector<cv::Rect> >& plates)
+  {
+    return false;
+  }
+
   vector<PlateRegion> Detector::detect(cv::Mat frame)
   {
     std::vector<cv::Rect> regionsOfInterest;
@@ -64,6 +70,8 @@ namespace alpr
 
   vector<PlateRegion> Detector::detect(Mat frame, std::vector<cv::Rect> regionsOfInterest)
   {
+    timespec startTime;
+    getTimeMonotonic(&startTime);
 
     Mat frame_gray;
     
@@ -88,7 +96,7 @@ namespace alpr
       cvtColor(frame_gray, mask_debug_img, CV_GRAY2BGR);
     }
     
-    vector<PlateRegion> detectedRegions;   
+    vector<Rect> searchRegions;
     for (int i = 0; i < regionsOfInterest.size(); i++)
     {
       Rect roi = regionsOfInterest[i];
@@ -106,41 +114,60 @@ namespace alpr
       if ((roi.width < config->minPlateSizeWidthPx) || 
           (roi.height < config->minPlateSizeHeightPx))
         continue;
-      
-      Mat cropped = frame_gray(roi);
 
-      int w = cropped.size().width;
-      int h = cropped.size().height;
-      int offset_x = roi.x;
-      int offset_y = roi.y;
-      float scale_factor = computeScaleFactor(w, h);
+      searchRegions.push_back(roi);
+    }
 
-      if (scale_factor != 1.0)
-        resize(cropped, cropped, Size(w * scale_factor, h * scale_factor));
+    vector<vector<Rect> > regionPlates;
+    if (!config->detectionSharedPyramid || searchRegions.size() == 0 ||
+        !find_plates_in_regions(frame_gray, searchRegions, regionPlates))
+    {
+      regionPlates.clear();
+      for (unsigned int i = 0; i < searchRegions.size(); i++)
+      {
+        Rect roi = searchRegions[i];
+        Mat cropped = frame_gray(roi);
+
+        int w = cropped.size().width;
+        int h = cropped.size().height;
+        int offset_x = roi.x;
+        int offset_y = roi.y;
+        float scale_factor = computeScaleFactor(w, h);
+
+        if (scale_factor != 1.0)
+          resize(cropped, cropped, Size(w * scale_factor, h * scale_factor));
 
-    
-      float maxWidth = ((float) w) * (config->maxPlateWidthPercent / 100.0f) * scale_factor;
-      float maxHeight = ((float) h) * (config->maxPlateHeightPercent / 100.0f) * scale_factor;
-      Size minPlateSize(config->minPlateSizeWidthPx, config->minPlateSizeHeightPx);
-      Size maxPlateSize(maxWidth, maxHeight);
-    
-      vector<Rect> allRegions = find_plates(cropped, minPlateSize, maxPlateSize);
       
-      // Aggregate the Rect regions into a hierarchical representation
-      for( unsigned int i = 0; i < allRegions.size(); i++ )
-      {
-        allRegions[i].x = (allRegions[i].x / scale_factor);
-        allRegions[i].y = (allRegions[i].y / scale_factor);
-        allRegions[i].width = allRegions[i].width / scale_factor;
-        allRegions[i].height = allRegions[i].height / scale_factor;
+        float maxWidth = ((float) w) * (config->maxPlateWidthPercent / 100.0f) * scale_factor;
+        float maxHeight = ((float) h) * (config->maxPlateHeightPercent / 100.0f) * scale_factor;
+        Size minPlateSize(config->minPlateSizeWidthPx, config->minPlateSizeHeightPx);
+        Size maxPlateSize(maxWidth, maxHeight);
+      
+        vector<Rect> allRegions = find_plates(cropped, minPlateSize, maxPlateSize);
+        
+        for( unsigned int j = 0; j < allRegions.size(); j++ )
+        {
+          allRegions[j].x = (allRegions[j].x / scale_factor);
+          allRegions[j].y = (allRegions[j].y / scale_factor);
+          allRegions[j].width = allRegions[j].width / scale_factor;
+          allRegions[j].height = allRegions[j].height / scale_factor;
+
+          // Ensure that the rectangle isn't < 0 or > maxWidth/Height
+          allRegions[j] = expandRect(allRegions[j], 0, 0, w, h);
 
-        // Ensure that the rectangle isn't < 0 or > maxWidth/Height
-        allRegions[i] = expandRect(allRegions[i], 0, 0, w, h);
+          allRegions[j].x = allRegions[j].x + offset_x;
+          allRegions[j].y = allRegions[j].y + offset_y;
+        }
 
-        allRegions[i].x = allRegions[i].x + offset_x;
-        allRegions[i].y = allRegions[i].y + offset_y;
+        regionPlates.push_back(allRegions);
       }
-      
+    }
+
+    vector<PlateRegion> detectedRegions;   
+    for (unsigned int r = 0; r < regionPlates.size(); r++)
+    {
+      vector<Rect>& allRegions = regionPlates[r];
+
       // Check the rectangles and make sure that they're definitely not masked
       vector<Rect> regions_not_masked;
       for (unsigned int i = 0; i < allRegions.size(); i++)
@@ -154,10 +181,9 @@ namespace alpr
           regions_not_masked.push_back(allRegions[i]);
       }
       
+      // Aggregate the Rect regions into a hierarchical representation
       vector<PlateRegion> orderedRegions = aggregateRegions(regions_not_masked);
 
-      
-
       for (unsigned int j = 0; j < orderedRegions.size(); j++)
         detectedRegions.push_back(orderedRegions[j]);
     }
@@ -167,6 +193,13 @@ namespace alpr
     {
       imshow("Detection Mask", mask_debug_img);
     }
+
+    if (config->statistics != NULL)
+    {
+      timespec endTime;
+      getTimeMonotonic(&endTime);
+      config->statistics->recordStage(STAGE_DETECTION, diffclock(startTime, endTime));
+    }
     
     return detectedRegions;
   }
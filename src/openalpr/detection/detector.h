@@ -48,6 +48,11 @@ namespace alpr
       std::vector<PlateRegion> detect(cv::Mat frame, std::vector<cv::Rect> regionsOfInterest);
 
       virtual std::vector<cv::Rect> find_plates(cv::Mat frame, cv::Size min_plate_size, cv::Size max_plate_size)=0;
+
+      // Finds the plates in several regions of one frame together, sharing the work between them.
+      // plates receives one list per region, in frame coordinates.
+      // Returns false if the detector can only search one region at a time
+      virtual bool find_plates_in_regions(cv::Mat frame, std::vector<cv::Rect> regions, std::vector<std::vector<cv::Rect> >& plates);
       
       void setMask(cv::Mat mask);
       
@@ -25,6 +25,37 @@ using namespace std;
 namespace alpr
 {
 
+  // Every CPU detector shares one pool for the scale and tile tasks
+  static tthread::mutex detection_pool_mutex;
+  static WorkerPool* shared_detection_pool = NULL;
+  static int shared_detection_pool_users = 0;
+
+  struct ResizeLevelJob
+  {
+    Mat base;
+    Mat level;
+    Size level_size;
+  };
+
+  struct CascadeJob
+  {
+    DetectorCPU* detector;
+
+    // The image searched, and the band of window positions this job is responsible for
+    Mat image;
+    Rect search_area;
+    int first_row;
+    int last_row;
+
+    // The window size searched for, and the scale step detectMultiScale takes to reach it.  A full
+    // scale job searches the base image and lets detectMultiScale shrink it, a band job searches
+    // one band of a pyramid level at its original window size
+    Size window;
+    double scale_step;
+    bool full_scale;
+
+    vector<Rect> hits;
+  };
 
   DetectorCPU::DetectorCPU(Config* config, PreWarp* prewarp) : Detector(config, prewarp) {
 
@@ -39,12 +70,36 @@ namespace alpr
       this->loaded = false;
       printf("--(!)Error loading CPU classifier %s\n", get_detector_file().c_str());
     }
+
+    detection_pool = NULL;
+    if (config->detectionThreads != 1)
+    {
+      detection_pool_mutex.lock();
+      if (shared_detection_pool == NULL)
+        shared_detection_pool = new WorkerPool(config->detectionThreads);
+      shared_detection_pool_users++;
+      detection_pool = shared_detection_pool;
+      detection_pool_mutex.unlock();
+    }
   }
 
 
   DetectorCPU::~DetectorCPU() {
-  }
+    for (unsigned int i = 0; i < idle_cascades.size(); i++)
+      delete idle_cascades[i];
 
+    if (detection_pool != NULL)
+    {
+      detection_pool_mutex.lock();
+      shared_detection_pool_users--;
+      if (shared_detection_pool_users == 0)
+      {
+        delete shared_detection_pool;
+        shared_detection_pool = NULL;
+      }
+      detection_pool_mutex.unlock();
+    }
+  }
 
 
   
@@ -59,10 +114,21 @@ namespace alpr
 
     equalizeHist( frame, frame );
     
-    plate_cascade.detectMultiScale( frame, plates, config->detection_iteration_increase, config->detectionStrictness,
-                                      CV_HAAR_DO_CANNY_PRUNING,
-                                      //0|CV_HAAR_SCALE_IMAGE,
-                                      min_plate_size, max_plate_size );
+    if (detection_pool == NULL)
+    {
+      plate_cascade.detectMultiScale( frame, plates, config->detection_iteration_increase, config->detectionStrictness,
+                                        CV_HAAR_DO_CANNY_PRUNING,
+                                        //0|CV_HAAR_SCALE_IMAGE,
+                                        min_plate_size, max_plate_size );
+    }
+    else
+    {
+      // Same search, with the scales and tiles spread over the detection threads
+      vector<Rect> regions(1, Rect(0, 0, frame.cols, frame.rows));
+      vector<Size> max_plate_sizes(1, max_plate_size);
+      plates = detect_scales(frame, regions, max_plate_sizes, min_plate_size)[0];
+      groupRectangles(plates, config->detectionStrictness, 0.2);
+    }
 
 
     if (config->debugTiming)
@@ -76,4 +142,331 @@ namespace alpr
 
   }
 
+
+  // Replaces every group of overlapping rectangles with their bounding rectangle
+  static vector<Rect> mergeOverlapping(vector<Rect> rects)
+  {
+    bool merged = true;
+    while (merged)
+    {
+      merged = false;
+      for (unsigned int i = 0; i < rects.size() && !merged; i++)
+      {
+        for (unsigned int j = i + 1; j < rects.size(); j++)
+        {
+          if ((rects[i] & rects[j]).area() > 0)
+          {
+            rects[i] = rects[i] | rects[j];
+            rects.erase(rects.begin() + j);
+            merged = true;
+            break;
+          }
+        }
+      }
+    }
+    return rects;
+  }
+
+  bool DetectorCPU::find_plates_in_regions(Mat frame, vector<Rect> regions, vector<vector<Rect> >& plates)
+  {
+    const double GROUP_EPS = 0.2;
+
+    timespec startTime;
+    getTimeMonotonic(&startTime);
+
+    plates.assign(regions.size(), vector<Rect>());
+
+    // The base image covers every region.  It is scaled and equalized once
+    Rect bounds = regions[0];
+    for (unsigned int i = 1; i < regions.size(); i++)
+      bounds = bounds | regions[i];
+
+    float scale_factor = computeScaleFactor(bounds.width, bounds.height);
+
+    Mat base;
+    if (scale_factor != 1.0)
+      resize(frame(bounds), base, Size(bounds.width * scale_factor, bounds.height * scale_factor));
+    else
+      frame(bounds).copyTo(base);
+
+    equalizeHist( base, base );
+
+    // The regions and their largest allowed plate, in base image coordinates
+    vector<Rect> base_regions;
+    vector<Size> max_plate_sizes;
+    for (unsigned int i = 0; i < regions.size(); i++)
+    {
+      Rect base_region((regions[i].x - bounds.x) * scale_factor, (regions[i].y - bounds.y) * scale_factor,
+                       regions[i].width * scale_factor, regions[i].height * scale_factor);
+      base_regions.push_back(base_region & Rect(0, 0, base.cols, base.rows));
+
+      max_plate_sizes.push_back(Size(base_regions[i].width * (config->maxPlateWidthPercent / 100.0f),
+                                     base_regions[i].height * (config->maxPlateHeightPercent / 100.0f)));
+    }
+
+    Size min_plate_size(config->minPlateSizeWidthPx, config->minPlateSizeHeightPx);
+    vector<vector<Rect> > candidates = detect_scales(base, base_regions, max_plate_sizes, min_plate_size);
+
+    for (unsigned int i = 0; i < regions.size(); i++)
+    {
+      groupRectangles(candidates[i], config->detectionStrictness, GROUP_EPS);
+
+      for (unsigned int j = 0; j < candidates[i].size(); j++)
+      {
+        Rect plate(candidates[i][j].x / scale_factor + bounds.x, candidates[i][j].y / scale_factor + bounds.y,
+                   candidates[i][j].width / scale_factor, candidates[i][j].height / scale_factor);
+        plates[i].push_back(plate & regions[i]);
+      }
+    }
+
+    if (config->debugTiming)
+    {
+      timespec endTime;
+      getTimeMonotonic(&endTime);
+      cout << "LBP Time (" << regions.size() << " regions): " << diffclock(startTime, endTime) << "ms." << endl;
+    }
+
+    return true;
+  }
+
+  vector<vector<Rect> > DetectorCPU::detect_scales(Mat base, vector<Rect> base_regions,
+                                                   vector<Size> max_plate_sizes, Size min_plate_size)
+  {
+    Size window = plate_cascade.getOriginalWindowSize();
+    int num_threads = detection_pool == NULL ? 1 : detection_pool->getNumThreads();
+
+    // Same scale steps as detectMultiScale: the window grows by detection_iteration_increase each
+    // iteration, which is done by shrinking the image instead
+    vector<double> factors;
+    vector<vector<Rect> > level_regions;
+    vector<vector<int> > level_region_ids;
+    for (double factor = 1; ; factor *= config->detection_iteration_increase)
+    {
+      Size window_size(cvRound(window.width * factor), cvRound(window.height * factor));
+      if (window_size.width > base.cols || window_size.height > base.rows)
+        break;
+      if (window_size.width < min_plate_size.width || window_size.height < min_plate_size.height)
+        continue;
+
+      Size level_size(cvRound(base.cols / factor), cvRound(base.rows / factor));
+
+      // The regions searched at this scale, in level coordinates
+      vector<Rect> regions;
+      vector<int> region_ids;
+      bool larger_scales = false;
+      for (unsigned int i = 0; i < base_regions.size(); i++)
+      {
+        if (window_size.width > max_plate_sizes[i].width || window_size.height > max_plate_sizes[i].height)
+          continue;
+        larger_scales = true;
+
+        Rect level_region(cvRound(base_regions[i].x / factor), cvRound(base_regions[i].y / factor),
+                          cvRound(base_regions[i].width / factor), cvRound(base_regions[i].height / factor));
+        level_region = level_region & Rect(0, 0, level_size.width, level_size.height);
+        if (level_region.width < window.width || level_region.height < window.height)
+          continue;
+
+        regions.push_back(level_region);
+        region_ids.push_back(i);
+      }
+
+      if (!larger_scales)
+        break;
+      if (regions.size() == 0)
+        continue;
+
+      factors.push_back(factor);
+      level_regions.push_back(regions);
+      level_region_ids.push_back(region_ids);
+    }
+
+    // Build the levels of the pyramid that are searched in bands.  detectMultiScale scales the base
+    // image itself for the levels above 2 (see below)
+    vector<ResizeLevelJob> resize_jobs(factors.size());
+    vector<void*> resize_args;
+    for (unsigned int l = 0; l < factors.size() && factors[l] <= 2.; l++)
+    {
+      resize_jobs[l].base = base;
+      resize_jobs[l].level_size = Size(cvRound(base.cols / factors[l]), cvRound(base.rows / factors[l]));
+      resize_args.push_back(&resize_jobs[l]);
+    }
+
+    if (detection_pool != NULL)
+      detection_pool->run(resizeLevelTask, resize_args);
+    else
+      for (unsigned int i = 0; i < resize_args.size(); i++)
+        resizeLevelTask(resize_args[i]);
+
+    // Overlapping regions are searched together, so no window is evaluated twice.  With several threads,
+    // each search area is also cut into horizontal bands of window positions.  A band's image overlaps
+    // the next by a window height, and it only keeps the windows that start inside the band, so every
+    // window is still evaluated exactly once
+    vector<CascadeJob> cascade_jobs;
+    vector<int> job_levels;
+    for (unsigned int l = 0; l < factors.size(); l++)
+    {
+      vector<Rect> search_areas = mergeOverlapping(level_regions[l]);
+      for (unsigned int a = 0; a < search_areas.size(); a++)
+      {
+        // detectMultiScale steps through windows one pixel at a time instead of two once the scale
+        // is above 2, which a single scale search of the level can't reproduce.  These levels are
+        // small, so each area is searched whole on the base image and detectMultiScale does the
+        // scaling itself
+        if (factors[l] > 2.)
+        {
+          Rect base_area;
+          for (unsigned int r = 0; r < level_regions[l].size(); r++)
+          {
+            if ((level_regions[l][r] & search_areas[a]) != level_regions[l][r])
+              continue;
+
+            const Rect& base_region = base_regions[level_region_ids[l][r]];
+            base_area = base_area.area() == 0 ? base_region : (base_area | base_region);
+          }
+
+          CascadeJob job;
+          job.detector = this;
+          job.image = base;
+          job.search_area = base_area;
+          job.first_row = 0;
+          job.last_row = base_area.height - 1;
+          job.window = Size(cvRound(window.width * factors[l]), cvRound(window.height * factors[l]));
+          job.scale_step = config->detection_iteration_increase;
+          job.full_scale = true;
+
+          cascade_jobs.push_back(job);
+          job_levels.push_back(l);
+          continue;
+        }
+
+        int positions = search_areas[a].height - window.height + 1;
+        int band_rows = max(window.height * 2, (positions + num_threads - 1) / num_threads);
+
+        // detectMultiScale steps through rows two at a time, so bands start on even rows
+        band_rows += band_rows % 2;
+
+        for (int first_row = 0; first_row < positions; first_row += band_rows)
+        {
+          CascadeJob job;
+          job.detector = this;
+          job.image = resize_jobs[l].level;
+          job.first_row = first_row;
+          job.last_row = min(first_row + band_rows, positions) - 1;
+          job.window = window;
+          job.scale_step = 1.1;
+          job.full_scale = false;
+
+          int band_height = job.last_row - first_row + window.height;
+          job.search_area = Rect(search_areas[a].x, search_areas[a].y + first_row, search_areas[a].width, band_height);
+
+          cascade_jobs.push_back(job);
+          job_levels.push_back(l);
+        }
+      }
+    }
+
+    vector<void*> cascade_args;
+    for (unsigned int j = 0; j < cascade_jobs.size(); j++)
+      cascade_args.push_back(&cascade_jobs[j]);
+
+    if (detection_pool != NULL)
+      detection_pool->run(cascadeTask, cascade_args);
+    else
+      for (unsigned int i = 0; i < cascade_args.size(); i++)
+        cascadeTask(cascade_args[i]);
+
+    // A window only counts for the regions that fully contain it, as if each region was searched alone
+    vector<vector<Rect> > candidates(base_regions.size());
+    for (unsigned int j = 0; j < cascade_jobs.size(); j++)
+    {
+      int l = job_levels[j];
+      Size window_size(cvRound(window.width * factors[l]), cvRound(window.height * factors[l]));
+
+      for (unsigned int h = 0; h < cascade_jobs[j].hits.size(); h++)
+      {
+        const Rect& hit = cascade_jobs[j].hits[h];
+
+        // Full scale hits are already in base image coordinates.  Their size is rounded from the level,
+        // so they may stick out of the search area by a pixel
+        if (cascade_jobs[j].full_scale)
+        {
+          Rect inside = hit & cascade_jobs[j].search_area;
+          for (unsigned int r = 0; r < level_regions[l].size(); r++)
+          {
+            if ((inside & base_regions[level_region_ids[l][r]]) == inside)
+              candidates[level_region_ids[l][r]].push_back(hit);
+          }
+          continue;
+        }
+
+        for (unsigned int r = 0; r < level_regions[l].size(); r++)
+        {
+          if ((hit & level_regions[l][r]) == hit)
+          {
+            candidates[level_region_ids[l][r]].push_back(Rect(cvRound(hit.x * factors[l]), cvRound(hit.y * factors[l]),
+                                                              window_size.width, window_size.height));
+          }
+        }
+      }
+    }
+
+    return candidates;
+  }
+
+  void DetectorCPU::resizeLevelTask(void* arg)
+  {
+    ResizeLevelJob* job = (ResizeLevelJob*) arg;
+
+    if (job->level_size == job->base.size())
+      job->level = job->base;
+    else
+      resize(job->base, job->level, job->level_size, 0, 0, INTER_LINEAR);
+  }
+
+  void DetectorCPU::cascadeTask(void* arg)
+  {
+    CascadeJob* job = (CascadeJob*) arg;
+
+    CascadeClassifier* cascade = job->detector->checkoutCascade();
+
+    // A single scale search with no grouping.  Grouping is done per region, over all scales
+    vector<Rect> hits;
+    cascade->detectMultiScale( job->image(job->search_area), hits, job->scale_step, 0, 0, job->window, job->window );
+
+    job->detector->returnCascade(cascade);
+
+    for (unsigned int h = 0; h < hits.size(); h++)
+    {
+      if (hits[h].y + job->first_row > job->last_row)
+        continue;
+
+      job->hits.push_back(Rect(hits[h].x + job->search_area.x, hits[h].y + job->search_area.y,
+                               hits[h].width, hits[h].height));
+    }
+  }
+
+  CascadeClassifier* DetectorCPU::checkoutCascade()
+  {
+    cascade_mutex.lock();
+    if (idle_cascades.size() > 0)
+    {
+      CascadeClassifier* cascade = idle_cascades.back();
+      idle_cascades.pop_back();
+      cascade_mutex.unlock();
+      return cascade;
+    }
+    cascade_mutex.unlock();
+
+    CascadeClassifier* cascade = new CascadeClassifier();
+    cascade->load( get_detector_file() );
+    return cascade;
+  }
+
+  void DetectorCPU::returnCascade(CascadeClassifier* cascade)
+  {
+    cascade_mutex.lock();
+    idle_cascades.push_back(cascade);
+    cascade_mutex.unlock();
+  }
+
 }
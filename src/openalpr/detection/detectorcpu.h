@@ -30,6 +30,8 @@
 #include "opencv2/ml/ml.hpp"
 
 #include "detector.h"
+#include "support/tinythread.h"
+#include "support/worker_pool.h"
 
 namespace alpr
 {
@@ -40,11 +42,33 @@ namespace alpr
       virtual ~DetectorCPU();
 
       std::vector<cv::Rect> find_plates(cv::Mat frame, cv::Size min_plate_size, cv::Size max_plate_size);
+
+      // Builds one image pyramid for all the regions and runs the cascade at each scale only
+      // on the windows inside them
+      bool find_plates_in_regions(cv::Mat frame, std::vector<cv::Rect> regions, std::vector<std::vector<cv::Rect> >& plates);
       
   private:
 
       cv::CascadeClassifier plate_cascade;
 
+      // Shared by every CPU detector when detection_threads is not 1, NULL otherwise
+      WorkerPool* detection_pool;
+
+      // A cascade keeps per-image state while it runs, so each concurrent task needs its own copy
+      std::vector<cv::CascadeClassifier*> idle_cascades;
+      tthread::mutex cascade_mutex;
+
+      cv::CascadeClassifier* checkoutCascade();
+      void returnCascade(cv::CascadeClassifier* cascade);
+
+      // Runs the cascade over every scale of the base image, limited to the regions.  Returns the
+      // ungrouped windows found for each region, in base image coordinates
+      std::vector<std::vector<cv::Rect> > detect_scales(cv::Mat base, std::vector<cv::Rect> base_regions,
+                                                        std::vector<cv::Size> max_plate_sizes, cv::Size min_plate_size);
+
+      static void resizeLevelTask(void* arg);
+      static void cascadeTask(void* arg);
+
   };
 
 }
@@ -32,7 +32,7 @@ namespace alpr
     resized_mask_loaded = false;
     this->config = config;
     this->prewarp = prewarp;
-    last_prewarp_hash = "";
+    last_prewarp_version = 0;
   }
 
   DetectorMask::~DetectorMask() {
@@ -50,7 +50,11 @@ namespace alpr
     if (orig_mask.channels() > 2)
       cvtColor( orig_mask, this->mask, CV_BGR2GRAY );
     else
-      this->mask = orig_mask;
+      this->mask = orig_mask.clone();
+
+    // Threshold the mask so that the values are either 0 or 255 (no shades of gray))
+    // This can happen with jpeg compression
+    threshold(this->mask, this->mask, 55, 255, cv::THRESH_BINARY);
     
     resized_mask_loaded = false;
     mask_loaded = true;
@@ -78,10 +82,19 @@ namespace alpr
     // If the mean pixel value over the crop is very white (e.g., > 253 out of 255)
     // then this is in the white area of the mask and we'll use it
     
+    if (mask_integral.empty())
+      return false;
+
     // Make sure the region doesn't extend beyond the bounds of our image
-    expandRect(region, 0, 0, resized_mask.cols, resized_mask.rows);
-    Mat mask_crop = resized_mask(region);
-    double mean_value = mean(mask_crop)[0];
+    region = region & Rect(0, 0, resized_mask.cols, resized_mask.rows);
+    if (region.area() <= 0)
+      return true;
+
+    int white_pixels = mask_integral.at<int>(region.y + region.height, region.x + region.width)
+                     - mask_integral.at<int>(region.y, region.x + region.width)
+                     - mask_integral.at<int>(region.y + region.height, region.x)
+                     + mask_integral.at<int>(region.y, region.x);
+    double mean_value = (255.0 * white_pixels) / region.area();
     
     if (config->debugDetector)
     {
@@ -96,27 +109,33 @@ namespace alpr
 
     if (prewarp->valid) 
     {
-      resized_mask = prewarp->warpImage(resized_mask);
+      // Warp with a copy, the shared prewarp may be in use by another recognition thread
+      PreWarp mask_prewarp(*prewarp);
+      resized_mask = mask_prewarp.warpImage(resized_mask);
     }
 
-    // Threshold the mask so that the values are either 0 or 255 (no shades of gray))
-    // This can happen with jpeg compression
-    threshold(this->mask, this->mask, 55, 255, cv::THRESH_BINARY);
+    // Resizing and warping blend the edges, so threshold again
+    threshold(resized_mask, resized_mask, 127, 255, cv::THRESH_BINARY);
+
+    Mat white_pixels;
+    threshold(resized_mask, white_pixels, 127, 1, cv::THRESH_BINARY);
+    integral(white_pixels, mask_integral, CV_32S);
      
-    // Calculate the biggest rectangle that covers all the whitespace
-    // Rather than using contours, go row by row, column by column until you hit
-    // a white pixel and stop.  Should be faster and a little simpler
+    // Calculate the biggest rectangle that covers all the whitespace.
+    // Rows and columns are checked for white pixels with the integral image
     int top_bound = 0, bottom_bound = 0, left_bound = 0, right_bound = 0;
+    int rows = resized_mask.rows;
+    int cols = resized_mask.cols;
     
-    for (top_bound = 0; top_bound < resized_mask.rows; top_bound++)
-      if (countNonZero(resized_mask.row(top_bound)) > 0) break;
-    for (bottom_bound = resized_mask.rows - 1; bottom_bound >= 0; bottom_bound--)
-      if (countNonZero(resized_mask.row(bottom_bound)) > 0) break;
+    for (top_bound = 0; top_bound < rows; top_bound++)
+      if (mask_integral.at<int>(top_bound + 1, cols) - mask_integral.at<int>(top_bound, cols) > 0) break;
+    for (bottom_bound = rows - 1; bottom_bound >= 0; bottom_bound--)
+      if (mask_integral.at<int>(bottom_bound + 1, cols) - mask_integral.at<int>(bottom_bound, cols) > 0) break;
     
-    for (left_bound = 0; left_bound < resized_mask.cols; left_bound++)
-      if (countNonZero(resized_mask.col(left_bound)) > 0) break;
-    for (right_bound = resized_mask.cols - 1; right_bound >= 0; right_bound--)
-      if (countNonZero(resized_mask.col(right_bound)) > 0) break;
+    for (left_bound = 0; left_bound < cols; left_bound++)
+      if (mask_integral.at<int>(rows, left_bound + 1) - mask_integral.at<int>(rows, left_bound) > 0) break;
+    for (right_bound = cols - 1; right_bound >= 0; right_bound--)
+      if (mask_integral.at<int>(rows, right_bound + 1) - mask_integral.at<int>(rows, right_bound) > 0) break;
     
     if (left_bound >= right_bound || top_bound >= bottom_bound)
     {
@@ -142,11 +161,11 @@ namespace alpr
       return image;
        
     if (!resized_mask_loaded || image.size() != resized_mask.size() || 
-            last_prewarp_hash != prewarp->toString())
+            last_prewarp_version != prewarp->getVersion())
     {
       resize_mask(image);
       
-      last_prewarp_hash = prewarp->toString();
+      last_prewarp_version = prewarp->getVersion();
       
       resized_mask_loaded = true;
     }
@@ -157,10 +176,10 @@ namespace alpr
       return image;
     }
     
-    Mat response = Mat::zeros(image.size(), image.type());
-    bitwise_and(image, resized_mask, response);
+    // Reuses the buffer from the previous frame when the size is unchanged
+    bitwise_and(image, resized_mask, masked_image);
     
-    return response;
+    return masked_image;
   }
 
-}
\ No newline at end of file
+}
@@ -42,6 +42,7 @@ namespace alpr
     
     bool region_is_masked(cv::Rect region);
     
+    // The returned image is a buffer owned by the mask, overwritten by the next call
     cv::Mat apply_mask(cv::Mat image);
     
     bool mask_loaded;
@@ -51,12 +52,17 @@ namespace alpr
     void resize_mask(cv::Mat image);
     
     PreWarp* prewarp;
-    std::string last_prewarp_hash;
+    unsigned int last_prewarp_version;
     
     cv::Mat mask;
     
     cv::Mat resized_mask;
     bool resized_mask_loaded;
+
+    // Integral image of the unmasked pixels (1 per white pixel), so any region can be checked in constant time
+    cv::Mat mask_integral;
+
+    cv::Mat masked_image;
     
     Config* config;
     cv::Rect scan_area;
@@ -0,0 +1,903 @@
+/*
+ * Copyright (c) 2015 OpenALPR Technology, Inc.
+ * Open source Automated License Plate Recognition [http://www.openalpr.com]
+ *
+ * This file is part of OpenALPR.
+ *
+ * OpenALPR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "json_reader.h"
+
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+using namespace std;
+
+namespace alpr
+{
+
+  // Deeper documents are rejected rather than risk running out of stack in skipValue()
+  const unsigned int MAX_JSON_DEPTH = 64;
+
+  static bool isDigit(char c)
+  {
+    return c >= '0' && c <= '9';
+  }
+
+  // Powers of ten that a double holds exactly
+  static const double EXACT_POWERS_OF_TEN[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+  JsonReader::JsonReader(const char* json, size_t length)
+  {
+    start = json;
+    pos = json;
+    end = json + length;
+    has_error = false;
+    error_offset = 0;
+  }
+
+  JsonValueType JsonReader::peek()
+  {
+    skipWhitespace();
+    if (has_error || pos >= end)
+      return JSON_INVALID;
+
+    switch (*pos)
+    {
+      case '{': return JSON_OBJECT;
+      case '[': return JSON_ARRAY;
+      case '"': return JSON_STRING;
+      case 't':
+      case 'f': return JSON_BOOL;
+      case 'n': return JSON_NULL;
+      case '-': return JSON_NUMBER;
+      default:  return isDigit(*pos) ? JSON_NUMBER : JSON_INVALID;
+    }
+  }
+
+  bool JsonReader::beginObject()
+  {
+    skipWhitespace();
+    if (!expect('{'))
+      return fail("Expected an object");
+    if (has_members.size() >= MAX_JSON_DEPTH)
+      return fail("Nested too deeply");
+
+    has_members.push_back(false);
+    return true;
+  }
+
+  bool JsonReader::nextMember(std::string& key)
+  {
+    if (!nextItem('}'))
+      return false;
+
+    if (peek() != JSON_STRING)
+      return fail("Expected a member name");
+    if (!readString(key))
+      return false;
+
+    skipWhitespace();
+    if (!expect(':'))
+      return fail("Expected ':' after the member name");
+
+    return true;
+  }
+
+  bool JsonReader::beginArray()
+  {
+    skipWhitespace();
+    if (!expect('['))
+      return fail("Expected an array");
+    if (has_members.size() >= MAX_JSON_DEPTH)
+      return fail("Nested too deeply");
+
+    has_members.push_back(false);
+    return true;
+  }
+
+  bool JsonReader::nextElement()
+  {
+    return nextItem(']');
+  }
+
+  bool JsonReader::nextItem(char close)
+  {
+    skipWhitespace();
+    if (has_error || has_members.size() == 0)
+      return false;
+
+    if (pos >= end)
+      return fail("Unexpected end of input");
+
+    if (*pos == close)
+    {
+      pos++;
+      has_members.pop_back();
+      return false;
+    }
+
+    if (has_members.back())
+    {
+      if (!expect(','))
+        return fail(std::string("Expected ',' or '") + close + "'");
+      skipWhitespace();
+    }
+
+    has_members.back() = true;
+    return true;
+  }
+
+  bool JsonReader::readNumber(double& value)
+  {
+    skipWhitespace();
+    if (has_error)
+      return false;
+
+    const char* p = pos;
+    double n = 0, sign = 1, scale = 0;
+    int subscale = 0, signsubscale = 1;
+
+    if (p < end && *p == '-')
+    {
+      sign = -1;
+      p++;
+    }
+
+    if (p >= end || !isDigit(*p))
+      return fail("Invalid number");
+
+    if (*p == '0')
+      p++;
+    else
+    {
+      while (p < end && isDigit(*p))
+        n = (n * 10.0) + (*p++ - '0');
+    }
+
+    if (p < end && *p == '.')
+    {
+      p++;
+      if (p >= end || !isDigit(*p))
+        return fail("Invalid number");
+
+      while (p < end && isDigit(*p))
+      {
+        n = (n * 10.0) + (*p++ - '0');
+        scale--;
+      }
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+      p++;
+      if (p < end && *p == '+')
+        p++;
+      else if (p < end && *p == '-')
+      {
+        signsubscale = -1;
+        p++;
+      }
+
+      if (p >= end || !isDigit(*p))
+        return fail("Invalid number");
+
+      while (p < end && isDigit(*p))
+      {
+        if (subscale < 100000)
+          subscale = (subscale * 10) + (*p - '0');
+        p++;
+      }
+    }
+
+    // Exponents up to 22 either way (which covers everything toJson writes) are applied with an
+    // exact power of ten rather than pow(), which is both slower and less precise
+    int exponent = scale + subscale * signsubscale;
+    if (exponent == 0)
+      value = sign * n;
+    else if (exponent < 0 && exponent >= -22)
+      value = sign * n / EXACT_POWERS_OF_TEN[-exponent];
+    else if (exponent > 0 && exponent <= 22)
+      value = sign * n * EXACT_POWERS_OF_TEN[exponent];
+    else
+      value = sign * n * pow(10.0, exponent);
+    pos = p;
+    return true;
+  }
+
+  bool JsonReader::readString(std::string& value)
+  {
+    skipWhitespace();
+    if (!expect('"'))
+      return fail("Expected a string");
+
+    value.clear();
+    while (true)
+    {
+      // Copy runs of plain characters in one go
+      const char* run_start = pos;
+      while (pos < end && *pos != '"' && *pos != '\\' && (unsigned char) *pos > 31)
+        pos++;
+      value.append(run_start, pos - run_start);
+
+      if (pos >= end)
+        return fail("Unterminated string");
+
+      if (*pos == '"')
+      {
+        pos++;
+        return true;
+      }
+
+      if (*pos != '\\')
+        return fail("Control character in string");
+
+      pos++;
+      if (pos >= end)
+        return fail("Unterminated string");
+
+      switch (*pos++)
+      {
+        case '"':  value += '"';  break;
+        case '\\': value += '\\'; break;
+        case '/':  value += '/';  break;
+        case 'b':  value += '\b'; break;
+        case 'f':  value += '\f'; break;
+        case 'n':  value += '\n'; break;
+        case 'r':  value += '\r'; break;
+        case 't':  value += '\t'; break;
+        case 'u':
+        {
+          unsigned int uc;
+          if (!readHex4(uc))
+            return false;
+
+          if (uc >= 0xDC00 && uc <= 0xDFFF)
+            return fail("Invalid unicode escape");
+
+          if (uc >= 0xD800 && uc <= 0xDBFF)
+          {
+            // A surrogate pair
+            unsigned int uc2;
+            if (end - pos < 2 || pos[0] != '\\' || pos[1] != 'u')
+              return fail("Invalid unicode escape");
+            pos += 2;
+            if (!readHex4(uc2))
+              return false;
+            if (uc2 < 0xDC00 || uc2 > 0xDFFF)
+              return fail("Invalid unicode escape");
+
+            uc = 0x10000 + (((uc & 0x3FF) << 10) | (uc2 & 0x3FF));
+          }
+
+          // Encode as UTF-8
+          if (uc < 0x80)
+            value += (char) uc;
+          else if (uc < 0x800)
+          {
+            value += (char) (0xC0 | (uc >> 6));
+            value += (char) (0x80 | (uc & 0x3F));
+          }
+          else if (uc < 0x10000)
+          {
+            value += (char) (0xE0 | (uc >> 12));
+            value += (char) (0x80 | ((uc >> 6) & 0x3F));
+            value += (char) (0x80 | (uc & 0x3F));
+          }
+          else
+          {
+            value += (char) (0xF0 | (uc >> 18));
+            value += (char) (0x80 | ((uc >> 12) & 0x3F));
+            value += (char) (0x80 | ((uc >> 6) & 0x3F));
+            value += (char) (0x80 | (uc & 0x3F));
+          }
+          break;
+        }
+        default:
+          pos--;
+          return fail("Invalid escape in string");
+      }
+    }
+  }
+
+  bool JsonReader::readHex4(unsigned int& value)
+  {
+    if (end - pos < 4)
+      return fail("Invalid unicode escape");
+
+    value = 0;
+    for (int i = 0; i < 4; i++)
+    {
+      char c = *pos;
+      value <<= 4;
+      if (c >= '0' && c <= '9')
+        value += c - '0';
+      else if (c >= 'A' && c <= 'F')
+        value += 10 + c - 'A';
+      else if (c >= 'a' && c <= 'f')
+        value += 10 + c - 'a';
+      else
+        return fail("Invalid unicode escape");
+      pos++;
+    }
+
+    return true;
+  }
+
+  bool JsonReader::readBool(bool& value)
+  {
+    skipWhitespace();
+    if (has_error)
+      return false;
+
+    if (end - pos >= 4 && strncmp(pos, "true", 4) == 0)
+    {
+      value = true;
+      pos += 4;
+      return true;
+    }
+    if (end - pos >= 5 && strncmp(pos, "false", 5) == 0)
+    {
+      value = false;
+      pos += 5;
+      return true;
+    }
+
+    return fail("Expected true or false");
+  }
+
+  bool JsonReader::skipValue()
+  {
+    switch (peek())
+    {
+      case JSON_NULL:
+        if (end - pos >= 4 && strncmp(pos, "null", 4) == 0)
+        {
+          pos += 4;
+          return true;
+        }
+        return fail("Invalid value");
+      case JSON_BOOL:
+      {
+        bool value;
+        return readBool(value);
+      }
+      case JSON_NUMBER:
+      {
+        double value;
+        return readNumber(value);
+      }
+      case JSON_STRING:
+        return readString(scratch);
+      case JSON_ARRAY:
+        if (!beginArray())
+          return false;
+        while (nextElement())
+          skipValue();
+        return !has_error;
+      case JSON_OBJECT:
+        if (!beginObject())
+          return false;
+        while (nextMember(scratch))
+          skipValue();
+        return !has_error;
+      default:
+        if (!has_error && pos >= end)
+          return fail("Unexpected end of input");
+        return fail("Invalid value");
+    }
+  }
+
+  bool JsonReader::finish()
+  {
+    skipWhitespace();
+    if (has_error)
+      return false;
+    if (pos != end)
+      return fail("Unexpected data after the document");
+
+    return true;
+  }
+
+  bool JsonReader::failed()
+  {
+    return has_error;
+  }
+
+  std::string JsonReader::error()
+  {
+    if (!has_error)
+      return "";
+
+    std::stringstream ss;
+    if (error_path.length() > 0)
+      ss << error_path << ": ";
+    ss << error_message << " (at offset " << error_offset << ")";
+    return ss.str();
+  }
+
+  bool JsonReader::fail(const std::string& message)
+  {
+    if (!has_error)
+    {
+      has_error = true;
+      error_message = message;
+      error_offset = pos - start;
+    }
+
+    return false;
+  }
+
+  bool JsonReader::addErrorContext(const std::string& name)
+  {
+    if (error_path.length() > 0 && error_path[0] != '[')
+      error_path = name + "." + error_path;
+    else
+      error_path = name + error_path;
+
+    return false;
+  }
+
+  void JsonReader::skipWhitespace()
+  {
+    while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r'))
+      pos++;
+  }
+
+  bool JsonReader::expect(char c)
+  {
+    if (has_error || pos >= end || *pos != c)
+      return false;
+
+    pos++;
+    return true;
+  }
+
+
+
+  // Field readers for the alpr_results schema.  A null value is treated the same as a missing field
+
+  static bool readNumberField(JsonReader& reader, const std::string& key, double& value, bool& found)
+  {
+    JsonValueType type = reader.peek();
+    if (type == JSON_NULL)
+      return reader.skipValue();
+    if (type != JSON_NUMBER)
+      return reader.fail("Field '" + key + "' must be a number");
+
+    found = true;
+    return reader.readNumber(value);
+  }
+
+  static bool readIntField(JsonReader& reader, const std::string& key, int& value, bool& found)
+  {
+    double number;
+    bool found_number = false;
+    if (!readNumberField(reader, key, number, found_number))
+      return false;
+
+    if (found_number)
+    {
+      value = (int) number;
+      found = true;
+    }
+    return true;
+  }
+
+  static bool readStringField(JsonReader& reader, const std::string& key, std::string& value)
+  {
+    JsonValueType type = reader.peek();
+    if (type == JSON_NULL)
+      return reader.skipValue();
+    if (type != JSON_STRING)
+      return reader.fail("Field '" + key + "' must be a string");
+
+    return reader.readString(value);
+  }
+
+  // Written as a number by toJson, but a boolean is accepted as well
+  static bool readFlagField(JsonReader& reader, const std::string& key, bool& value)
+  {
+    JsonValueType type = reader.peek();
+    if (type == JSON_BOOL)
+      return reader.readBool(value);
+
+    double number;
+    bool found = false;
+    if (!readNumberField(reader, key, number, found))
+      return false;
+    if (found)
+      value = number != 0;
+    return true;
+  }
+
+  static bool requireField(JsonReader& reader, bool found, const char* key)
+  {
+    if (!found)
+      return reader.fail(std::string("Missing required field '") + key + "'");
+    return true;
+  }
+
+  static std::string indexName(unsigned int index)
+  {
+    std::stringstream ss;
+    ss << "[" << index << "]";
+    return ss.str();
+  }
+
+  static bool parseRegionOfInterest(JsonReader& reader, std::string& key, AlprRegionOfInterest& roi)
+  {
+    bool found_x = false, found_y = false, found_width = false, found_height = false;
+
+    if (!reader.beginObject())
+      return false;
+    while (reader.nextMember(key))
+    {
+      if (key == "x")
+        readIntField(reader, key, roi.x, found_x);
+      else if (key == "y")
+        readIntField(reader, key, roi.y, found_y);
+      else if (key == "width")
+        readIntField(reader, key, roi.width, found_width);
+      else if (key == "height")
+        readIntField(reader, key, roi.height, found_height);
+      else
+        reader.skipValue();
+    }
+
+    return !reader.failed() &&
+        requireField(reader, found_x, "x") && requireField(reader, found_y, "y") &&
+        requireField(reader, found_width, "width") && requireField(reader, found_height, "height");
+  }
+
+  static bool parseCoordinate(JsonReader& reader, std::string& key, AlprCoordinate& coordinate)
+  {
+    bool found_x = false, found_y = false;
+
+    if (!reader.beginObject())
+      return false;
+    while (reader.nextMember(key))
+    {
+      if (key == "x")
+        readIntField(reader, key, coordinate.x, found_x);
+      else if (key == "y")
+        readIntField(reader, key, coordinate.y, found_y);
+      else
+        reader.skipValue();
+    }
+
+    return !reader.failed() && requireField(reader, found_x, "x") && requireField(reader, found_y, "y");
+  }
+
+  static bool parseCandidate(JsonReader& reader, std::string& key, AlprPlate& candidate)
+  {
+    bool found_plate = false;
+    double confidence = 0;
+    bool found_confidence = false;
+
+    candidate.characters.clear();
+    candidate.character_details.clear();
+    candidate.overall_confidence = 0;
+    candidate.matches_template = false;
+
+    if (!reader.beginObject())
+      return false;
+    while (reader.nextMember(key))
+    {
+      if (key == "plate")
+      {
+        found_plate = reader.peek() == JSON_STRING;
+        readStringField(reader, key, candidate.characters);
+      }
+      else if (key == "confidence")
+        readNumberField(reader, key, confidence, found_confidence);
+      else if (key == "matches_template")
+        readFlagField(reader, key, candidate.matches_template);
+      else
+        reader.skipValue();
+    }
+
+    candidate.overall_confidence = confidence;
+
+    return !reader.failed() && requireField(reader, found_plate, "plate");
+  }
+
+  static bool parsePlate(JsonReader& reader, std::string& key, AlprPlateResult& plate, unsigned int index)
+  {
+    // Optional fields keep these defaults.  The plate may be left over from an earlier document,
+    // in which case its strings and vectors are reused
+    plate.requested_topn = 0;
+    plate.country.clear();
+    plate.region.clear();
+    plate.bestPlate.characters.clear();
+    plate.bestPlate.character_details.clear();
+    plate.bestPlate.overall_confidence = 0;
+    plate.bestPlate.matches_template = false;
+    plate.processing_time_ms = 0;
+    plate.plate_index = index;
+    plate.regionConfidence = 0;
+    for (int i = 0; i < 4; i++)
+    {
+      plate.plate_points[i].x = 0;
+      plate.plate_points[i].y = 0;
+    }
+
+    AlprPlate best;
+    best.overall_confidence = 0;
+    best.matches_template = false;
+    bool found_best = false;
+    bool found_coordinates = false;
+    bool found = false;
+    double number;
+    unsigned int candidate_count = 0;
+
+    if (!reader.beginObject())
+      return false;
+    while (reader.nextMember(key))
+    {
+      if (key == "plate")
+      {
+        found_best = reader.peek() == JSON_STRING;
+        readStringField(reader, key, best.characters);
+      }
+      else if (key == "confidence")
+      {
+        if (readNumberField(reader, key, number, found) && found)
+          best.overall_confidence = number;
+      }
+      else if (key == "matches_template")
+        readFlagField(reader, key, best.matches_template);
+      else if (key == "plate_index")
+        readIntField(reader, key, plate.plate_index, found);
+      else if (key == "region")
+        readStringField(reader, key, plate.region);
+      else if (key == "region_confidence")
+        readIntField(reader, key, plate.regionConfidence, found);
+      else if (key == "processing_time_ms")
+      {
+        found = false;
+        if (readNumberField(reader, key, number, found) && found)
+          plate.processing_time_ms = number;
+      }
+      else if (key == "requested_topn")
+        readIntField(reader, key, plate.requested_topn, found);
+      else if (key == "country")
+        readStringField(reader, key, plate.country);
+      else if (key == "coordinates")
+      {
+        unsigned int count = 0;
+        if (!reader.beginArray())
+          return reader.addErrorContext("coordinates");
+        while (reader.nextElement())
+        {
+          if (count >= 4)
+          {
+            reader.fail("Expected 4 coordinates");
+            return reader.addErrorContext("coordinates");
+          }
+          if (!parseCoordinate(reader, key, plate.plate_points[count]))
+          {
+            reader.addErrorContext(indexName(count));
+            return reader.addErrorContext("coordinates");
+          }
+          count++;
+        }
+        if (!reader.failed() && count != 4)
+        {
+          reader.fail("Expected 4 coordinates");
+          return reader.addErrorContext("coordinates");
+        }
+        found_coordinates = true;
+      }
+      else if (key == "candidates")
+      {
+        if (!reader.beginArray())
+          return reader.addErrorContext("candidates");
+        while (reader.nextElement())
+        {
+          if (candidate_count == plate.topNPlates.size())
+            plate.topNPlates.push_back(AlprPlate());
+          if (!parseCandidate(reader, key, plate.topNPlates[candidate_count]))
+          {
+            reader.addErrorContext(indexName(candidate_count));
+            return reader.addErrorContext("candidates");
+          }
+          candidate_count++;
+        }
+      }
+      else
+        reader.skipValue();
+    }
+
+    plate.topNPlates.resize(candidate_count);
+
+    if (reader.failed() || !requireField(reader, found_coordinates, "coordinates"))
+      return false;
+
+    // The best plate is the first candidate.  Without candidates, fall back on the plate's own fields
+    if (plate.topNPlates.size() > 0)
+      plate.bestPlate = plate.topNPlates[0];
+    else if (found_best)
+      plate.bestPlate = best;
+
+    return true;
+  }
+
+  bool parseAlprResults(const char* json, size_t length, AlprResults& results, std::string& error)
+  {
+    JsonReader reader(json, length);
+    std::string key;
+    std::string data_type;
+
+    // Reuse the plates already in results, so reading many documents into the same
+    // results does not allocate them again each time
+    unsigned int plate_count = 0;
+    results.regionsOfInterest.clear();
+    results.frame_number = -1;
+    results.epoch_time = 0;
+    results.img_width = 0;
+    results.img_height = 0;
+    results.total_processing_time_ms = 0;
+
+    bool found_epoch = false, found_width = false, found_height = false, found_results = false;
+    bool found = false;
+    double number;
+
+    if (reader.beginObject())
+    {
+      while (reader.nextMember(key))
+      {
+        if (key == "data_type")
+        {
+          if (readStringField(reader, key, data_type) && data_type.length() > 0 && data_type != "alpr_results")
+            reader.fail("Expected an alpr_results document, not " + data_type);
+        }
+        else if (key == "epoch_time")
+        {
+          if (readNumberField(reader, key, number, found_epoch) && found_epoch)
+            results.epoch_time = (int64_t) number;
+        }
+        else if (key == "img_width")
+          readIntField(reader, key, results.img_width, found_width);
+        else if (key == "img_height")
+          readIntField(reader, key, results.img_height, found_height);
+        else if (key == "processing_time_ms")
+        {
+          found = false;
+          if (readNumberField(reader, key, number, found) && found)
+            results.total_processing_time_ms = number;
+        }
+        else if (key == "regions_of_interest")
+        {
+          if (reader.peek() == JSON_NULL)
+          {
+            reader.skipValue();
+            continue;
+          }
+          if (!reader.beginArray())
+          {
+            reader.addErrorContext("regions_of_interest");
+            break;
+          }
+          while (reader.nextElement())
+          {
+            AlprRegionOfInterest roi(0, 0, 0, 0);
+            if (!parseRegionOfInterest(reader, key, roi))
+            {
+              reader.addErrorContext(indexName(results.regionsOfInterest.size()));
+              reader.addErrorContext("regions_of_interest");
+              break;
+            }
+            results.regionsOfInterest.push_back(roi);
+          }
+        }
+        else if (key == "results")
+        {
+          if (!reader.beginArray())
+          {
+            reader.addErrorContext("results");
+            break;
+          }
+          while (reader.nextElement())
+          {
+            if (plate_count == results.plates.size())
+              results.plates.push_back(AlprPlateResult());
+            if (!parsePlate(reader, key, results.plates[plate_count], plate_count))
+            {
+              reader.addErrorContext(indexName(plate_count));
+              reader.addErrorContext("results");
+              break;
+            }
+            plate_count++;
+          }
+          found_results = true;
+        }
+        else
+          reader.skipValue();
+      }
+    }
+
+    results.plates.resize(plate_count);
+
+    bool success = !reader.failed() &&
+        requireField(reader, found_epoch, "epoch_time") &&
+        requireField(reader, found_width, "img_width") &&
+        requireField(reader, found_height, "img_height") &&
+        requireField(reader, found_results, "results") &&
+        reader.finish();
+
+    error = reader.error();
+    return success;
+  }
+
+
+
+  AlprJsonLinesReader::AlprJsonLinesReader(std::istream& input) : input(input)
+  {
+    line_number = 0;
+    error_count = 0;
+    bytes_read = 0;
+  }
+
+  bool AlprJsonLinesReader::next(AlprResults& results)
+  {
+    std::string error;
+
+    while (std::getline(input, line))
+    {
+      line_number++;
+      bytes_read += line.length() + 1;
+
+      size_t length = line.length();
+      if (length > 0 && line[length - 1] == '\r')
+        length--;
+
+      if (line.find_first_not_of(" \t\r") == std::string::npos)
+        continue;
+
+      if (parseAlprResults(line.data(), length, results, error))
+        return true;
+
+      error_count++;
+      std::stringstream ss;
+      ss << "line " << line_number << ": " << error;
+      last_error = ss.str();
+    }
+
+    return false;
+  }
+
+  int64_t AlprJsonLinesReader::lineNumber()
+  {
+    return line_number;
+  }
+
+  int64_t AlprJsonLinesReader::errorCount()
+  {
+    return error_count;
+  }
+
+  int64_t AlprJsonLinesReader::bytesRead()
+  {
+    return bytes_read;
+  }
+
+  std::string AlprJsonLinesReader::lastError()
+  {
+    return last_error;
+  }
+
+}
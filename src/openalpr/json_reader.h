@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2015 OpenALPR Technology, Inc.
+ * Open source Automated License Plate Recognition [http://www.openalpr.com]
+ *
+ * This file is part of OpenALPR.
+ *
+ * OpenALPR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPENALPR_JSONREADER_H
+#define OPENALPR_JSONREADER_H
+
+#include <string>
+#include <vector>
+
+#include "alpr.h"
+
+namespace alpr
+{
+
+  enum JsonValueType
+  {
+    JSON_NULL,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT,
+    JSON_INVALID
+  };
+
+  // Reads a JSON document in a single pass, one value at a time, without building a tree.
+  // Every method returns false once the input is found to be invalid.  error() then describes
+  // the first problem and the byte offset where it was found
+  class JsonReader
+  {
+    public:
+      JsonReader(const char* json, size_t length);
+
+      // The type of the next value, judged from its first character
+      JsonValueType peek();
+
+      bool beginObject();
+      // Reads the key of the next member.  Returns false at the end of the object
+      bool nextMember(std::string& key);
+
+      bool beginArray();
+      // Returns false at the end of the array
+      bool nextElement();
+
+      bool readNumber(double& value);
+      bool readString(std::string& value);
+      bool readBool(bool& value);
+      bool skipValue();
+
+      // Checks that nothing but whitespace follows the document
+      bool finish();
+
+      bool failed();
+      std::string error();
+
+      // Records an error found by the caller (e.g., a missing field), unless one was already recorded
+      bool fail(const std::string& message);
+
+      // Prepends the name of an enclosing field or array index to the location of the error,
+      // so it reads like "results[2].coordinates".  Always returns false
+      bool addErrorContext(const std::string& name);
+
+    private:
+      const char* start;
+      const char* pos;
+      const char* end;
+
+      // For every open object or array, whether a member has been read yet
+      std::vector<bool> has_members;
+
+      bool has_error;
+      std::string error_message;
+      std::string error_path;
+      size_t error_offset;
+
+      // Holds the strings and keys of skipped values
+      std::string scratch;
+
+      void skipWhitespace();
+      bool expect(char c);
+      bool nextItem(char close);
+      bool readHex4(unsigned int& value);
+  };
+
+  // Parses an alpr_results document into results.  Returns false, with a description of the
+  // problem in error, if the JSON is malformed, a required field is missing or a field has the wrong type
+  bool parseAlprResults(const char* json, size_t length, AlprResults& results, std::string& error);
+
+}
+
+#endif // OPENALPR_JSONREADER_H
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2015 OpenALPR Technology, Inc.
+ * Open source Automated License Plate Recognition [http://www.openalpr.com]
+ *
+ * This file is part of OpenALPR.
+ *
+ * OpenALPR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "json_writer.h"
+
+#include <cfloat>
+#include <climits>
+#include <clocale>
+#include <cmath>
+#include <cstdio>
+
+namespace alpr
+{
+
+  JsonWriter::JsonWriter(std::string& output) : output(output)
+  {
+    depth = 0;
+  }
+
+  void JsonWriter::beginObject()
+  {
+    separator();
+    output += '{';
+    depth++;
+  }
+
+  void JsonWriter::beginObject(const char* key)
+  {
+    writeKey(key);
+    output += '{';
+    depth++;
+  }
+
+  void JsonWriter::endObject()
+  {
+    output += '}';
+    depth--;
+  }
+
+  void JsonWriter::beginArray(const char* key)
+  {
+    writeKey(key);
+    output += '[';
+    depth++;
+  }
+
+  void JsonWriter::endArray()
+  {
+    output += ']';
+    depth--;
+  }
+
+  void JsonWriter::addString(const char* key, const std::string& value)
+  {
+    writeKey(key);
+    appendString(output, value);
+  }
+
+  void JsonWriter::addNumber(const char* key, double value)
+  {
+    writeKey(key);
+    appendNumber(output, value);
+  }
+
+  void JsonWriter::addRaw(const char* key, const std::string& json)
+  {
+    writeKey(key);
+    output += json;
+  }
+
+  void JsonWriter::separator()
+  {
+    // Nothing precedes the first member of an object or array.  At the top level
+    // the caller decides what goes between documents
+    if (depth == 0)
+      return;
+
+    char last = output[output.length() - 1];
+    if (last != '{' && last != '[')
+      output += ',';
+  }
+
+  void JsonWriter::writeKey(const char* key)
+  {
+    separator();
+    appendString(output, key);
+    output += ':';
+  }
+
+  void JsonWriter::appendString(std::string& output, const std::string& value)
+  {
+    output += '"';
+
+    // Copy runs of characters that need no escaping in one go
+    size_t run_start = 0;
+    for (size_t i = 0; i < value.length(); i++)
+    {
+      unsigned char c = value[i];
+      if (c > 31 && c != '"' && c != '\\')
+        continue;
+
+      output.append(value, run_start, i - run_start);
+      run_start = i + 1;
+
+      switch (c)
+      {
+        case '\\': output += "\\\\"; break;
+        case '"':  output += "\\\""; break;
+        case '\b': output += "\\b";  break;
+        case '\f': output += "\\f";  break;
+        case '\n': output += "\\n";  break;
+        case '\r': output += "\\r";  break;
+        case '\t': output += "\\t";  break;
+        default:
+        {
+          char escaped[8];
+          sprintf(escaped, "\\u%04x", c);
+          output += escaped;
+          break;
+        }
+      }
+    }
+    output.append(value, run_start, std::string::npos);
+
+    output += '"';
+  }
+
+  void JsonWriter::appendNumber(std::string& output, double value)
+  {
+    char buffer[64];
+
+    // Same rules as cJSON: integral values in the int range are written as integers
+    if (value <= INT_MAX && value >= INT_MIN && fabs(((double) (int) value) - value) <= DBL_EPSILON)
+    {
+      sprintf(buffer, "%d", (int) value);
+      output += buffer;
+      return;
+    }
+
+    if (fabs(floor(value) - value) <= DBL_EPSILON && fabs(value) < 1.0e60)
+      sprintf(buffer, "%.0f", value);
+    else if (fabs(value) < 1.0e-6 || fabs(value) > 1.0e9)
+      sprintf(buffer, "%e", value);
+    else
+      sprintf(buffer, "%f", value);
+
+    // cJSON switches to the C locale while printing.  Changing the locale is not thread safe,
+    // so fix up the decimal point afterwards instead
+    char decimal_point = localeconv()->decimal_point[0];
+    if (decimal_point != '.')
+    {
+      for (char* c = buffer; *c != '\0'; c++)
+      {
+        if (*c == decimal_point)
+          *c = '.';
+      }
+    }
+
+    output += buffer;
+  }
+
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2015 OpenALPR Technology, Inc.
+ * Open source Automated License Plate Recognition [http://www.openalpr.com]
+ *
+ * This file is part of OpenALPR.
+ *
+ * OpenALPR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPENALPR_JSONWRITER_H
+#define OPENALPR_JSONWRITER_H
+
+#include <string>
+
+namespace alpr
+{
+
+  // Writes JSON directly to the end of a string, without building a tree first.
+  // Numbers and strings are formatted exactly as cJSON_PrintUnformatted would.
+  // Commas are inserted automatically between the members of an object or array
+  class JsonWriter
+  {
+    public:
+      JsonWriter(std::string& output);
+
+      // Without a key, for array elements and the top level object
+      void beginObject();
+      void beginObject(const char* key);
+      void endObject();
+
+      void beginArray(const char* key);
+      void endArray();
+
+      void addString(const char* key, const std::string& value);
+      void addNumber(const char* key, double value);
+
+      // The value must already be valid JSON
+      void addRaw(const char* key, const std::string& json);
+
+      static void appendString(std::string& output, const std::string& value);
+      static void appendNumber(std::string& output, double value);
+
+    private:
+      std::string& output;
+      int depth;
+
+      void separator();
+      void writeKey(const char* key);
+  };
+
+}
+
+#endif // OPENALPR_JSONWRITER_H
@@ -22,6 +22,7 @@
 #include "licenseplatecandidate.h"
 #include "edges/edgefinder.h"
 #include "transformation.h"
+#include "pipeline_statistics.h"
 
 using namespace std;
 using namespace cv;
@@ -53,8 +54,16 @@ namespace alpr
     resize(pipeline_data->crop_gray, pipeline_data->crop_gray, Size(config->templateWidthPx, config->templateHeightPx));
 
 
+    timespec analysisStartTime;
+    getTimeMonotonic(&analysisStartTime);
+
     CharacterAnalysis textAnalysis(pipeline_data);
 
+    timespec edgesStartTime;
+    getTimeMonotonic(&edgesStartTime);
+    if (config->statistics != NULL)
+      config->statistics->recordStage(STAGE_CHARACTER_ANALYSIS, diffclock(analysisStartTime, edgesStartTime));
+
     if (pipeline_data->disqualified)
       return;
 
@@ -62,11 +71,13 @@ namespace alpr
 
     pipeline_data->plate_corners = edgeFinder.findEdgeCorners();
 
-    if (pipeline_data->disqualified)
-      return;
-
     timespec startTime;
     getTimeMonotonic(&startTime);
+    if (config->statistics != NULL)
+      config->statistics->recordStage(STAGE_EDGE_FINDING, diffclock(edgesStartTime, startTime));
+
+    if (pipeline_data->disqualified)
+      return;
 
 
     // Compute the transformation matrix to go from the current image to the new plate corners
@@ -127,10 +138,13 @@ namespace alpr
 
 
 
+    timespec endTime;
+    getTimeMonotonic(&endTime);
+    if (config->statistics != NULL)
+      config->statistics->recordStage(STAGE_DESKEW, diffclock(startTime, endTime));
+
     if (config->debugTiming)
     {
-      timespec endTime;
-      getTimeMonotonic(&endTime);
       cout << "deskew Time: " << diffclock(startTime, endTime) << "ms." << endl;
     }
 
@@ -32,12 +32,26 @@ void MotionDetector::ResetMotionDetection(cv::Mat* frame)
 
 cv::Rect MotionDetector::MotionDetect(cv::Mat* frame)
 //Detect motion and create ONE recangle that contains all the detected motion
+{
+	std::vector<cv::Rect> rects = MotionDetectRegions(frame, 0, cv::Size(0, 0));
+
+	cv::Rect largest_rect(0, 0, 0, 0);
+	if (rects.size() > 0)
+	{
+		// Determine the overall area with motion.
+		largest_rect = rects[0];
+		for (int i = 1; i < rects.size(); i++)
+			largest_rect |= rects[i];
+	}
+
+	return largest_rect;
+}
+
+std::vector<cv::Rect> MotionDetector::MotionDetectRegions(cv::Mat* frame, int padding, cv::Size minSize)
 {
 	std::vector<std::vector<cv::Point> > contours;
 	std::vector<cv::Vec4i> hierarchy;
-	cv::Rect bounding_rect;
 	std::vector<cv::Rect> rects;
-	cv::Rect largest_rect, rect_temp;
 
 	// Detect motion
 
@@ -50,38 +64,51 @@ cv::Rect MotionDetector::MotionDetect(cv::Mat* frame)
 
 	//Remove noise
 	cv::erode(fgMaskMOG2, fgMaskMOG2, getStructuringElement(cv::MORPH_RECT, cv::Size(6, 6)));
-	// Find the contours of motion areas in the image
-	findContours(fgMaskMOG2, contours, hierarchy, CV_RETR_LIST, CV_CHAIN_APPROX_SIMPLE);
-	// Find the bounding rectangles of the areas of motion
-	if (contours.size() > 0)
+	// Find the contours of motion areas in the image.  findContours modifies its input,
+	// which is fine since the mask is regenerated on every frame
+	findContours(fgMaskMOG2, contours, hierarchy, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE);
+
+	// Find the padded bounding rectangles of the areas of motion
+	int min_area = (minSize.width * minSize.height) / 4;
+	for (int i = 0; i < contours.size(); i++)
 	{
-		for (int i = 0; i < contours.size(); i++)
-		{
-			bounding_rect = boundingRect(contours[i]);
-			rects.push_back(bounding_rect);
-		}
-		// Determine the overall area with motion.
-		largest_rect = rects[0];
-		for (int i = 1; i < rects.size(); i++)
+		cv::Rect bounding_rect = boundingRect(contours[i]);
+		if (bounding_rect.area() < min_area)
+			continue;
+
+		rects.push_back(expandRect(bounding_rect, padding * 2, padding * 2, frame->cols, frame->rows));
+	}
+
+	// Merge areas that touch until none of them do
+	bool merged = true;
+	while (merged)
+	{
+		merged = false;
+		for (int i = 0; i < rects.size() && !merged; i++)
 		{
-			rect_temp.x = min(largest_rect.x,rects[i].x);
-			rect_temp.y = min(largest_rect.y,rects[i].y);
-			rect_temp.width = max(largest_rect.x + largest_rect.width, rects[i].x + rects[i].width)-rect_temp.x;
-			rect_temp.height = max(largest_rect.y + largest_rect.height, rects[i].y + rects[i].height) - rect_temp.y;
-			largest_rect = rect_temp;
+			for (int j = i + 1; j < rects.size(); j++)
+			{
+				if ((rects[i] & rects[j]).area() > 0)
+				{
+					rects[i] |= rects[j];
+					rects.erase(rects.begin() + j);
+					merged = true;
+					break;
+				}
+			}
 		}
-		rectangle(*frame, rect_temp, cv::Scalar(0, 255, 0), 1, 8, 0);
 	}
-	else
-        {
-          largest_rect.x = 0;
-          largest_rect.y = 0;
-          largest_rect.width = 0;
-          largest_rect.height = 0;
-        }
-		
-//	imshow("Motion detect", fgMaskMOG2);
-	return expandRect(largest_rect, 0, 0, frame->cols, frame->rows);
+
+	// Grow areas that are too small to contain a plate around their center
+	for (int i = 0; i < rects.size(); i++)
+	{
+		int grow_x = std::max(0, minSize.width - rects[i].width);
+		int grow_y = std::max(0, minSize.height - rects[i].height);
+		if (grow_x > 0 || grow_y > 0)
+			rects[i] = expandRect(rects[i], grow_x, grow_y, frame->cols, frame->rows);
+	}
+
+	return rects;
 }
 
-}
\ No newline at end of file
+}
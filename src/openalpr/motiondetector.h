@@ -16,7 +16,14 @@ namespace alpr
           virtual ~MotionDetector();
 
           void ResetMotionDetection(cv::Mat* frame);
+
+          // Returns ONE rectangle that contains all of the detected motion (empty if there is none)
           cv::Rect MotionDetect(cv::Mat* frame);
+
+          // Returns a rectangle for each separate area of motion.  Each area is padded by padding pixels,
+          // areas that touch are merged, and every rectangle is at least minSize (clipped to the frame).
+          // Motion smaller than a quarter of minSize is ignored as noise.  Empty if nothing moved
+          std::vector<cv::Rect> MotionDetectRegions(cv::Mat* frame, int padding, cv::Size minSize);
   };
 }
 
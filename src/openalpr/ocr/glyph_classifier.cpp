@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2015 OpenALPR Technology, Inc.
+ * Open source Automated License Plate Recognition [http://www.openalpr.com]
+ *
+ * This file is part of OpenALPR.
+ *
+ * OpenALPR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "glyph_classifier.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace std;
+using namespace cv;
+
+namespace alpr
+{
+
+  // Glyph file layout, all values 32 bit in native byte order:
+  //   magic, version, glyph width, glyph height, letter count, glyph count
+  //   per letter: length, utf8 bytes
+  //   per glyph:  letter index, GLYPH_WORDS 64 bit words
+  const uint32_t GLYPH_FILE_MAGIC = 0x4C47414F; // "OAGL"
+  const uint32_t GLYPH_FILE_VERSION = 1;
+
+  // Number of nearest glyphs that vote for the letter choices
+  const int NEAREST_GLYPHS = 9;
+
+  static inline int popcount64(uint64_t value)
+  {
+#if defined(__GNUC__)
+    return __builtin_popcountll(value);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return (int) __popcnt64(value);
+#else
+    value = value - ((value >> 1) & 0x5555555555555555ULL);
+    value = (value & 0x3333333333333333ULL) + ((value >> 2) & 0x3333333333333333ULL);
+    value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int) ((value * 0x0101010101010101ULL) >> 56);
+#endif
+  }
+
+  GlyphClassifier::GlyphClassifier()
+  {
+  }
+
+  GlyphClassifier::~GlyphClassifier()
+  {
+  }
+
+  bool GlyphClassifier::isLoaded()
+  {
+    return glyph_letters.size() > 0;
+  }
+
+  int GlyphClassifier::numGlyphs()
+  {
+    return glyph_letters.size();
+  }
+
+  bool GlyphClassifier::load(std::string filename)
+  {
+    ifstream infile(filename.c_str(), ios::in | ios::binary);
+    if (!infile.is_open())
+      return false;
+
+    uint32_t header[6];
+    infile.read((char*) header, sizeof(header));
+    if (infile.fail() || header[0] != GLYPH_FILE_MAGIC || header[1] != GLYPH_FILE_VERSION ||
+        header[2] != (uint32_t) GLYPH_WIDTH || header[3] != (uint32_t) GLYPH_HEIGHT)
+      return false;
+
+    vector<string> file_letters;
+    for (uint32_t i = 0; i < header[4]; i++)
+    {
+      uint32_t length;
+      infile.read((char*) &length, sizeof(length));
+      if (infile.fail() || length > 16)
+        return false;
+
+      char buffer[16];
+      infile.read(buffer, length);
+      file_letters.push_back(string(buffer, length));
+    }
+
+    vector<uint64_t> file_bits(header[5] * GLYPH_WORDS);
+    vector<int> file_glyph_letters(header[5]);
+    for (uint32_t i = 0; i < header[5]; i++)
+    {
+      uint32_t letter_index;
+      infile.read((char*) &letter_index, sizeof(letter_index));
+      infile.read((char*) &file_bits[i * GLYPH_WORDS], GLYPH_WORDS * sizeof(uint64_t));
+      if (infile.fail() || letter_index >= file_letters.size())
+        return false;
+
+      file_glyph_letters[i] = letter_index;
+    }
+
+    letters = file_letters;
+    glyph_bits = file_bits;
+    glyph_letters = file_glyph_letters;
+
+    return true;
+  }
+
+  bool GlyphClassifier::save(std::string filename)
+  {
+    ofstream outfile(filename.c_str(), ios::out | ios::binary | ios::trunc);
+    if (!outfile.is_open())
+      return false;
+
+    uint32_t header[6];
+    header[0] = GLYPH_FILE_MAGIC;
+    header[1] = GLYPH_FILE_VERSION;
+    header[2] = GLYPH_WIDTH;
+    header[3] = GLYPH_HEIGHT;
+    header[4] = letters.size();
+    header[5] = glyph_letters.size();
+    outfile.write((const char*) header, sizeof(header));
+
+    for (unsigned int i = 0; i < letters.size(); i++)
+    {
+      uint32_t length = letters[i].length();
+      outfile.write((const char*) &length, sizeof(length));
+      outfile.write(letters[i].c_str(), length);
+    }
+
+    for (unsigned int i = 0; i < glyph_letters.size(); i++)
+    {
+      uint32_t letter_index = glyph_letters[i];
+      outfile.write((const char*) &letter_index, sizeof(letter_index));
+      outfile.write((const char*) &glyph_bits[i * GLYPH_WORDS], GLYPH_WORDS * sizeof(uint64_t));
+    }
+
+    outfile.close();
+    return !outfile.fail();
+  }
+
+  bool GlyphClassifier::addGlyph(std::string letter, cv::Mat character_image)
+  {
+    uint64_t bits[GLYPH_WORDS];
+    if (!pack(character_image, bits))
+      return false;
+
+    glyph_bits.insert(glyph_bits.end(), bits, bits + GLYPH_WORDS);
+    glyph_letters.push_back(letterIndex(letter));
+
+    return true;
+  }
+
+  std::vector<GlyphChoice> GlyphClassifier::classify(cv::Mat character_image, int max_choices)
+  {
+    vector<GlyphChoice> choices;
+
+    uint64_t bits[GLYPH_WORDS];
+    if (glyph_letters.size() == 0 || !pack(character_image, bits))
+      return choices;
+
+    // Distance to every stored glyph, paired with the glyph index
+    vector<pair<int, int> > distances(glyph_letters.size());
+    const uint64_t* glyph = &glyph_bits[0];
+    for (unsigned int i = 0; i < glyph_letters.size(); i++, glyph += GLYPH_WORDS)
+    {
+      int distance = 0;
+      for (int w = 0; w < GLYPH_WORDS; w++)
+        distance += popcount64(bits[w] ^ glyph[w]);
+
+      distances[i] = make_pair(distance, (int) i);
+    }
+
+    int nearest = min((int) distances.size(), NEAREST_GLYPHS);
+    partial_sort(distances.begin(), distances.begin() + nearest, distances.end());
+
+    // Each letter among the nearest glyphs is scored by its closest glyph.  Identical glyphs score
+    // 100 and glyphs that agree on no more pixels than chance score 0
+    const float TOTAL_BITS = GLYPH_WIDTH * GLYPH_HEIGHT;
+    vector<bool> letter_used(letters.size(), false);
+    for (int i = 0; i < nearest && (int) choices.size() < max_choices; i++)
+    {
+      int letter_index = glyph_letters[distances[i].second];
+      if (letter_used[letter_index])
+        continue;
+      letter_used[letter_index] = true;
+
+      GlyphChoice choice;
+      choice.letter = letters[letter_index];
+      choice.confidence = max(0.0f, 1.0f - (2.0f * distances[i].first) / TOTAL_BITS) * 100;
+      choices.push_back(choice);
+    }
+
+    return choices;
+  }
+
+  bool GlyphClassifier::pack(cv::Mat character_image, uint64_t* bits)
+  {
+    Mat gray = character_image;
+    if (gray.channels() > 1)
+      cvtColor(character_image, gray, CV_BGR2GRAY);
+
+    Mat ink = gray > 127;
+    vector<Point> ink_points;
+    findNonZero(ink, ink_points);
+    if (ink_points.size() == 0)
+      return false;
+
+    // Scale the ink to fit the cell without changing its aspect ratio, so narrow characters like 1 and I stay narrow
+    Rect ink_box = boundingRect(ink_points);
+    float scale = min(((float) GLYPH_WIDTH) / ink_box.width, ((float) GLYPH_HEIGHT) / ink_box.height);
+    int scaled_width = max(1, min(GLYPH_WIDTH, (int) (ink_box.width * scale + 0.5)));
+    int scaled_height = max(1, min(GLYPH_HEIGHT, (int) (ink_box.height * scale + 0.5)));
+
+    Mat cell = Mat::zeros(GLYPH_HEIGHT, GLYPH_WIDTH, CV_8U);
+    Rect cell_box((GLYPH_WIDTH - scaled_width) / 2, (GLYPH_HEIGHT - scaled_height) / 2, scaled_width, scaled_height);
+    Mat scaled;
+    resize(gray(ink_box), scaled, Size(scaled_width, scaled_height), 0, 0, INTER_AREA);
+    scaled.copyTo(cell(cell_box));
+
+    for (int w = 0; w < GLYPH_WORDS; w++)
+      bits[w] = 0;
+
+    for (int y = 0; y < GLYPH_HEIGHT; y++)
+    {
+      const uchar* row = cell.ptr<uchar>(y);
+      for (int x = 0; x < GLYPH_WIDTH; x++)
+      {
+        if (row[x] > 127)
+        {
+          int bit = y * GLYPH_WIDTH + x;
+          bits[bit / 64] |= ((uint64_t) 1) << (bit % 64);
+        }
+      }
+    }
+
+    return true;
+  }
+
+  int GlyphClassifier::letterIndex(std::string letter)
+  {
+    for (unsigned int i = 0; i < letters.size(); i++)
+    {
+      if (letters[i] == letter)
+        return i;
+    }
+
+    letters.push_back(letter);
+    return letters.size() - 1;
+  }
+
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2015 OpenALPR Technology, Inc.
+ * Open source Automated License Plate Recognition [http://www.openalpr.com]
+ *
+ * This file is part of OpenALPR.
+ *
+ * OpenALPR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPENALPR_GLYPHCLASSIFIER_H
+#define OPENALPR_GLYPHCLASSIFIER_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "opencv2/core/core.hpp"
+
+namespace alpr
+{
+
+  struct GlyphChoice
+  {
+    std::string letter;
+    float confidence;
+  };
+
+  // Nearest neighbor classifier for segmented characters.  Each glyph is cropped to its
+  // ink, scaled into a fixed size cell and stored as one bit per pixel, so comparing two
+  // glyphs is an XOR and a popcount over a few 64 bit words.
+  class GlyphClassifier
+  {
+    public:
+      static const int GLYPH_WIDTH = 16;
+      static const int GLYPH_HEIGHT = 24;
+      static const int GLYPH_WORDS = (GLYPH_WIDTH * GLYPH_HEIGHT + 63) / 64;
+
+      GlyphClassifier();
+      virtual ~GlyphClassifier();
+
+      bool load(std::string filename);
+      bool save(std::string filename);
+
+      bool isLoaded();
+      int numGlyphs();
+
+      // character_image is a binarized character with white text on a black background,
+      // the same as the segmentation thresholds.  Returns false if it has no ink
+      bool addGlyph(std::string letter, cv::Mat character_image);
+
+      // Returns up to max_choices letters, best first.  Empty if the image has no ink
+      std::vector<GlyphChoice> classify(cv::Mat character_image, int max_choices);
+
+    private:
+
+      std::vector<std::string> letters;
+
+      // GLYPH_WORDS bit words per glyph, and the index into letters of each glyph
+      std::vector<uint64_t> glyph_bits;
+      std::vector<int> glyph_letters;
+
+      bool pack(cv::Mat character_image, uint64_t* bits);
+      int letterIndex(std::string letter);
+  };
+
+}
+
+#endif // OPENALPR_GLYPHCLASSIFIER_H
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2015 OpenALPR Technology, Inc.
+ * Open source Automated License Plate Recognition [http://www.openalpr.com]
+ *
+ * This file is part of OpenALPR.
+ *
+ * OpenALPR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "glyph_ocr.h"
+
+#include "utility.h"
+#include "segmentation/charactersegmenter.h"
+
+using namespace std;
+using namespace cv;
+
+namespace alpr
+{
+
+  // Number of letter choices kept for each character
+  const int GLYPH_CHOICES = 5;
+
+  GlyphOcr::GlyphOcr(Config* config)
+  : OCR(config)
+  {
+    this->postProcessor.setConfidenceThreshold(config->postProcessMinConfidence, config->postProcessConfidenceSkipLevel);
+
+    classifier.load(getGlyphFile(config));
+  }
+
+  GlyphOcr::~GlyphOcr()
+  {
+  }
+
+  bool GlyphOcr::isLoaded()
+  {
+    return classifier.isLoaded();
+  }
+
+  std::string GlyphOcr::getGlyphFile(Config* config)
+  {
+    return config->getTessdataPrefix() + "glyphs/" + config->ocrLanguage + ".glyphs";
+  }
+
+  std::vector<OcrChar> GlyphOcr::recognize_line(int line_idx, PipelineData* pipeline_data) {
+
+    std::vector<OcrChar> recognized_chars;
+
+    for (unsigned int i = 0; i < pipeline_data->thresholds.size(); i++)
+    {
+      Mat threshold = pipeline_data->thresholds[i];
+
+      for (unsigned int j = 0; j < pipeline_data->charRegions[line_idx].size(); j++)
+      {
+        Rect expandedRegion = expandRect( pipeline_data->charRegions[line_idx][j], 2, 2, threshold.cols, threshold.rows) ;
+
+        vector<GlyphChoice> choices = classifier.classify(threshold(expandedRegion), GLYPH_CHOICES);
+
+        for (unsigned int c = 0; c < choices.size(); c++)
+        {
+          OcrChar ocr_char;
+          ocr_char.char_index = j;
+          ocr_char.confidence = choices[c].confidence;
+          ocr_char.letter = choices[c].letter;
+          recognized_chars.push_back(ocr_char);
+
+          // The Tesseract backend reports its top choice twice, and the post processing
+          // confidence levels are tuned for that.  Do the same here
+          if (c == 0)
+            recognized_chars.push_back(ocr_char);
+
+          if (this->config->debugOcr)
+            printf("charpos%d line%d: threshold %d:  glyph %s, conf: %f\n", j, line_idx, i, choices[c].letter.c_str(), choices[c].confidence);
+        }
+      }
+    }
+
+    return recognized_chars;
+  }
+
+  void GlyphOcr::segment(PipelineData* pipeline_data) {
+
+    CharacterSegmenter segmenter(pipeline_data);
+    segmenter.segment();
+  }
+
+}
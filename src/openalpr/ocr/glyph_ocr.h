@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2015 OpenALPR Technology, Inc.
+ * Open source Automated License Plate Recognition [http://www.openalpr.com]
+ *
+ * This file is part of OpenALPR.
+ *
+ * OpenALPR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPENALPR_GLYPHOCR_H
+#define OPENALPR_GLYPHOCR_H
+
+#include "config.h"
+#include "pipeline_data.h"
+
+#include "ocr.h"
+#include "glyph_classifier.h"
+
+namespace alpr
+{
+
+  // Recognizes each segmented character with a nearest neighbor glyph classifier instead of Tesseract.
+  // The glyphs are trained from the character images written by the classifychars utility
+  class GlyphOcr : public OCR
+  {
+
+    public:
+      GlyphOcr(Config* config);
+      virtual ~GlyphOcr();
+
+      // False if the glyph file for the country could not be read
+      bool isLoaded();
+
+      static std::string getGlyphFile(Config* config);
+
+    private:
+
+      std::vector<OcrChar> recognize_line(int line_index, PipelineData* pipeline_data);
+      void segment(PipelineData* pipeline_data);
+
+      GlyphClassifier classifier;
+
+  };
+
+}
+
+#endif // OPENALPR_GLYPHOCR_H
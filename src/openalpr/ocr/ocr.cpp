@@ -18,6 +18,7 @@
 */
 
 #include "ocr.h"
+#include "pipeline_statistics.h"
 
 namespace alpr
 {
@@ -38,6 +39,9 @@ namespace alpr
     getTimeMonotonic(&startTime);
 
     segment(pipeline_data);
+
+    timespec recognizeStartTime;
+    getTimeMonotonic(&recognizeStartTime);
     
     postProcessor.clear();
 
@@ -57,10 +61,16 @@ namespace alpr
     }
     
 
+    timespec endTime;
+    getTimeMonotonic(&endTime);
+    if (config->statistics != NULL)
+    {
+      config->statistics->recordStage(STAGE_SEGMENTATION, diffclock(startTime, recognizeStartTime));
+      config->statistics->recordStage(STAGE_OCR, diffclock(recognizeStartTime, endTime));
+    }
+
     if (config->debugTiming)
     {
-      timespec endTime;
-      getTimeMonotonic(&endTime);
       std::cout << "OCR Time: " << diffclock(startTime, endTime) << "ms." << std::endl;
     }
   }
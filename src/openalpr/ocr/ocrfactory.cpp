@@ -1,12 +1,26 @@
 #include "ocrfactory.h"
 #include "tesseract_ocr.h"
+#include "glyph_ocr.h"
 
 namespace alpr
 {
   OCR* createOcr(Config* config)
   {
+    if (config->ocrBackend == "glyph")
+    {
+      GlyphOcr* glyph_ocr = new GlyphOcr(config);
+      if (glyph_ocr->isLoaded())
+        return glyph_ocr;
+
+      std::cerr << "--(!) Unable to load glyph file " << GlyphOcr::getGlyphFile(config) << ".  Using Tesseract instead" << std::endl;
+      delete glyph_ocr;
+    }
+    else if (config->ocrBackend != "tesseract")
+    {
+      std::cerr << "--(!) Unknown OCR backend '" << config->ocrBackend << "'.  Using Tesseract instead" << std::endl;
+    }
+
     return new TesseractOcr(config);
   }
 
 }
-
@@ -43,7 +43,15 @@ namespace alpr
     if (pipeline_data->plate_inverted)
       bitwise_not(pipeline_data->crop_gray, pipeline_data->crop_gray);
     pipeline_data->clearThresholds();
-    pipeline_data->thresholds = produceThresholds(pipeline_data->crop_gray, config);
+    if (pipeline_data->sharedThresholds.size() > 0)
+    {
+      for (unsigned int i = 0; i < pipeline_data->sharedThresholds.size(); i++)
+        pipeline_data->thresholds.push_back(pipeline_data->sharedThresholds[i].clone());
+    }
+    else
+    {
+      pipeline_data->thresholds = produceThresholds(pipeline_data->crop_gray, config);
+    }
 
     // TODO: Perhaps a bilateral filter would be better here.
     medianBlur(pipeline_data->crop_gray, pipeline_data->crop_gray, 3);
@@ -22,6 +22,8 @@
 
 #include "segmentation/charactersegmenter.h"
 
+#include <climits>
+
 using namespace std;
 using namespace cv;
 using namespace tesseract;
@@ -56,102 +58,201 @@ namespace alpr
   
   std::vector<OcrChar> TesseractOcr::recognize_line(int line_idx, PipelineData* pipeline_data) {
 
-    const int SPACE_CHAR_CODE = 32;
-    
     std::vector<OcrChar> recognized_chars;
     
     for (unsigned int i = 0; i < pipeline_data->thresholds.size(); i++)
     {
-      // Make it black text on white background
-      bitwise_not(pipeline_data->thresholds[i], pipeline_data->thresholds[i]);
-      tesseract.SetImage((uchar*) pipeline_data->thresholds[i].data, 
-                          pipeline_data->thresholds[i].size().width, pipeline_data->thresholds[i].size().height, 
-                          pipeline_data->thresholds[i].channels(), pipeline_data->thresholds[i].step1());
+      // Make it black text on white background.  The thresholds themselves are left untouched
+      Mat threshold;
+      bitwise_not(pipeline_data->thresholds[i], threshold);
 
- 
-      int absolute_charpos = 0;
+      if (config->ocrBatchCharacters)
+        recognizeStrip(line_idx, i, threshold, pipeline_data, recognized_chars);
+      else
+        recognizeCharacters(line_idx, i, threshold, pipeline_data, recognized_chars);
+    }
+    
+    return recognized_chars;
+  }
 
-      for (unsigned int j = 0; j < pipeline_data->charRegions[line_idx].size(); j++)
+  void TesseractOcr::recognizeCharacters(int line_idx, int threshold_idx, cv::Mat threshold, PipelineData* pipeline_data,
+                                         std::vector<OcrChar>& recognized_chars)
+  {
+    tesseract.SetPageSegMode(PSM_SINGLE_CHAR);
+    tesseract.SetImage((uchar*) threshold.data, 
+                        threshold.size().width, threshold.size().height, 
+                        threshold.channels(), threshold.step1());
+
+    int absolute_charpos = 0;
+
+    for (unsigned int j = 0; j < pipeline_data->charRegions[line_idx].size(); j++)
+    {
+      Rect expandedRegion = expandRect( pipeline_data->charRegions[line_idx][j], 2, 2, threshold.cols, threshold.rows) ;
+
+      tesseract.SetRectangle(expandedRegion.x, expandedRegion.y, expandedRegion.width, expandedRegion.height);
+      tesseract.Recognize(NULL);
+
+      tesseract::ResultIterator* ri = tesseract.GetIterator();
+      tesseract::PageIteratorLevel level = tesseract::RIL_SYMBOL;
+      do
       {
-        Rect expandedRegion = expandRect( pipeline_data->charRegions[line_idx][j], 2, 2, pipeline_data->thresholds[i].cols, pipeline_data->thresholds[i].rows) ;
+        addSymbol(ri, absolute_charpos, line_idx, threshold_idx, recognized_chars);
+      }
+      while((ri->Next(level)));
+
+      delete ri;
+
+      absolute_charpos++;
+    }
+  }
+
+  void TesseractOcr::recognizeStrip(int line_idx, int threshold_idx, cv::Mat threshold, PipelineData* pipeline_data,
+                                    std::vector<OcrChar>& recognized_chars)
+  {
+    const vector<Rect>& charRegions = pipeline_data->charRegions[line_idx];
+    if (charRegions.size() == 0)
+      return;
+
+    vector<Rect> expandedRegions;
+    int top = threshold.rows;
+    int bottom = 0;
+    int total_width = 0;
+    for (unsigned int j = 0; j < charRegions.size(); j++)
+    {
+      Rect expandedRegion = expandRect( charRegions[j], 2, 2, threshold.cols, threshold.rows) ;
+      expandedRegions.push_back(expandedRegion);
+
+      top = min(top, expandedRegion.y);
+      bottom = max(bottom, expandedRegion.y + expandedRegion.height);
+      total_width += expandedRegion.width;
+    }
+
+    // Keep the characters at their original height, so the baseline is unchanged, and leave a gap
+    // between them that is wide enough to stop Tesseract from joining neighbors
+    int margin = max(4, (bottom - top) / 4);
+    int gap = max(4, (bottom - top) / 2);
+
+    Mat strip(bottom - top + margin * 2, total_width + gap * (charRegions.size() - 1) + margin * 2, CV_8U, Scalar(255));
+    vector<int> strip_left;
+    vector<int> strip_right;
+    int x = margin;
+    for (unsigned int j = 0; j < expandedRegions.size(); j++)
+    {
+      Rect destination(x, margin + expandedRegions[j].y - top, expandedRegions[j].width, expandedRegions[j].height);
+      threshold(expandedRegions[j]).copyTo(strip(destination));
+
+      strip_left.push_back(x);
+      strip_right.push_back(x + expandedRegions[j].width);
+      x += expandedRegions[j].width + gap;
+    }
 
-        tesseract.SetRectangle(expandedRegion.x, expandedRegion.y, expandedRegion.width, expandedRegion.height);
-        tesseract.Recognize(NULL);
+    tesseract.SetPageSegMode(PSM_SINGLE_LINE);
+    tesseract.SetImage((uchar*) strip.data, strip.cols, strip.rows, strip.channels(), strip.step1());
+    tesseract.Recognize(NULL);
 
-        tesseract::ResultIterator* ri = tesseract.GetIterator();
-        tesseract::PageIteratorLevel level = tesseract::RIL_SYMBOL;
-        do
+    tesseract::ResultIterator* ri = tesseract.GetIterator();
+    if (ri == NULL)
+      return;
+
+    tesseract::PageIteratorLevel level = tesseract::RIL_SYMBOL;
+    do
+    {
+      int left, symbol_top, right, symbol_bottom;
+      if (ri->BoundingBox(level, &left, &symbol_top, &right, &symbol_bottom) == false)
+        continue;
+
+      // The symbol belongs to the box that contains its center (or the closest box, if it is in a gap)
+      int center = (left + right) / 2;
+      int char_index = 0;
+      int closest_distance = INT_MAX;
+      for (unsigned int j = 0; j < strip_left.size(); j++)
+      {
+        int distance = 0;
+        if (center < strip_left[j])
+          distance = strip_left[j] - center;
+        else if (center > strip_right[j])
+          distance = center - strip_right[j];
+
+        if (distance < closest_distance)
         {
-          const char* symbol = ri->GetUTF8Text(level);
-          float conf = ri->Confidence(level);
-
-          bool dontcare;
-          int fontindex = 0;
-          int pointsize = 0;
-          const char* fontName = ri->WordFontAttributes(&dontcare, &dontcare, &dontcare, &dontcare, &dontcare, &dontcare, &pointsize, &fontindex);
-
-          // Ignore NULL pointers, spaces, and characters that are way too small to be valid
-          if(symbol != 0 && symbol[0] != SPACE_CHAR_CODE && pointsize >= config->ocrMinFontSize)
-          {
-            OcrChar c;
-            c.char_index = absolute_charpos;
-            c.confidence = conf;
-            c.letter = string(symbol);
-            recognized_chars.push_back(c);
-
-            if (this->config->debugOcr)
-              printf("charpos%d line%d: threshold %d:  symbol %s, conf: %f font: %s (index %d) size %dpx", absolute_charpos, line_idx, i, symbol, conf, fontName, fontindex, pointsize);
-
-            bool indent = false;
-            tesseract::ChoiceIterator ci(*ri);
-            do
-            {
-              const char* choice = ci.GetUTF8Text();
-              
-              OcrChar c2;
-              c2.char_index = absolute_charpos;
-              c2.confidence = ci.Confidence();
-              c2.letter = string(choice);
-              
-              //1/17/2016 adt adding check to avoid double adding same character if ci is same as symbol. Otherwise first choice from ResultsIterator will get added twice when choiceIterator run.
-              if (string(symbol) != string(choice))
-                recognized_chars.push_back(c2);
-              else
-              {
-                // Explictly double-adding the first character.  This leads to higher accuracy right now, likely because other sections of code
-                // have expected it and compensated. 
-                // TODO: Figure out how to remove this double-counting of the first letter without impacting accuracy
-                recognized_chars.push_back(c2);
-              }
-              if (this->config->debugOcr)
-              {
-                if (indent) printf("\t\t ");
-                printf("\t- ");
-                printf("%s conf: %f\n", choice, ci.Confidence());
-              }
-
-              indent = true;
-            }
-            while(ci.Next());
-
-          }
-
-          if (this->config->debugOcr)
-            printf("---------------------------------------------\n");
-
-          delete[] symbol;
+          closest_distance = distance;
+          char_index = j;
         }
-        while((ri->Next(level)));
+      }
 
-        delete ri;
+      addSymbol(ri, char_index, line_idx, threshold_idx, recognized_chars);
+    }
+    while((ri->Next(level)));
 
-        absolute_charpos++;
+    delete ri;
+  }
+
+  void TesseractOcr::addSymbol(tesseract::ResultIterator* ri, int char_index, int line_idx, int threshold_idx,
+                               std::vector<OcrChar>& recognized_chars)
+  {
+    const int SPACE_CHAR_CODE = 32;
+    tesseract::PageIteratorLevel level = tesseract::RIL_SYMBOL;
+
+    const char* symbol = ri->GetUTF8Text(level);
+    float conf = ri->Confidence(level);
+
+    bool dontcare;
+    int fontindex = 0;
+    int pointsize = 0;
+    const char* fontName = ri->WordFontAttributes(&dontcare, &dontcare, &dontcare, &dontcare, &dontcare, &dontcare, &pointsize, &fontindex);
+
+    // Ignore NULL pointers, spaces, and characters that are way too small to be valid
+    if(symbol != 0 && symbol[0] != SPACE_CHAR_CODE && pointsize >= config->ocrMinFontSize)
+    {
+      OcrChar c;
+      c.char_index = char_index;
+      c.confidence = conf;
+      c.letter = string(symbol);
+      recognized_chars.push_back(c);
+
+      if (this->config->debugOcr)
+        printf("charpos%d line%d: threshold %d:  symbol %s, conf: %f font: %s (index %d) size %dpx", char_index, line_idx, threshold_idx, symbol, conf, fontName, fontindex, pointsize);
+
+      bool indent = false;
+      tesseract::ChoiceIterator ci(*ri);
+      do
+      {
+        const char* choice = ci.GetUTF8Text();
+        
+        OcrChar c2;
+        c2.char_index = char_index;
+        c2.confidence = ci.Confidence();
+        c2.letter = string(choice);
+        
+        //1/17/2016 adt adding check to avoid double adding same character if ci is same as symbol. Otherwise first choice from ResultsIterator will get added twice when choiceIterator run.
+        if (string(symbol) != string(choice))
+          recognized_chars.push_back(c2);
+        else
+        {
+          // Explictly double-adding the first character.  This leads to higher accuracy right now, likely because other sections of code
+          // have expected it and compensated. 
+          // TODO: Figure out how to remove this double-counting of the first letter without impacting accuracy
+          recognized_chars.push_back(c2);
+        }
+        if (this->config->debugOcr)
+        {
+          if (indent) printf("\t\t ");
+          printf("\t- ");
+          printf("%s conf: %f\n", choice, ci.Confidence());
+        }
+
+        indent = true;
       }
-      
+      while(ci.Next());
+
     }
-    
-    return recognized_chars;
+
+    if (this->config->debugOcr)
+      printf("---------------------------------------------\n");
+
+    delete[] symbol;
   }
+
   void TesseractOcr::segment(PipelineData* pipeline_data) {
 
     CharacterSegmenter segmenter(pipeline_data);
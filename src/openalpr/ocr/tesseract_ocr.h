@@ -51,6 +51,19 @@ namespace alpr
 
       std::vector<OcrChar> recognize_line(int line_index, PipelineData* pipeline_data);
       void segment(PipelineData* pipeline_data);
+
+      // Recognizes each character box separately
+      void recognizeCharacters(int line_idx, int threshold_idx, cv::Mat threshold, PipelineData* pipeline_data,
+                               std::vector<OcrChar>& recognized_chars);
+
+      // Copies the character boxes side by side into one strip and recognizes it in a single pass.
+      // Each symbol is assigned to the character box it came from
+      void recognizeStrip(int line_idx, int threshold_idx, cv::Mat threshold, PipelineData* pipeline_data,
+                          std::vector<OcrChar>& recognized_chars);
+
+      // Adds the symbol at the iterator position, and its alternative choices
+      void addSymbol(tesseract::ResultIterator* ri, int char_index, int line_idx, int threshold_idx,
+                     std::vector<OcrChar>& recognized_chars);
     
       tesseract::TessBaseAPI tesseract;
 
@@ -44,6 +44,10 @@ namespace alpr
 
       std::vector<cv::Mat> thresholds;
 
+      // Thresholds of the deskewed crop computed ahead of segmentation, when several
+      // countries read the same plate.  The segmenter works on copies of these
+      std::vector<cv::Mat> sharedThresholds;
+
       std::vector<cv::Point2f> plate_corners;
 
 
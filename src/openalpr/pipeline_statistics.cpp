@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2015 OpenALPR Technology, Inc.
+ * Open source Automated License Plate Recognition [http://www.openalpr.com]
+ *
+ * This file is part of OpenALPR.
+ *
+ * OpenALPR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pipeline_statistics.h"
+
+#include <algorithm>
+
+#ifdef _MSC_VER
+  #include <windows.h>
+#endif
+
+using namespace std;
+
+namespace alpr
+{
+
+  static int64_t atomicAdd(volatile int64_t* value, int64_t amount)
+  {
+#ifdef _MSC_VER
+    return InterlockedExchangeAdd64((volatile LONGLONG*) value, amount);
+#else
+    return __sync_fetch_and_add(value, amount);
+#endif
+  }
+
+  static int64_t atomicRead(volatile int64_t* value)
+  {
+    return atomicAdd(value, 0);
+  }
+
+  static void atomicMax(volatile int64_t* value, int64_t candidate)
+  {
+    int64_t current = atomicRead(value);
+    while (candidate > current)
+    {
+#ifdef _MSC_VER
+      int64_t previous = InterlockedCompareExchange64((volatile LONGLONG*) value, candidate, current);
+#else
+      int64_t previous = __sync_val_compare_and_swap(value, current, candidate);
+#endif
+      if (previous == current)
+        break;
+      current = previous;
+    }
+  }
+
+  static void atomicReset(volatile int64_t* value)
+  {
+    atomicAdd(value, -atomicRead(value));
+  }
+
+  LatencyHistogram::LatencyHistogram()
+  {
+    for (int i = 0; i < LATENCY_BUCKETS; i++)
+      buckets[i] = 0;
+    count = 0;
+    total_us = 0;
+    max_us = 0;
+  }
+
+  void LatencyHistogram::record(double ms)
+  {
+    int64_t us = (int64_t) (ms * 1000.0 + 0.5);
+    if (us < 0)
+      us = 0;
+
+    atomicAdd(&buckets[bucketIndex(us)], 1);
+    atomicAdd(&count, 1);
+    atomicAdd(&total_us, us);
+    atomicMax(&max_us, us);
+  }
+
+  void LatencyHistogram::reset()
+  {
+    for (int i = 0; i < LATENCY_BUCKETS; i++)
+      atomicReset(&buckets[i]);
+    atomicReset(&count);
+    atomicReset(&total_us);
+    atomicReset(&max_us);
+  }
+
+  AlprStageStatistics LatencyHistogram::summarize(std::string stage)
+  {
+    AlprStageStatistics summary;
+    summary.stage = stage;
+
+    int64_t counts[LATENCY_BUCKETS];
+    int64_t total = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++)
+    {
+      counts[i] = atomicRead(&buckets[i]);
+      total += counts[i];
+    }
+
+    summary.count = total;
+    summary.total_ms = atomicRead(&total_us) / 1000.0;
+    summary.mean_ms = total > 0 ? summary.total_ms / total : 0;
+    summary.max_ms = atomicRead(&max_us) / 1000.0;
+
+    const double percentiles[3] = { 0.5, 0.9, 0.99 };
+    double values[3] = { 0, 0, 0 };
+    for (int p = 0; p < 3 && total > 0; p++)
+    {
+      // The rank of the sample at this percentile, counting from 1
+      int64_t rank = (int64_t) (percentiles[p] * total + 0.999999);
+      if (rank < 1)
+        rank = 1;
+
+      int64_t seen = 0;
+      for (int i = 0; i < LATENCY_BUCKETS; i++)
+      {
+        seen += counts[i];
+        if (seen >= rank)
+        {
+          values[p] = min(bucketMidpointMs(i), summary.max_ms);
+          break;
+        }
+      }
+    }
+
+    summary.p50_ms = values[0];
+    summary.p90_ms = values[1];
+    summary.p99_ms = values[2];
+
+    return summary;
+  }
+
+  int LatencyHistogram::bucketIndex(int64_t us)
+  {
+    if (us < LATENCY_SUB_BUCKETS)
+      return (int) us;
+
+    int exponent = 0;
+    for (int64_t v = us; v > 1; v >>= 1)
+      exponent++;
+
+    if (exponent >= LATENCY_MAX_EXPONENT)
+      return LATENCY_BUCKETS - 1;
+
+    // The three bits below the leading one pick the bucket within the power of two
+    int sub_bucket = (int) ((us >> (exponent - 3)) & (LATENCY_SUB_BUCKETS - 1));
+    return LATENCY_SUB_BUCKETS + (exponent - 3) * LATENCY_SUB_BUCKETS + sub_bucket;
+  }
+
+  double LatencyHistogram::bucketMidpointMs(int index)
+  {
+    if (index < LATENCY_SUB_BUCKETS)
+      return index / 1000.0;
+
+    int exponent = (index - LATENCY_SUB_BUCKETS) / LATENCY_SUB_BUCKETS + 3;
+    int sub_bucket = (index - LATENCY_SUB_BUCKETS) % LATENCY_SUB_BUCKETS;
+
+    double width = (double) (((int64_t) 1) << (exponent - 3));
+    double lower = (LATENCY_SUB_BUCKETS + sub_bucket) * width;
+    return (lower + width / 2) / 1000.0;
+  }
+
+
+  PipelineStatistics::PipelineStatistics()
+  {
+    for (int i = 0; i < COUNTER_COUNT; i++)
+      counters[i] = 0;
+  }
+
+  PipelineStatistics::~PipelineStatistics()
+  {
+  }
+
+  void PipelineStatistics::recordStage(PipelineStage stage, double ms)
+  {
+    stages[stage].record(ms);
+  }
+
+  void PipelineStatistics::increment(PipelineCounter counter, int64_t amount)
+  {
+    atomicAdd(&counters[counter], amount);
+  }
+
+  void PipelineStatistics::recordDisqualified(const std::string& reason)
+  {
+    increment(COUNTER_CANDIDATES_DISQUALIFIED);
+
+    disqualify_mutex.lock();
+    disqualify_reasons[reason]++;
+    disqualify_mutex.unlock();
+  }
+
+  AlprStatistics PipelineStatistics::getStatistics()
+  {
+    AlprStatistics statistics;
+
+    for (int i = 0; i < STAGE_COUNT; i++)
+      statistics.stages.push_back(stages[i].summarize(stageName((PipelineStage) i)));
+
+    for (int i = 0; i < COUNTER_COUNT; i++)
+      statistics.counters[counterName((PipelineCounter) i)] = atomicRead(&counters[i]);
+
+    disqualify_mutex.lock();
+    statistics.disqualify_reasons = disqualify_reasons;
+    disqualify_mutex.unlock();
+
+    return statistics;
+  }
+
+  void PipelineStatistics::reset()
+  {
+    for (int i = 0; i < STAGE_COUNT; i++)
+      stages[i].reset();
+
+    for (int i = 0; i < COUNTER_COUNT; i++)
+      atomicReset(&counters[i]);
+
+    disqualify_mutex.lock();
+    disqualify_reasons.clear();
+    disqualify_mutex.unlock();
+  }
+
+  const char* PipelineStatistics::stageName(PipelineStage stage)
+  {
+    switch (stage)
+    {
+      case STAGE_DETECTION:           return "detection";
+      case STAGE_CHARACTER_ANALYSIS:  return "character_analysis";
+      case STAGE_EDGE_FINDING:        return "edge_finding";
+      case STAGE_DESKEW:              return "deskew";
+      case STAGE_SEGMENTATION:        return "segmentation";
+      case STAGE_OCR:                 return "ocr";
+      case STAGE_POSTPROCESS:         return "postprocess";
+      case STAGE_STATE_ID:            return "state_id";
+      case STAGE_TOTAL:               return "total";
+      default:                        return "unknown";
+    }
+  }
+
+  const char* PipelineStatistics::counterName(PipelineCounter counter)
+  {
+    switch (counter)
+    {
+      case COUNTER_IMAGES:                   return "images";
+      case COUNTER_PLATE_CANDIDATES:         return "plate_candidates";
+      case COUNTER_CANDIDATES_DISQUALIFIED:  return "candidates_disqualified";
+      case COUNTER_PLATES_FOUND:             return "plates_found";
+      default:                               return "unknown";
+    }
+  }
+
+}
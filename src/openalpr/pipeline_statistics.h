@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2015 OpenALPR Technology, Inc.
+ * Open source Automated License Plate Recognition [http://www.openalpr.com]
+ *
+ * This file is part of OpenALPR.
+ *
+ * OpenALPR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPENALPR_PIPELINESTATISTICS_H
+#define OPENALPR_PIPELINESTATISTICS_H
+
+#include <map>
+#include <string>
+
+#include "alpr.h"
+#include "support/tinythread.h"
+
+// Buckets 0-7 hold single microseconds.  Above that, each power of two is split in 8 buckets
+#define LATENCY_SUB_BUCKETS 8
+#define LATENCY_MAX_EXPONENT 36
+#define LATENCY_BUCKETS (LATENCY_SUB_BUCKETS + (LATENCY_MAX_EXPONENT - 3) * LATENCY_SUB_BUCKETS)
+
+namespace alpr
+{
+
+  enum PipelineStage
+  {
+    STAGE_DETECTION,
+    STAGE_CHARACTER_ANALYSIS,
+    STAGE_EDGE_FINDING,
+    STAGE_DESKEW,
+    STAGE_SEGMENTATION,
+    STAGE_OCR,
+    STAGE_POSTPROCESS,
+    STAGE_STATE_ID,
+    STAGE_TOTAL,
+
+    STAGE_COUNT
+  };
+
+  enum PipelineCounter
+  {
+    COUNTER_IMAGES,
+    COUNTER_PLATE_CANDIDATES,
+    COUNTER_CANDIDATES_DISQUALIFIED,
+    COUNTER_PLATES_FOUND,
+
+    COUNTER_COUNT
+  };
+
+  // A log scale latency histogram, updated with atomic adds so any number of threads
+  // can record into it without locking
+  class LatencyHistogram
+  {
+    public:
+      LatencyHistogram();
+
+      void record(double ms);
+      void reset();
+
+      AlprStageStatistics summarize(std::string stage);
+
+    private:
+      volatile int64_t buckets[LATENCY_BUCKETS];
+      volatile int64_t count;
+      volatile int64_t total_us;
+      volatile int64_t max_us;
+
+      static int bucketIndex(int64_t us);
+      static double bucketMidpointMs(int index);
+  };
+
+  // Stage latencies and counters for one Alpr instance.  Owned by AlprImpl and reached
+  // by the pipeline through Config::statistics, which is NULL when nothing is collecting
+  class PipelineStatistics
+  {
+    public:
+      PipelineStatistics();
+      virtual ~PipelineStatistics();
+
+      void recordStage(PipelineStage stage, double ms);
+      void increment(PipelineCounter counter, int64_t amount = 1);
+
+      // Counts a plate candidate dropped for the given reason
+      void recordDisqualified(const std::string& reason);
+
+      // Not an atomic snapshot: recordings made while it runs may be partially included
+      AlprStatistics getStatistics();
+      void reset();
+
+      static const char* stageName(PipelineStage stage);
+      static const char* counterName(PipelineCounter counter);
+
+    private:
+      LatencyHistogram stages[STAGE_COUNT];
+      volatile int64_t counters[COUNTER_COUNT];
+
+      std::map<std::string, int64_t> disqualify_reasons;
+      tthread::mutex disqualify_mutex;
+  };
+
+}
+
+#endif // OPENALPR_PIPELINESTATISTICS_H
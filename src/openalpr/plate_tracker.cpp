@@ -0,0 +1,391 @@
+/*
+ * Copyright (c) 2015 OpenALPR Technology, Inc.
+ * Open source Automated License Plate Recognition [http://www.openalpr.com]
+ *
+ * This file is part of OpenALPR.
+ *
+ * OpenALPR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "plate_tracker.h"
+
+#include <algorithm>
+
+#include "opencv2/imgproc/imgproc.hpp"
+#include "alpr_impl.h"
+#include "utility.h"
+#include "support/timing.h"
+
+using namespace std;
+using namespace cv;
+
+namespace alpr
+{
+
+  // Thumbnails are 1/THUMBNAIL_SCALE the size of the frame.  Each pixel averages a block of the
+  // frame, so it is allowed a larger change than the plate patches before the frame counts as changed
+  const int THUMBNAIL_SCALE = 8;
+  const float THUMBNAIL_CHANGE_FACTOR = 3.0;
+
+  static Rect plateRect(const AlprPlateResult& plate)
+  {
+    vector<Point> points;
+    for (int i = 0; i < 4; i++)
+      points.push_back(Point(plate.plate_points[i].x, plate.plate_points[i].y));
+
+    return boundingRect(points);
+  }
+
+  static float intersectionOverUnion(Rect r1, Rect r2)
+  {
+    float intersection = (r1 & r2).area();
+    float combined = r1.area() + r2.area() - intersection;
+    if (combined <= 0)
+      return 0;
+
+    return intersection / combined;
+  }
+
+  PlateTracker::PlateTracker(float minOverlap, int maxTextDistance, int maxMissedFrames,
+                             int stableFrameCount, float maxPixelChange, int maxReusedFrames)
+  {
+    this->minOverlap = minOverlap;
+    this->maxTextDistance = maxTextDistance;
+    this->maxMissedFrames = maxMissedFrames;
+    this->stableFrameCount = stableFrameCount;
+    this->maxPixelChange = maxPixelChange;
+    this->maxReusedFrames = maxReusedFrames;
+
+    this->next_track_id = 1;
+    this->reused_frames = 0;
+    this->last_frame_reused = false;
+  }
+
+  PlateTracker::~PlateTracker()
+  {
+  }
+
+  AlprResults PlateTracker::recognize(Alpr* alpr, cv::Mat frame, std::vector<AlprRegionOfInterest> regionsOfInterest,
+                                      std::vector<AlprPlateGroup>& finishedGroups)
+  {
+    Mat gray;
+    if (frame.channels() > 2)
+      cvtColor(frame, gray, CV_BGR2GRAY);
+    else
+      gray = frame.clone();
+
+    Mat thumbnail;
+    resize(gray, thumbnail, Size(max(1, gray.cols / THUMBNAIL_SCALE), max(1, gray.rows / THUMBNAIL_SCALE)), 0, 0, INTER_AREA);
+
+    AlprResults results;
+    last_frame_reused = frameUnchanged(gray, thumbnail);
+    if (last_frame_reused)
+    {
+      results = cached_results;
+      results.epoch_time = getEpochTimeMs();
+      results.total_processing_time_ms = 0;
+      reused_frames++;
+    }
+    else
+    {
+      results = alpr->recognize(frame.data, frame.elemSize(), frame.cols, frame.rows, regionsOfInterest);
+
+      reference_gray = gray;
+      reference_thumbnail = thumbnail;
+      cached_results = results;
+      reused_frames = 0;
+    }
+
+    update(frame, results, results.epoch_time, last_frame_reused, finishedGroups);
+
+    return results;
+  }
+
+  AlprResults PlateTracker::skipRecognition(cv::Mat frame, std::vector<AlprPlateGroup>& finishedGroups)
+  {
+    AlprResults results = cached_results;
+    results.epoch_time = getEpochTimeMs();
+    results.total_processing_time_ms = 0;
+    last_frame_reused = true;
+
+    update(frame, results, results.epoch_time, true, finishedGroups);
+
+    return results;
+  }
+
+  void PlateTracker::addResults(cv::Mat frame, const AlprResults& results, std::vector<AlprPlateGroup>& finishedGroups)
+  {
+    // Nothing to compare the next frame with
+    reference_gray.release();
+    reference_thumbnail.release();
+
+    cached_results = results;
+    reused_frames = 0;
+    last_frame_reused = false;
+
+    AlprResults tracked_results = results;
+    update(frame, tracked_results, results.epoch_time, false, finishedGroups);
+  }
+
+  bool PlateTracker::lastFrameReused()
+  {
+    return last_frame_reused;
+  }
+
+  std::vector<AlprPlateGroup> PlateTracker::flush()
+  {
+    vector<AlprPlateGroup> groups;
+    for (unsigned int i = 0; i < tracks.size(); i++)
+      groups.push_back(createGroup(tracks[i]));
+
+    tracks.clear();
+    reference_gray.release();
+    reference_thumbnail.release();
+    cached_results = AlprResults();
+
+    return groups;
+  }
+
+  bool PlateTracker::frameUnchanged(cv::Mat gray, cv::Mat thumbnail)
+  {
+    if (reference_gray.empty() || reference_gray.size() != gray.size())
+      return false;
+
+    // Recognize periodically even if the scene looks static
+    if (reused_frames >= maxReusedFrames)
+      return false;
+
+    Mat thumbnail_diff;
+    absdiff(thumbnail, reference_thumbnail, thumbnail_diff);
+    double min_diff, max_diff;
+    minMaxLoc(thumbnail_diff, &min_diff, &max_diff);
+    if (max_diff > maxPixelChange * THUMBNAIL_CHANGE_FACTOR)
+      return false;
+
+    // Every plate on screen must have a settled reading, and must not have moved at all
+    Rect frame_rect(0, 0, gray.cols, gray.rows);
+    for (unsigned int i = 0; i < tracks.size(); i++)
+    {
+      if (tracks[i].missed_frames > 0)
+        continue;
+
+      if (tracks[i].frame_count < stableFrameCount)
+        return false;
+
+      Rect patch = tracks[i].rect & frame_rect;
+      if (patch.area() == 0)
+        continue;
+
+      Mat patch_diff;
+      absdiff(gray(patch), reference_gray(patch), patch_diff);
+      if (mean(patch_diff)[0] > maxPixelChange)
+        return false;
+    }
+
+    return true;
+  }
+
+  // reused is true when the results were copied from an earlier frame.  They keep the tracks they
+  // match alive, but are not counted as new readings
+  void PlateTracker::update(cv::Mat frame, AlprResults& results, int64_t epoch_time, bool reused,
+                            std::vector<AlprPlateGroup>& finishedGroups)
+  {
+    vector<bool> matched(tracks.size(), false);
+
+    for (unsigned int p = 0; p < results.plates.size(); p++)
+    {
+      const AlprPlateResult& plate = results.plates[p];
+      Rect rect = plateRect(plate);
+      Point2f center(rect.x + rect.width / 2.0f, rect.y + rect.height / 2.0f);
+
+      // Plates that overlap a track enough are the same plate.  Plates that moved further
+      // still match a nearby track if the text agrees
+      int best_track = -1;
+      float best_score = 0;
+      for (unsigned int t = 0; t < tracks.size(); t++)
+      {
+        if (matched[t])
+          continue;
+
+        Rect track_rect = tracks[t].rect;
+        Point2f track_center(track_rect.x + track_rect.width / 2.0f, track_rect.y + track_rect.height / 2.0f);
+        float distance = norm(center - track_center);
+        float overlap = intersectionOverUnion(rect, track_rect);
+
+        bool nearby = distance < max(rect.width, track_rect.width);
+        bool text_matches = levenshteinDistance(plate.bestPlate.characters, tracks[t].leading_text, maxTextDistance + 1) <= maxTextDistance;
+
+        if (overlap < minOverlap && !(nearby && text_matches))
+          continue;
+
+        float score = overlap + (text_matches ? 1 : 0);
+        if (best_track == -1 || score > best_score)
+        {
+          best_track = t;
+          best_score = score;
+        }
+      }
+
+      if (best_track >= 0)
+      {
+        matched[best_track] = true;
+        addSighting(tracks[best_track], frame, plate, epoch_time, reused);
+      }
+      else if (!reused)
+      {
+        PlateTrack track;
+        track.id = next_track_id++;
+        track.first_seen_epoch = epoch_time;
+        track.frame_count = 0;
+        addSighting(track, frame, plate, epoch_time, reused);
+
+        tracks.push_back(track);
+        matched.push_back(true);
+      }
+    }
+
+    // Tracks that have not been seen for a while have left the scene
+    vector<PlateTrack> open_tracks;
+    for (unsigned int t = 0; t < tracks.size(); t++)
+    {
+      if (!matched[t])
+        tracks[t].missed_frames++;
+
+      if (tracks[t].missed_frames > maxMissedFrames)
+        finishedGroups.push_back(createGroup(tracks[t]));
+      else
+        open_tracks.push_back(tracks[t]);
+    }
+    tracks = open_tracks;
+  }
+
+  void PlateTracker::addSighting(PlateTrack& track, cv::Mat frame, const AlprPlateResult& plate, int64_t epoch_time, bool reused)
+  {
+    track.last_seen_epoch = epoch_time;
+    track.missed_frames = 0;
+
+    // The reading was already counted on the frame it came from
+    if (reused)
+      return;
+
+    track.rect = plateRect(plate);
+    track.frame_count++;
+
+    const AlprPlate& bestPlate = plate.bestPlate;
+    if (track.text_scores.find(bestPlate.characters) == track.text_scores.end())
+    {
+      TextScore newentry;
+      newentry.plate = bestPlate;
+      newentry.score_total = 0;
+      newentry.count = 0;
+      track.text_scores[bestPlate.characters] = newentry;
+    }
+
+    TextScore& text_score = track.text_scores[bestPlate.characters];
+    text_score.score_total += bestPlate.overall_confidence;
+    text_score.count++;
+    if (bestPlate.overall_confidence > text_score.plate.overall_confidence)
+      text_score.plate = bestPlate;
+
+    if (track.leading_text.empty() || text_score.score_total > track.text_scores[track.leading_text].score_total)
+      track.leading_text = bestPlate.characters;
+
+    if (track.frame_count == 1 || bestPlate.overall_confidence > track.best_result.bestPlate.overall_confidence)
+    {
+      track.best_result = plate;
+      track.best_frame = frame.clone();
+    }
+  }
+
+  bool PlateTracker::compareTextScores(const TextScore& a, const TextScore& b)
+  {
+    if (a.score_total != b.score_total)
+      return a.score_total > b.score_total;
+    return a.plate.overall_confidence > b.plate.overall_confidence;
+  }
+
+  AlprPlateGroup PlateTracker::createGroup(const PlateTrack& track)
+  {
+    AlprPlateGroup group;
+    group.track_id = track.id;
+    group.first_seen_epoch = track.first_seen_epoch;
+    group.last_seen_epoch = track.last_seen_epoch;
+    group.frame_count = track.frame_count;
+    group.bestResult = track.best_result;
+    group.bestFrame = track.best_frame;
+
+    vector<TextScore> scores;
+    for (map<string, TextScore>::const_iterator it = track.text_scores.begin(); it != track.text_scores.end(); it++)
+      scores.push_back(it->second);
+
+    std::sort(scores.begin(), scores.end(), compareTextScores);
+
+    for (unsigned int i = 0; i < scores.size(); i++)
+      group.candidates.push_back(scores[i].plate);
+
+    if (group.candidates.size() > 0)
+      group.bestPlate = group.candidates[0];
+    else
+      group.bestPlate = track.best_result.bestPlate;
+
+    return group;
+  }
+
+  std::string PlateTracker::toJson(const AlprPlateGroup& group)
+  {
+    string response;
+    toJson(group, response, vector<AlprJsonField>());
+    return response;
+  }
+
+  void PlateTracker::toJson(const AlprPlateGroup& group, std::string& output, const std::vector<AlprJsonField>& extraFields)
+  {
+    JsonWriter writer(output);
+    writer.beginObject();
+
+    writer.addNumber("version",	2	  );
+    writer.addString("data_type",	"alpr_group"	  );
+
+    writer.addNumber("track_id",	group.track_id	  );
+    writer.addNumber("epoch_start",	group.first_seen_epoch	  );
+    writer.addNumber("epoch_end",	group.last_seen_epoch	  );
+    writer.addNumber("frame_count",	group.frame_count	  );
+
+    writer.beginObject("best_plate");
+    writer.addString("plate",		group.bestPlate.characters);
+    writer.addNumber("confidence",		group.bestPlate.overall_confidence);
+    writer.addNumber("matches_template",	group.bestPlate.matches_template);
+    writer.endObject();
+
+    writer.beginArray("candidates");
+    for (unsigned int i = 0; i < group.candidates.size(); i++)
+    {
+      writer.beginObject();
+      writer.addString("plate",		group.candidates[i].characters);
+      writer.addNumber("confidence",	group.candidates[i].overall_confidence);
+      writer.addNumber("matches_template",	group.candidates[i].matches_template);
+      writer.endObject();
+    }
+    writer.endArray();
+
+    writer.beginObject("best_result");
+    AlprImpl::writePlateJson(writer, group.bestResult);
+    writer.endObject();
+
+    for (unsigned int i = 0; i < extraFields.size(); i++)
+      writer.addRaw(extraFields[i].key.c_str(), extraFields[i].json_value);
+
+    writer.endObject();
+  }
+
+}
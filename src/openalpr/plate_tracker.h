@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2015 OpenALPR Technology, Inc.
+ * Open source Automated License Plate Recognition [http://www.openalpr.com]
+ *
+ * This file is part of OpenALPR.
+ *
+ * OpenALPR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPENALPR_PLATETRACKER_H
+#define OPENALPR_PLATETRACKER_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "opencv2/core/core.hpp"
+#include "alpr.h"
+
+namespace alpr
+{
+
+  // Every sighting of one plate across consecutive video frames.
+  // Reported once, after the plate has left the scene
+  struct AlprPlateGroup
+  {
+    int track_id;
+    int64_t first_seen_epoch;
+    int64_t last_seen_epoch;
+
+    // Frames the plate was recognized in.  Frames that reused earlier results only extend last_seen_epoch
+    int frame_count;
+
+    // The text with the highest combined score over all frames
+    AlprPlate bestPlate;
+
+    // Every text read for this plate, best first.  The confidence is the highest seen for that text
+    std::vector<AlprPlate> candidates;
+
+    // The single most confident sighting, and the frame it came from
+    AlprPlateResult bestResult;
+    cv::Mat bestFrame;
+  };
+
+  // Associates the plates found on consecutive video frames, and skips recognition
+  // of frames that show nothing new
+  class PlateTracker
+  {
+    public:
+      PlateTracker(float minOverlap = 0.3, int maxTextDistance = 2, int maxMissedFrames = 8,
+                   int stableFrameCount = 3, float maxPixelChange = 4.0, int maxReusedFrames = 15);
+      virtual ~PlateTracker();
+
+      // Recognizes the frame and updates the tracks.  When every visible plate belongs to a stable track
+      // and nothing in the frame has changed since the last recognition, the previous results are reused instead.
+      // Groups for tracks that ended on this frame are appended to finishedGroups
+      AlprResults recognize(Alpr* alpr, cv::Mat frame, std::vector<AlprRegionOfInterest> regionsOfInterest,
+                            std::vector<AlprPlateGroup>& finishedGroups);
+
+      // Updates the tracks for a frame that is known to be unchanged (e.g., no motion was detected)
+      // without recognizing it.  Returns the previous results
+      AlprResults skipRecognition(cv::Mat frame, std::vector<AlprPlateGroup>& finishedGroups);
+
+      // Updates the tracks with results the caller recognized itself, as recognize() does with its own.
+      // skipRecognition() reuses them, and the next recognize() call always recognizes its frame
+      void addResults(cv::Mat frame, const AlprResults& results, std::vector<AlprPlateGroup>& finishedGroups);
+
+      // True if the last recognize() call reused the previous results
+      bool lastFrameReused();
+
+      // Ends every open track and returns their groups
+      std::vector<AlprPlateGroup> flush();
+
+      static std::string toJson(const AlprPlateGroup& group);
+
+      // Appends the JSON for the group to output, followed by the extra fields
+      static void toJson(const AlprPlateGroup& group, std::string& output,
+                         const std::vector<AlprJsonField>& extraFields = std::vector<AlprJsonField>());
+
+    private:
+
+      struct TextScore
+      {
+        AlprPlate plate;
+        float score_total;
+        int count;
+      };
+
+      struct PlateTrack
+      {
+        int id;
+        cv::Rect rect;
+        int64_t first_seen_epoch;
+        int64_t last_seen_epoch;
+        int frame_count;
+        int missed_frames;
+
+        std::map<std::string, TextScore> text_scores;
+        std::string leading_text;
+
+        AlprPlateResult best_result;
+        cv::Mat best_frame;
+      };
+
+      float minOverlap;
+      int maxTextDistance;
+      int maxMissedFrames;
+      int stableFrameCount;
+      float maxPixelChange;
+      int maxReusedFrames;
+
+      std::vector<PlateTrack> tracks;
+      int next_track_id;
+
+      // The last frame that went through full recognition
+      cv::Mat reference_gray;
+      cv::Mat reference_thumbnail;
+      AlprResults cached_results;
+      int reused_frames;
+      bool last_frame_reused;
+
+      bool frameUnchanged(cv::Mat gray, cv::Mat thumbnail);
+      void update(cv::Mat frame, AlprResults& results, int64_t epoch_time, bool reused,
+                  std::vector<AlprPlateGroup>& finishedGroups);
+      void addSighting(PlateTrack& track, cv::Mat frame, const AlprPlateResult& plate, int64_t epoch_time, bool reused);
+      AlprPlateGroup createGroup(const PlateTrack& track);
+
+      static bool compareTextScores(const TextScore& a, const TextScore& b);
+  };
+
+}
+
+#endif // OPENALPR_PLATETRACKER_H
@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2015 OpenALPR Technology, Inc.
+ * Open source Automated License Plate Recognition [http://www.openalpr.com]
+ *
+ * This file is part of OpenALPR.
+ *
+ * OpenALPR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "patternautomaton.h"
+
+#include "support/utf8.h"
+
+using namespace std;
+
+namespace alpr
+{
+
+  PatternAutomaton::PatternAutomaton(std::vector<RegexRule*> rules)
+  {
+    this->rules = rules;
+    this->num_rules = rules.size();
+    this->words = (num_rules + 63) / 64;
+
+    max_length = 0;
+    for (int r = 0; r < num_rules; r++)
+      max_length = max(max_length, rules[r]->length());
+
+    length_masks.assign((max_length + 1) * words, 0);
+    for (int r = 0; r < num_rules; r++)
+      length_masks[rules[r]->length() * words + r / 64] |= ((uint64_t) 1) << (r % 64);
+
+    // Most patterns share a handful of position regexes (letter, number, any), so each
+    // distinct regex is evaluated once per character
+    ascii_masks.assign(max_length * ASCII_SIZE * words, 0);
+    map<string, bool> pattern_cache;
+    for (int c = 1; c < ASCII_SIZE; c++)
+    {
+      pattern_cache.clear();
+      addCharacter(c, &ascii_masks[c * words], ASCII_SIZE * words, &pattern_cache);
+    }
+  }
+
+  PatternAutomaton::~PatternAutomaton()
+  {
+  }
+
+  int PatternAutomaton::numRules()
+  {
+    return num_rules;
+  }
+
+  void PatternAutomaton::addCharacter(int codepoint, uint64_t* masks, int stride, std::map<std::string, bool>* pattern_cache)
+  {
+    string character = utf8chr(codepoint);
+
+    for (int r = 0; r < num_rules; r++)
+    {
+      for (int p = 0; p < rules[r]->length(); p++)
+      {
+        string pattern = rules[r]->getPositionPattern(p);
+        if (pattern.length() == 0)
+          continue;
+
+        map<string, bool>::iterator cached = pattern_cache->find(pattern);
+        bool allowed;
+        if (cached == pattern_cache->end())
+        {
+          allowed = rules[r]->matchesAt(p, character);
+          (*pattern_cache)[pattern] = allowed;
+        }
+        else
+        {
+          allowed = cached->second;
+        }
+
+        if (allowed)
+          masks[p * stride + r / 64] |= ((uint64_t) 1) << (r % 64);
+      }
+    }
+  }
+
+  const uint64_t* PatternAutomaton::characterMasks(int codepoint, int& stride)
+  {
+    if (codepoint >= 0 && codepoint < ASCII_SIZE)
+    {
+      stride = ASCII_SIZE * words;
+      return &ascii_masks[codepoint * words];
+    }
+
+    stride = words;
+    map<int, vector<uint64_t> >::iterator existing = other_masks.find(codepoint);
+    if (existing != other_masks.end())
+      return &existing->second[0];
+
+    vector<uint64_t>& masks = other_masks[codepoint];
+    masks.assign(max(max_length, 1) * words, 0);
+    if (codepoint > 0)
+    {
+      map<string, bool> pattern_cache;
+      addCharacter(codepoint, &masks[0], words, &pattern_cache);
+    }
+    return &masks[0];
+  }
+
+  void PatternAutomaton::start(State& state)
+  {
+    state.assign(words, 0);
+    for (int r = 0; r < num_rules; r++)
+      state[r / 64] |= ((uint64_t) 1) << (r % 64);
+  }
+
+  bool PatternAutomaton::advance(State& state, int position, int codepoint)
+  {
+    bool alive = false;
+    if (position < 0 || position >= max_length)
+    {
+      state.assign(words, 0);
+      return false;
+    }
+
+    int stride;
+    const uint64_t* masks = characterMasks(codepoint, stride) + position * stride;
+    for (int w = 0; w < words; w++)
+    {
+      state[w] &= masks[w];
+      alive = alive || state[w] != 0;
+    }
+
+    return alive;
+  }
+
+  static inline int firstBit(uint64_t bits)
+  {
+    int bit = 0;
+    while ((bits & 1) == 0)
+    {
+      bits >>= 1;
+      bit++;
+    }
+    return bit;
+  }
+
+  int PatternAutomaton::firstRule(const State& state)
+  {
+    for (int w = 0; w < words; w++)
+    {
+      if (state[w] != 0)
+        return w * 64 + firstBit(state[w]);
+    }
+    return -1;
+  }
+
+  int PatternAutomaton::match(const State& state, int length)
+  {
+    if (length < 0 || length > max_length)
+      return -1;
+
+    for (int w = 0; w < words; w++)
+    {
+      uint64_t matches = state[w] & length_masks[length * words + w];
+      if (matches != 0)
+        return w * 64 + firstBit(matches);
+    }
+    return -1;
+  }
+
+  int PatternAutomaton::match(const std::string& text)
+  {
+    if (num_rules == 0 || utf8::find_invalid(text.begin(), text.end()) != text.end())
+      return -1;
+
+    State state;
+    start(state);
+
+    int position = 0;
+    string::const_iterator utf_iterator = text.begin();
+    while (utf_iterator != text.end())
+    {
+      int cp = utf8::next(utf_iterator, text.end());
+      if (!advance(state, position, cp))
+        return -1;
+      position++;
+    }
+
+    return match(state, position);
+  }
+
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2015 OpenALPR Technology, Inc.
+ * Open source Automated License Plate Recognition [http://www.openalpr.com]
+ *
+ * This file is part of OpenALPR.
+ *
+ * OpenALPR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPENALPR_PATTERNAUTOMATON_H
+#define OPENALPR_PATTERNAUTOMATON_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "regexrule.h"
+
+namespace alpr
+{
+
+  // All the patterns of one region compiled into lookup tables.  For every pattern position and
+  // character there is a bitset of the rules that allow it, so a plate is matched one character at a
+  // time by ANDing bitsets.  The state after a prefix tells whether any pattern can still match.
+  //
+  // ASCII is tabulated up front.  Other characters are added the first time they are seen,
+  // so one automaton must not be shared between threads.
+  class PatternAutomaton
+  {
+    public:
+      // Rule order is kept: lower rule numbers are earlier (more likely) patterns
+      PatternAutomaton(std::vector<RegexRule*> rules);
+      virtual ~PatternAutomaton();
+
+      // The rules that still agree with every character fed so far
+      typedef std::vector<uint64_t> State;
+
+      void start(State& state);
+
+      // Feeds the character at the given text position.  Returns false once no rule can match the prefix
+      bool advance(State& state, int position, int codepoint);
+
+      // First rule still matching the prefix, or -1 if none does.  Lower is a more likely pattern
+      int firstRule(const State& state);
+
+      // First rule that matches the complete text of the given length, or -1
+      int match(const State& state, int length);
+
+      // Matches a complete plate.  Returns the first matching rule, or -1
+      int match(const std::string& text);
+
+      int numRules();
+
+    private:
+      static const int ASCII_SIZE = 128;
+
+      std::vector<RegexRule*> rules;
+      int num_rules;
+      int words;
+      int max_length;
+
+      // [position][character][word] for ASCII characters
+      std::vector<uint64_t> ascii_masks;
+
+      // [position][word] for each non-ASCII character seen so far
+      std::map<int, std::vector<uint64_t> > other_masks;
+
+      // [length][word]: the rules with exactly that many characters
+      std::vector<uint64_t> length_masks;
+
+      void addCharacter(int codepoint, uint64_t* masks, int stride, std::map<std::string, bool>* pattern_cache);
+      const uint64_t* characterMasks(int codepoint, int& stride);
+  };
+
+}
+
+#endif // OPENALPR_PATTERNAUTOMATON_H
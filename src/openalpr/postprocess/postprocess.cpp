@@ -18,6 +18,7 @@
 */
 
 #include "postprocess.h"
+#include "pipeline_statistics.h"
 
 using namespace std;
 
@@ -70,6 +71,10 @@ namespace alpr
         delete iter->second[i];
       }
     }
+
+    map<string, PatternAutomaton*>::iterator automaton;
+    for (automaton = automata.begin(); automaton != automata.end(); ++automaton)
+      delete automaton->second;
   }
   
   void PostProcess::setConfidenceThreshold(float min_confidence, float skip_level) {
@@ -239,10 +244,13 @@ namespace alpr
       cout << allPossibilities.size() << " total permutations" << endl;
     }
 
+    timespec endTime;
+    getTimeMonotonic(&endTime);
+    if (config->statistics != NULL)
+      config->statistics->recordStage(STAGE_POSTPROCESS, diffclock(startTime, endTime));
+
     if (config->debugTiming)
     {
-      timespec endTime;
-      getTimeMonotonic(&endTime);
       cout << "PostProcess Time: " << diffclock(startTime, endTime) << "ms." << endl;
     }
 
@@ -283,70 +291,181 @@ namespace alpr
   }
 
   struct PermutationCompare {
-    bool operator() (pair<float,vector<int> > &a, pair<float,vector<int> > &b)
+    bool operator() (const pair<float,int> &a, const pair<float,int> &b) const
     {
+      // On equal scores, the permutation found first is processed first
+      if (a.first == b.first)
+        return a.second > b.second;
       return (a.first < b.first);
     }
   };
 
+  const unsigned int SEARCH_HASH_INITIAL_SLOTS = 256;
+
+  static inline unsigned int hashSlot(uint64_t hash, unsigned int num_slots)
+  {
+    hash ^= hash >> 31;
+    hash *= 0x7FB5D329728EA185ULL;
+    hash ^= hash >> 27;
+    return (unsigned int) (hash & (num_slots - 1));
+  }
+
   void PostProcess::findAllPermutations(string templateregion, int topn) {
 
+    int num_positions = letters.size();
+
+    // A permutation hash is the sum of a key per position times the letter index,
+    // so a child's hash is its parent's plus one key
+    while (position_hash_keys.size() < letters.size())
+      position_hash_keys.push_back((position_hash_keys.size() + 1) * 0x9E3779B97F4A7C15ULL);
+
+    bool applyTemplate = templateregion != "";
+    PatternAutomaton* automaton = applyTemplate ? getAutomaton(templateregion) : NULL;
+
+    search_arena.clear();
+    search_scores.clear();
+    search_hashes.clear();
+    search_slots.assign(SEARCH_HASH_INITIAL_SLOTS, -1);
+
     // use a priority queue to process permutations in highest scoring order
-    priority_queue<pair<float,vector<int> >, vector<pair<float,vector<int> > >, PermutationCompare> permutations;
-    set<float> permutationHashes;
+    priority_queue<pair<float,int>, vector<pair<float,int> >, PermutationCompare> permutations;
 
     // push the first word onto the queue
     float totalscore = 0;
-    for (int i=0; i<letters.size(); i++)
+    for (int i=0; i<num_positions; i++)
     {
       if (letters[i].size() > 0)
         totalscore += letters[i][0].totalscore;
     }
-    vector<int> v(letters.size());
-    permutations.push(make_pair(totalscore, v));
+    search_arena.resize(num_positions, 0);
+    search_scores.push_back(totalscore);
+    search_hashes.push_back(0);
+    search_slots[hashSlot(0, search_slots.size())] = 0;
+    permutations.push(make_pair(totalscore, 0));
 
     int consecutiveNonMatches = 0;
     while (permutations.size() > 0)
     {
       // get the top permutation and analyze
-      pair<float, vector<int> > topPermutation = permutations.top();
-      if (analyzePermutation(topPermutation.second, templateregion, topn) == true)
+      int state = permutations.top().second;
+      permutations.pop();
+
+      int dead_position;
+      if (analyzePermutation(state, automaton, applyTemplate, dead_position) == true)
         consecutiveNonMatches = 0;
       else
         consecutiveNonMatches += 1;
-      permutations.pop();
 
       if (allPossibilities.size() >= topn || consecutiveNonMatches >= (topn*2))
         break;
 
-      // add child permutations to queue
-      for (int i=0; i<letters.size(); i++)
+      // add child permutations to queue.  If the letters up to dead_position can never be accepted, neither
+      // can any permutation that only changes later letters.  Every permutation that changes an earlier letter
+      // is still reachable through those earlier positions, so the later ones are skipped
+      for (int i=0; i<num_positions && i <= dead_position; i++)
       {
+        int letter_index = search_arena[state * num_positions + i];
+
         // no more permutations with this letter
-        if (topPermutation.second[i]+1 >= letters[i].size())
+        if (letter_index+1 >= letters[i].size())
           continue;
 
-        pair<float, vector<int> > childPermutation = topPermutation;
-        childPermutation.first -= letters[i][topPermutation.second[i]].totalscore - letters[i][topPermutation.second[i] + 1].totalscore;
-        childPermutation.second[i] += 1;
-
-        // ignore permutations that have already been visited (assume that score is a good hash for permutation)
-        if (permutationHashes.end() != permutationHashes.find(childPermutation.first))
+        // ignore permutations that have already been visited
+        int child = addSearchState(state, i);
+        if (child < 0)
           continue;
 
-        permutations.push(childPermutation);
-        permutationHashes.insert(childPermutation.first);
+        float childscore = search_scores[state] - (letters[i][letter_index].totalscore - letters[i][letter_index + 1].totalscore);
+        search_scores.push_back(childscore);
+        permutations.push(make_pair(childscore, child));
       }
     }
   }
 
-  bool PostProcess::analyzePermutation(vector<int> letterIndices, string templateregion, int topn)
+  int PostProcess::addSearchState(int parent, int position)
   {
-    PPResult possibility;
-    possibility.letters = "";
-    possibility.totalscore = 0;
-    possibility.matchesTemplate = false;
+    int num_positions = letters.size();
+    int child = search_hashes.size();
+    uint64_t hash = search_hashes[parent] + position_hash_keys[position];
+
+    int parent_offset = parent * num_positions;
+    unsigned int slot = hashSlot(hash, search_slots.size());
+    while (search_slots[slot] >= 0)
+    {
+      int other = search_slots[slot];
+      if (search_hashes[other] == hash)
+      {
+        // Compare the letter indices, so a hash collision never hides a permutation
+        int other_offset = other * num_positions;
+        bool same = true;
+        for (int i = 0; i < num_positions && same; i++)
+          same = search_arena[other_offset + i] == search_arena[parent_offset + i] + (i == position ? 1 : 0);
+
+        if (same)
+          return -1;
+      }
+      slot = (slot + 1) & (search_slots.size() - 1);
+    }
+
+    search_arena.resize(search_arena.size() + num_positions);
+    int child_offset = child * num_positions;
+    for (int i = 0; i < num_positions; i++)
+      search_arena[child_offset + i] = search_arena[parent_offset + i];
+    search_arena[child_offset + position] += 1;
+
+    search_hashes.push_back(hash);
+    search_slots[slot] = child;
+
+    // Keep the table at most half full
+    if (search_hashes.size() * 2 > search_slots.size())
+      resizeSearchHash(search_slots.size() * 2);
+
+    return child;
+  }
+
+  void PostProcess::resizeSearchHash(unsigned int slots)
+  {
+    search_slots.assign(slots, -1);
+    for (unsigned int state = 0; state < search_hashes.size(); state++)
+    {
+      unsigned int slot = hashSlot(search_hashes[state], slots);
+      while (search_slots[slot] >= 0)
+        slot = (slot + 1) & (slots - 1);
+      search_slots[slot] = state;
+    }
+  }
+
+  PatternAutomaton* PostProcess::getAutomaton(std::string templateregion)
+  {
+    map<string, PatternAutomaton*>::iterator existing = automata.find(templateregion);
+    if (existing != automata.end())
+      return existing->second;
+
+    map<string, vector<RegexRule*> >::iterator regionRules = rules.find(templateregion);
+    if (regionRules == rules.end())
+      return NULL;
+
+    PatternAutomaton* automaton = new PatternAutomaton(regionRules->second);
+    automata[templateregion] = automaton;
+    return automaton;
+  }
+
+  bool PostProcess::analyzePermutation(int state, PatternAutomaton* automaton, bool applyTemplate, int& dead_position)
+  {
+    const int* letterIndices = &search_arena[state * letters.size()];
+
+    // The automaton state holds the patterns that match every character so far.  When a pattern match is
+    // required, the permutation is rejected as soon as none is left
+    bool requireMatch = config->mustMatchPattern && applyTemplate;
+    bool patternsAlive = automaton != NULL;
+    if (automaton != NULL)
+      automaton->start(candidate_state);
+
+    candidate_letters.clear();
+    int text_length = 0;
     int plate_char_length = 0;
+    float totalscore = 0;
+    dead_position = letters.size();
 
     int last_line = 0;
     for (int i = 0; i < letters.size(); i++)
@@ -354,59 +473,78 @@ namespace alpr
       if (letters[i].size() == 0)
         continue;
 
-      Letter letter = letters[i][letterIndices[i]];
+      const Letter& letter = letters[i][letterIndices[i]];
 
       // Add a "\n" on new lines
       if (letter.line_index != last_line)
       {
-        possibility.letters = possibility.letters + "\n";
+        candidate_letters.append("\n");
+        if (patternsAlive)
+          patternsAlive = automaton->advance(candidate_state, text_length, '\n');
+        text_length++;
       }
       last_line = letter.line_index;
-      
+
       if (letter.letter != SKIP_CHAR)
       {
-        possibility.letters = possibility.letters + letter.letter;
-        possibility.letter_details.push_back(letter);
+        candidate_letters.append(letter.letter);
         plate_char_length += 1;
-      }
-      possibility.totalscore = possibility.totalscore + letter.totalscore;
-    }
 
-    // ignore plates that don't fit the length requirements
-    if (plate_char_length < config->postProcessMinCharacters ||
-      plate_char_length > config->postProcessMaxCharacters)
-      return false;
+        if (utf8::is_valid(letter.letter.begin(), letter.letter.end()))
+        {
+          string::const_iterator utf_iterator = letter.letter.begin();
+          while (utf_iterator != letter.letter.end())
+          {
+            int cp = utf8::unchecked::next(utf_iterator);
+            if (patternsAlive)
+              patternsAlive = automaton->advance(candidate_state, text_length, cp);
+            text_length++;
+          }
+        }
+        else
+        {
+          patternsAlive = false;
+          text_length += letter.letter.length();
+        }
+      }
 
-    // Apply templates
-    if (templateregion != "")
-    {
-      vector<RegexRule*> regionRules = rules[templateregion];
+      totalscore = totalscore + letter.totalscore;
 
-      for (int i = 0; i < regionRules.size(); i++)
+      // ignore plates that don't fit the length requirements
+      if ((requireMatch && !patternsAlive) || plate_char_length > config->postProcessMaxCharacters)
       {
-        possibility.matchesTemplate = regionRules[i]->match(possibility.letters);
-        if (possibility.matchesTemplate)
-        {
-          break;
-        }
+        dead_position = i;
+        return false;
       }
     }
 
+    if (plate_char_length < config->postProcessMinCharacters)
+      return false;
+
+    bool matchesTemplate = patternsAlive && automaton->match(candidate_state, text_length) >= 0;
+
     // ignore duplicate words
-    if (allPossibilitiesLetters.end() != allPossibilitiesLetters.find(possibility.letters))
+    if (allPossibilitiesLetters.end() != allPossibilitiesLetters.find(candidate_letters))
       return false;
 
     // If mustMatchPattern is toggled in the config and a template is provided, 
     // only include this result if there is a pattern match
-    if (!config->mustMatchPattern || templateregion.size() == 0 || 
-        (config->mustMatchPattern && possibility.matchesTemplate))
+    if (requireMatch && !matchesTemplate)
+      return false;
+
+    PPResult possibility;
+    possibility.letters = candidate_letters;
+    possibility.totalscore = totalscore;
+    possibility.matchesTemplate = matchesTemplate;
+    for (int i = 0; i < letters.size(); i++)
     {
-      allPossibilities.push_back(possibility);
-      allPossibilitiesLetters.insert(possibility.letters);
-      return true;
+      if (letters[i].size() > 0 && letters[i][letterIndices[i]].letter != SKIP_CHAR)
+        possibility.letter_details.push_back(letters[i][letterIndices[i]]);
     }
-    
-    return false;
+
+    allPossibilities.push_back(possibility);
+    allPossibilitiesLetters.insert(possibility.letters);
+    return true;
   }
 
   std::vector<string> PostProcess::getPatterns() {
@@ -21,6 +21,7 @@
 #define OPENALPR_POSTPROCESS_H
 
 #include "regexrule.h"
+#include "patternautomaton.h"
 #include "constants.h"
 #include "utility.h"
 #include <fstream>
@@ -29,6 +30,7 @@
 #include <queue>
 #include <vector>
 #include <set>
+#include <stdint.h>
 #include "config.h"
 
 
@@ -83,11 +85,22 @@ namespace alpr
       Config* config;
 
       void findAllPermutations(std::string templateregion, int topn);
-      bool analyzePermutation(std::vector<int> letterIndices, std::string templateregion, int topn);
+      // dead_position is set to the first letter position whose prefix can never be accepted
+      // (too long, or no pattern matches it when one is required), or the number of positions if there is none
+      bool analyzePermutation(int state, PatternAutomaton* automaton, bool applyTemplate, int& dead_position);
+
+      // Adds the permutation of the parent state with one position advanced to its next letter.
+      // Returns the new state, or -1 if that permutation has already been visited
+      int addSearchState(int parent, int position);
+      void resizeSearchHash(unsigned int slots);
+
+      // The compiled patterns for a region, built the first time the region is used.  NULL for unknown regions
+      PatternAutomaton* getAutomaton(std::string templateregion);
 
       void insertLetter(std::string letter, int line_index, int charPosition, float score);
 
       std::map<std::string, std::vector<RegexRule*> > rules;
+      std::map<std::string, PatternAutomaton*> automata;
 
       float calculateMaxConfidenceScore();
 
@@ -96,6 +109,16 @@ namespace alpr
 
       std::vector<PPResult> allPossibilities;
       std::set<std::string> allPossibilitiesLetters;
+
+      // Permutation search buffers, reused between calls.  Each state is one letter index per
+      // position, stored back to back in search_arena
+      std::vector<int> search_arena;
+      std::vector<float> search_scores;
+      std::vector<uint64_t> search_hashes;
+      std::vector<int> search_slots;
+      std::vector<uint64_t> position_hash_keys;
+      std::string candidate_letters;
+      PatternAutomaton::State candidate_state;
       
       float min_confidence;
       float skip_level;
@@ -43,6 +43,8 @@ namespace alpr
     }
     
     std::stringstream regexval;
+    vector<string> position_patterns;
+    std::stringstream positionval;
     string::iterator utf_iterator = pattern.begin();
     numchars = 0;
     while (utf_iterator < pattern.end())
@@ -54,7 +56,7 @@ namespace alpr
       
       if (utf_character == "[")
       {
-        regexval << "[";
+        positionval << "[";
         
         while (utf_character != "]" )
         {
@@ -63,27 +65,27 @@ namespace alpr
           int cp = utf8::next(utf_iterator, pattern.end());
 
           utf_character = utf8chr(cp);
-          regexval << utf_character;
+          positionval << utf_character;
         }
         
       }
       else if (utf_character == "\\")
       {
         // Don't add "\" characters to our character count
-        regexval << utf_character;
+        positionval << utf_character;
         continue;
       }
       else if (utf_character == "?")
       {
-        regexval << ".";
+        positionval << ".";
       }
       else if (utf_character == "@")
       {
-        regexval << letters_regex;
+        positionval << letters_regex;
       }
       else if (utf_character == "#")
       {
-        regexval << numbers_regex;
+        positionval << numbers_regex;
       }
       else if ((utf_character == "*") || (utf_character == "+"))
       {
@@ -91,9 +93,12 @@ namespace alpr
       }
       else
       {
-        regexval << utf_character;
+        positionval << utf_character;
       }
 
+      regexval << positionval.str();
+      position_patterns.push_back(positionval.str());
+      positionval.str("");
       numchars++;
     }
 
@@ -109,6 +114,21 @@ namespace alpr
     else
     {
       this->valid = true;
+
+      for (unsigned int i = 0; i < position_patterns.size(); i++)
+      {
+        re2::RE2* position_regex = NULL;
+        if (position_patterns[i].length() > 0)
+        {
+          position_regex = new re2::RE2(position_patterns[i], re2::RE2::Quiet);
+          if (!position_regex->ok())
+          {
+            delete position_regex;
+            position_regex = NULL;
+          }
+        }
+        position_regexes.push_back(position_regex);
+      }
     }
   }
   
@@ -116,6 +136,50 @@ namespace alpr
   RegexRule::~RegexRule()
   {
     delete re2_regex;
+
+    for (unsigned int i = 0; i < position_regexes.size(); i++)
+      delete position_regexes[i];
+  }
+
+  int RegexRule::length()
+  {
+    return numchars;
+  }
+
+  bool RegexRule::matchesAt(int position, const std::string& characters)
+  {
+    if (!this->valid || position < 0)
+      return false;
+
+    if (utf8::find_invalid(characters.begin(), characters.end()) != characters.end())
+      return false;
+
+    string::const_iterator utf_iterator = characters.begin();
+    while (utf_iterator != characters.end())
+    {
+      if (position >= (int) position_regexes.size() || position_regexes[position] == NULL)
+        return false;
+
+      string::const_iterator character_start = utf_iterator;
+      utf8::next(utf_iterator, characters.end());
+
+      re2::StringPiece character(&(*character_start), utf_iterator - character_start);
+      if (!re2::RE2::FullMatch(character, *position_regexes[position]))
+        return false;
+
+      position++;
+    }
+
+    return true;
+  }
+
+  std::string RegexRule::getPositionPattern(int position)
+  {
+    if (!this->valid || position < 0 || position >= (int) position_regexes.size() ||
+        position_regexes[position] == NULL)
+      return "";
+
+    return position_regexes[position]->pattern();
   }
 
   bool RegexRule::match(string text)
@@ -38,11 +38,24 @@ namespace alpr
 
       bool match(std::string text);
 
+      // Number of characters in the pattern
+      int length();
+
+      // True if the (UTF-8) characters are allowed starting at the given position of the pattern.
+      // Lets a partially built plate be checked a few characters at a time
+      bool matchesAt(int position, const std::string& characters);
+
+      // The regex for one pattern position.  Empty if nothing can match there
+      std::string getPositionPattern(int position);
+
     private:
       bool valid;
       
       int numchars;
       re2::RE2* re2_regex;
+
+      // One regex per pattern position.  NULL for positions that can never match
+      std::vector<re2::RE2*> position_regexes;
       std::string original;
       std::string regex;
       std::string region;
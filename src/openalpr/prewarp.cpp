@@ -31,12 +31,15 @@ namespace alpr
   PreWarp::PreWarp(Config* config)
   {
     this->config = config;
+    this->version = 0;
     initialize(config->prewarp);
   }
   
 
   void PreWarp::initialize(std::string prewarp_config) {
 
+    version++;
+
     timespec startTime;
     getTimeMonotonic(&startTime);
     
@@ -106,6 +109,7 @@ namespace alpr
   }
   void PreWarp::clear() {
     this->valid = false;
+    version++;
   }
 
   PreWarp::~PreWarp() {
@@ -123,6 +127,10 @@ namespace alpr
     return sstream.str();
   }
 
+  unsigned int PreWarp::getVersion() {
+    return version;
+  }
+
   void PreWarp::setTransform(float w, float h, float rotationx, float rotationy, float rotationz, float panX, float panY, float stretchX, float dist)
   {
     this->w = w;
@@ -136,6 +144,7 @@ namespace alpr
     this->dist = dist;
     
     this->valid = true;
+    version++;
   }
   
   cv::Mat PreWarp::warpImage(Mat image) {
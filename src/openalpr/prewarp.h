@@ -48,6 +48,10 @@ namespace alpr
     bool valid;
     
     std::string toString();
+
+    // Incremented whenever the transform changes or is cleared.  Lets cached, warped data
+    // be checked for staleness without comparing the whole configuration
+    unsigned int getVersion();
     
   private:
     Config* config;
@@ -56,6 +60,8 @@ namespace alpr
     cv::Mat getTransform(float w, float h, float rotationx, float rotationy, float rotationz, float panX, float panY, float stretchX, float dist);
     
     float w, h, rotationx, rotationy, rotationz, stretchX, dist, panX, panY;
+
+    unsigned int version;
     
   };
 
@@ -27,14 +27,12 @@ namespace alpr
 
   ResultAggregator::ResultAggregator(ResultMergeStrategy merge_strategy, int topn, Config* config)
   {
-    this->prewarp = new PreWarp(config);
     this->merge_strategy = merge_strategy;
     this->topn = topn;
     this->config = config;
   }
 
   ResultAggregator::~ResultAggregator() {
-    delete prewarp;
   }
 
 
@@ -42,6 +40,34 @@ namespace alpr
   {
     all_results.push_back(full_results);
   }
+
+  bool ResultAggregator::resultsAgree(unsigned int count, float min_confidence)
+  {
+    if (all_results.size() < count || count == 0)
+      return false;
+
+    vector<string> first_plates;
+    for (unsigned int i = 0; i < count; i++)
+    {
+      vector<string> best_plates;
+      for (unsigned int k = 0; k < all_results[i].results.plates.size(); k++)
+      {
+        AlprPlate bestPlate = all_results[i].results.plates[k].bestPlate;
+        if (bestPlate.overall_confidence < min_confidence)
+          return false;
+
+        best_plates.push_back(bestPlate.characters);
+      }
+      std::sort(best_plates.begin(), best_plates.end());
+
+      if (i == 0)
+        first_plates = best_plates;
+      else if (best_plates != first_plates)
+        return false;
+    }
+
+    return true;
+  }
   
 
   cv::Mat ResultAggregator::applyImperceptibleChange(cv::Mat image, int index) {
@@ -72,10 +98,12 @@ namespace alpr
     
     //cout << "Iteration: " << index << ": " << x_rotation << ", " << y_rotation << ", " << z_rotation << endl;
     
-    prewarp->setTransform(WIDTH_HEIGHT, WIDTH_HEIGHT, x_rotation, y_rotation, z_rotation, 
+    // Each iteration gets its own warp, so iterations can run concurrently
+    PreWarp prewarp(config);
+    prewarp.setTransform(WIDTH_HEIGHT, WIDTH_HEIGHT, x_rotation, y_rotation, z_rotation, 
             NO_PAN_VAL, NO_PAN_VAL, NO_MOVE_WIDTH_DIST, NO_MOVE_WIDTH_DIST);
     
-    return prewarp->warpImage(image);
+    return prewarp.warpImage(image);
   }
 
   bool compareScore(const std::pair<float, ResultPlateScore>& firstElem, const std::pair<float, ResultPlateScore>& secondElem) {
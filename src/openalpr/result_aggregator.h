@@ -66,6 +66,9 @@ namespace alpr
 
     void addResults(AlprFullDetails full_results);
 
+    // True when the first count results found the same best plates, each with at least min_confidence
+    bool resultsAgree(unsigned int count, float min_confidence);
+
     AlprFullDetails getAggregateResults();
 
     cv::Mat applyImperceptibleChange(cv::Mat image, int index);
@@ -73,7 +76,6 @@ namespace alpr
   private:
     
     int topn;
-    PreWarp* prewarp;
     Config* config;
     
     std::vector<AlprFullDetails> all_results;
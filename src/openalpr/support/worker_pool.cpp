@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2015 OpenALPR Technology, Inc.
+ * Open source Automated License Plate Recognition [http://www.openalpr.com]
+ *
+ * This file is part of OpenALPR.
+ *
+ * OpenALPR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "worker_pool.h"
+
+namespace alpr
+{
+
+  WorkerPool::WorkerPool(int num_threads)
+  {
+    if (num_threads <= 0)
+      num_threads = tthread::thread::hardware_concurrency();
+    if (num_threads <= 0)
+      num_threads = 1;
+
+    this->num_threads = num_threads;
+    this->shutting_down = false;
+
+    // The caller of run() is always one of the workers
+    for (int i = 1; i < num_threads; i++)
+      threads.push_back(new tthread::thread(workerThread, (void*) this));
+  }
+
+  WorkerPool::~WorkerPool()
+  {
+    jobs_mutex.lock();
+    shutting_down = true;
+    job_available.notify_all();
+    jobs_mutex.unlock();
+
+    for (unsigned int i = 0; i < threads.size(); i++)
+    {
+      threads[i]->join();
+      delete threads[i];
+    }
+  }
+
+  int WorkerPool::getNumThreads()
+  {
+    return num_threads;
+  }
+
+  void WorkerPool::run(WorkerTask task, std::vector<void*>& args)
+  {
+    if (threads.size() == 0 || args.size() <= 1)
+    {
+      for (unsigned int i = 0; i < args.size(); i++)
+        task(args[i]);
+      return;
+    }
+
+    Batch batch;
+    batch.remaining = args.size();
+
+    jobs_mutex.lock();
+    for (unsigned int i = 0; i < args.size(); i++)
+    {
+      Job job;
+      job.task = task;
+      job.arg = args[i];
+      job.batch = &batch;
+      jobs.push_back(job);
+    }
+    job_available.notify_all();
+
+    // Help out with our own batch until every job has been picked up,
+    // then wait for the jobs still running on the pool threads.
+    while (batch.remaining > 0)
+    {
+      Job job;
+      if (popJob(&batch, job))
+      {
+        jobs_mutex.unlock();
+        job.task(job.arg);
+        jobs_mutex.lock();
+        finishJob(job);
+      }
+      else
+      {
+        job_finished.wait(jobs_mutex);
+      }
+    }
+    jobs_mutex.unlock();
+  }
+
+  // Must be called with jobs_mutex held.  A NULL batch takes any job.
+  bool WorkerPool::popJob(Batch* batch, Job& job)
+  {
+    for (std::deque<Job>::iterator it = jobs.begin(); it != jobs.end(); it++)
+    {
+      if (batch == NULL || it->batch == batch)
+      {
+        job = *it;
+        jobs.erase(it);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Must be called with jobs_mutex held.
+  void WorkerPool::finishJob(Job& job)
+  {
+    job.batch->remaining--;
+    if (job.batch->remaining == 0)
+      job_finished.notify_all();
+  }
+
+  void WorkerPool::workerThread(void* arg)
+  {
+    WorkerPool* pool = (WorkerPool*) arg;
+
+    pool->jobs_mutex.lock();
+    while (true)
+    {
+      Job job;
+      if (pool->popJob(NULL, job))
+      {
+        pool->jobs_mutex.unlock();
+        job.task(job.arg);
+        pool->jobs_mutex.lock();
+        pool->finishJob(job);
+      }
+      else if (pool->shutting_down)
+      {
+        break;
+      }
+      else
+      {
+        pool->job_available.wait(pool->jobs_mutex);
+      }
+    }
+    pool->jobs_mutex.unlock();
+  }
+
+}
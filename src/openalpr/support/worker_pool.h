@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2015 OpenALPR Technology, Inc.
+ * Open source Automated License Plate Recognition [http://www.openalpr.com]
+ *
+ * This file is part of OpenALPR.
+ *
+ * OpenALPR is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License
+ * version 3 as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPENALPR_WORKERPOOL_H
+#define OPENALPR_WORKERPOOL_H
+
+#include <deque>
+#include <vector>
+
+#include "tinythread.h"
+
+namespace alpr
+{
+
+  typedef void (*WorkerTask)(void* arg);
+
+  // A fixed set of threads that execute batches of tasks.
+  // The thread calling run() works on its own batch alongside the pool threads,
+  // so tasks may safely call run() again on the same pool without deadlocking.
+  class WorkerPool
+  {
+    public:
+      // num_threads is the total parallelism, including the calling thread.
+      // A value of 0 uses the number of hardware cores.  1 runs every task inline.
+      WorkerPool(int num_threads);
+      virtual ~WorkerPool();
+
+      int getNumThreads();
+
+      // Runs task(args[i]) for every argument and blocks until all of them have completed.
+      void run(WorkerTask task, std::vector<void*>& args);
+
+    private:
+
+      struct Batch
+      {
+        int remaining;
+      };
+
+      struct Job
+      {
+        WorkerTask task;
+        void* arg;
+        Batch* batch;
+      };
+
+      int num_threads;
+      bool shutting_down;
+
+      std::deque<Job> jobs;
+      std::vector<tthread::thread*> threads;
+
+      tthread::mutex jobs_mutex;
+      tthread::condition_variable job_available;
+      tthread::condition_variable job_finished;
+
+      bool popJob(Batch* batch, Job& job);
+      void finishJob(Job& job);
+
+      static void workerThread(void* arg);
+  };
+
+}
+
+#endif // OPENALPR_WORKERPOOL_H
@@ -121,18 +121,12 @@ namespace alpr
 
   vector<Mat> produceThresholds(const Mat img_gray, Config* config)
   {
-    const int THRESHOLD_COUNT = 3;
     //Mat img_equalized = equalizeBrightness(img_gray);
 
     timespec startTime;
     getTimeMonotonic(&startTime);
 
-    vector<Mat> thresholds;
-
-    for (int i = 0; i < THRESHOLD_COUNT; i++)
-      thresholds.push_back(Mat(img_gray.size(), CV_8U));
-
-    int i = 0;
+    vector<NiblackParams> params;
 
     // Adaptive
     //adaptiveThreshold(img_gray, thresholds[i++], 255, ADAPTIVE_THRESH_MEAN_C, THRESH_BINARY_INV , 7, 3);
@@ -141,25 +135,21 @@ namespace alpr
 
     // Wolf
     int k = 0, win=18;
-    //NiblackSauvolaWolfJolion (img_gray, thresholds[i++], WOLFJOLION, win, win, 0.05 + (k * 0.35));
-    //bitwise_not(thresholds[i-1], thresholds[i-1]);
-    NiblackSauvolaWolfJolion (img_gray, thresholds[i++], WOLFJOLION, win, win, 0.05 + (k * 0.35));
-    bitwise_not(thresholds[i-1], thresholds[i-1]);
+    params.push_back(niblackParams(WOLFJOLION, win, win, 0.05 + (k * 0.35)));
 
     k = 1;
     win = 22;
-    NiblackSauvolaWolfJolion (img_gray, thresholds[i++], WOLFJOLION, win, win, 0.05 + (k * 0.35));
-    bitwise_not(thresholds[i-1], thresholds[i-1]);
-    //NiblackSauvolaWolfJolion (img_gray, thresholds[i++], WOLFJOLION, win, win, 0.05 + (k * 0.35));
-    //bitwise_not(thresholds[i-1], thresholds[i-1]);
+    params.push_back(niblackParams(WOLFJOLION, win, win, 0.05 + (k * 0.35)));
 
     // Sauvola
     k = 1;
-    NiblackSauvolaWolfJolion (img_gray, thresholds[i++], SAUVOLA, 12, 12, 0.18 * k);
-    bitwise_not(thresholds[i-1], thresholds[i-1]);
+    params.push_back(niblackParams(SAUVOLA, 12, 12, 0.18 * k));
     //k=2;
-    //NiblackSauvolaWolfJolion (img_gray, thresholds[i++], SAUVOLA, 12, 12, 0.18 * k);
-    //bitwise_not(thresholds[i-1], thresholds[i-1]);
+    //params.push_back(niblackParams(SAUVOLA, 12, 12, 0.18 * k));
+
+    // All of the thresholds share one pass over the image, and come out inverted
+    vector<Mat> thresholds;
+    NiblackSauvolaWolfJolionMulti(img_gray, thresholds, params, true);
 
     if (config->debugTiming)
     {
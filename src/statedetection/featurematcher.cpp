@@ -19,6 +19,19 @@
 
 #include "featurematcher.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 using namespace cv;
 using namespace std;
 
@@ -29,10 +42,93 @@ namespace alpr
   //const int DEFAULT_TRAINING_FEATURES = 305;
   const float MAX_DISTANCE_TO_MATCH = 100.0f;
 
+  // LSH index shape.  Each table hashes LSH_KEY_SIZE bits of the 512 bit BRISK descriptor
+  const int LSH_TABLES = 8;
+  const int LSH_KEY_SIZE = 12;
+
+  // Compiled keypoint database layout.  All values are 32 bit, in native byte order:
+  //   header:     magic, version, image count, descriptor columns, descriptor type,
+  //               source image count, source hash (low, high)
+  //   per image:  label length, label (padded to 4 bytes), keypoint count, descriptor rows,
+  //               keypoints (x, y, size, angle, response, octave, class_id),
+  //               descriptors (rows * columns * element size, padded to 4 bytes)
+  const uint32_t KEYPOINT_DB_MAGIC = 0x504B414F; // "OAKP"
+  const uint32_t KEYPOINT_DB_VERSION = 2;
+  const std::string KEYPOINT_DB_EXTENSION = ".kpdb";
+  const int KEYPOINT_DB_HEADER_SIZE = 8;
+
+  struct CompiledKeypoint
+  {
+    float x;
+    float y;
+    float size;
+    float angle;
+    float response;
+    int32_t octave;
+    int32_t class_id;
+  };
+
+  static size_t padTo4(size_t length)
+  {
+    return (length + 3) & ~((size_t) 3);
+  }
+
+  static void fnv1a(uint64_t& hash, const char* data, size_t length)
+  {
+    for (size_t i = 0; i < length; i++)
+    {
+      hash ^= (unsigned char) data[i];
+      hash *= 1099511628211ULL;
+    }
+  }
+
+  // Counts the keypoint images in the directory and hashes their names and contents, in name order.
+  // The compiled database records both, so it is not used once the images change.  Timestamps
+  // are not used, since copying or installing the runtime data changes them
+  static bool hashKeypointImages(const string& country_dir, uint32_t& image_count, uint64_t& hash)
+  {
+    if (!DirectoryExists(country_dir.c_str()))
+      return false;
+
+    vector<string> files = getFilesInDir(country_dir.c_str());
+    std::sort(files.begin(), files.end());
+
+    image_count = 0;
+    hash = 14695981039346656037ULL;
+
+    vector<char> buffer(65536);
+    for (unsigned int i = 0; i < files.size(); i++)
+    {
+      if (hasEnding(files[i], ".jpg") == false)
+        continue;
+
+      std::ifstream infile((country_dir + files[i]).c_str(), std::ios::in | std::ios::binary);
+      if (!infile.is_open())
+        return false;
+
+      image_count++;
+      fnv1a(hash, files[i].c_str(), files[i].length() + 1);
+
+      while (infile)
+      {
+        infile.read(&buffer[0], buffer.size());
+        fnv1a(hash, &buffer[0], infile.gcount());
+      }
+    }
+
+    return true;
+  }
+
   FeatureMatcher::FeatureMatcher()
   {
+    this->compiled_data = NULL;
+    this->compiled_size = 0;
+    this->source_image_count = 0;
+    this->source_hash = 0;
+
     //this->descriptorMatcher = DescriptorMatcher::create( "BruteForce-HammingLUT" );
     this->descriptorMatcher = new BFMatcher(NORM_HAMMING, false);
+    this->indexedMatching = false;
 
     //this->descriptorMatcher = DescriptorMatcher::create( "FlannBased" );
 #if OPENCV_MAJOR_VERSION == 2
@@ -55,6 +151,9 @@ namespace alpr
     descriptorMatcher.release();
     detector.release();
     extractor.release();
+
+    trainingDescriptors.clear();
+    unloadCompiledData();
   }
 
   bool FeatureMatcher::isLoaded()
@@ -67,6 +166,27 @@ namespace alpr
     return true;
   }
 
+  void FeatureMatcher::setIndexedMatching(bool enabled, int probeLevel)
+  {
+    if (enabled)
+    {
+      cv::Ptr<flann::IndexParams> indexParams(new flann::LshIndexParams(LSH_TABLES, LSH_KEY_SIZE, std::max(probeLevel, 0)));
+      this->descriptorMatcher = new FlannBasedMatcher(indexParams);
+    }
+    else
+    {
+      this->descriptorMatcher = new BFMatcher(NORM_HAMMING, false);
+    }
+    this->indexedMatching = enabled;
+
+    // Rebuild the index for the descriptors that are already loaded
+    if (trainingDescriptors.size() > 0)
+    {
+      this->descriptorMatcher->add(trainingDescriptors);
+      this->descriptorMatcher->train();
+    }
+  }
+
   int FeatureMatcher::numTrainingElements()
   {
     return billMapping.size();
@@ -77,7 +197,27 @@ namespace alpr
   {
     vector<vector<DMatch> > matchesKnn;
 
-    this->descriptorMatcher->radiusMatch(queryDescriptors, matchesKnn, MAX_DISTANCE_TO_MATCH);
+    if (indexedMatching)
+    {
+      // Only the two closest matches are used below, so a 2-NN search of the index is equivalent to the radius
+      // search.  The LSH index does not support radius searches well, so filter by distance here instead
+      this->descriptorMatcher->knnMatch(queryDescriptors, matchesKnn, 2);
+      matchesKnn.resize(queryDescriptors.rows);
+      for (unsigned int i = 0; i < matchesKnn.size(); i++)
+      {
+        vector<DMatch> inRange;
+        for (unsigned int j = 0; j < matchesKnn[i].size(); j++)
+        {
+          if (matchesKnn[i][j].trainIdx >= 0 && matchesKnn[i][j].distance < MAX_DISTANCE_TO_MATCH)
+            inRange.push_back(matchesKnn[i][j]);
+        }
+        matchesKnn[i] = inRange;
+      }
+    }
+    else
+    {
+      this->descriptorMatcher->radiusMatch(queryDescriptors, matchesKnn, MAX_DISTANCE_TO_MATCH);
+    }
 
     vector<DMatch> tempMatches;
     _surfStyleMatching(queryDescriptors, matchesKnn, tempMatches);
@@ -242,9 +382,23 @@ namespace alpr
     out << directory << "/keypoints/" << country << "/";
     string country_dir = out.str();
 
+    string compiled_file = directory + "/keypoints/" + country + KEYPOINT_DB_EXTENSION;
+    if (fileExists(compiled_file.c_str()) && loadCompiledRecognitionSet(compiled_file, country_dir))
+      return true;
+
+    return loadRecognitionImages(country_dir);
+  }
+
+  bool FeatureMatcher::loadRecognitionImages(string country_dir)
+  {
     if (DirectoryExists(country_dir.c_str()))
     {
-      vector<Mat> trainImages;
+      if (!hashKeypointImages(country_dir, source_image_count, source_hash))
+      {
+        source_image_count = 0;
+        source_hash = 0;
+      }
+
       vector<string> plateFiles = getFilesInDir(country_dir.c_str());
 
       for (unsigned int i = 0; i < plateFiles.size(); i++)
@@ -255,15 +409,15 @@ namespace alpr
         string fullpath = country_dir + plateFiles[i];
         Mat img = imread( fullpath );
 
-        // convert to gray and resize to the size of the templates
-        cvtColor(img, img, CV_BGR2GRAY);
-
         if( img.empty() )
         {
           cout << "Can not read images" << endl;
-          return -1;
+          return false;
         }
 
+        // convert to gray and resize to the size of the templates
+        cvtColor(img, img, CV_BGR2GRAY);
+
         Mat descriptors;
 
         vector<KeyPoint> keypoints;
@@ -273,12 +427,12 @@ namespace alpr
         if (descriptors.cols > 0)
         {
           billMapping.push_back(plateFiles[i].substr(0, 2));
-          trainImages.push_back(descriptors);
+          trainingDescriptors.push_back(descriptors);
           trainingImgKeypoints.push_back(keypoints);
         }
       }
 
-      this->descriptorMatcher->add(trainImages);
+      this->descriptorMatcher->add(trainingDescriptors);
       this->descriptorMatcher->train();
 
       return true;
@@ -287,6 +441,227 @@ namespace alpr
     return false;
   }
 
+  bool FeatureMatcher::saveRecognitionSet(string filename)
+  {
+    if (trainingDescriptors.size() == 0)
+      return false;
+
+    std::ofstream outfile(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!outfile.is_open())
+      return false;
+
+    const char padding[4] = {0, 0, 0, 0};
+    uint32_t header[KEYPOINT_DB_HEADER_SIZE];
+    header[0] = KEYPOINT_DB_MAGIC;
+    header[1] = KEYPOINT_DB_VERSION;
+    header[2] = trainingDescriptors.size();
+    header[3] = trainingDescriptors[0].cols;
+    header[4] = trainingDescriptors[0].type();
+    header[5] = source_image_count;
+    header[6] = (uint32_t) source_hash;
+    header[7] = (uint32_t) (source_hash >> 32);
+    outfile.write((const char*) header, sizeof(header));
+
+    for (unsigned int i = 0; i < trainingDescriptors.size(); i++)
+    {
+      const Mat& descriptors = trainingDescriptors[i];
+      if ((uint32_t) descriptors.cols != header[3] || (uint32_t) descriptors.type() != header[4] || !descriptors.isContinuous())
+        return false;
+
+      uint32_t label_length = billMapping[i].length();
+      outfile.write((const char*) &label_length, sizeof(label_length));
+      outfile.write(billMapping[i].c_str(), label_length);
+      outfile.write(padding, padTo4(label_length) - label_length);
+
+      uint32_t counts[2];
+      counts[0] = trainingImgKeypoints[i].size();
+      counts[1] = descriptors.rows;
+      outfile.write((const char*) counts, sizeof(counts));
+
+      for (unsigned int k = 0; k < trainingImgKeypoints[i].size(); k++)
+      {
+        const KeyPoint& keypoint = trainingImgKeypoints[i][k];
+        CompiledKeypoint compiled;
+        compiled.x = keypoint.pt.x;
+        compiled.y = keypoint.pt.y;
+        compiled.size = keypoint.size;
+        compiled.angle = keypoint.angle;
+        compiled.response = keypoint.response;
+        compiled.octave = keypoint.octave;
+        compiled.class_id = keypoint.class_id;
+        outfile.write((const char*) &compiled, sizeof(compiled));
+      }
+
+      size_t descriptor_bytes = descriptors.rows * descriptors.cols * descriptors.elemSize();
+      outfile.write((const char*) descriptors.data, descriptor_bytes);
+      outfile.write(padding, padTo4(descriptor_bytes) - descriptor_bytes);
+    }
+
+    outfile.close();
+    return !outfile.fail();
+  }
+
+  bool FeatureMatcher::loadCompiledRecognitionSet(string filename, string country_dir)
+  {
+    unloadCompiledData();
+
+#ifdef _WIN32
+    // No mmap, read the file into memory instead
+    std::ifstream infile(filename.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+    if (!infile.is_open())
+      return false;
+
+    compiled_size = infile.tellg();
+    compiled_data = malloc(compiled_size);
+    infile.seekg(0, std::ios::beg);
+    infile.read((char*) compiled_data, compiled_size);
+    if (infile.fail())
+    {
+      unloadCompiledData();
+      return false;
+    }
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+    {
+      close(fd);
+      return false;
+    }
+
+    void* mapped = mmap(NULL, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+      return false;
+
+    compiled_data = mapped;
+    compiled_size = file_stat.st_size;
+#endif
+
+    const unsigned char* data = (const unsigned char*) compiled_data;
+    size_t offset = 0;
+
+    // Validate every length against the file size, so a truncated or corrupt file fails to load instead of crashing
+    uint32_t header[KEYPOINT_DB_HEADER_SIZE];
+    if (compiled_size < sizeof(header))
+    {
+      unloadCompiledData();
+      return false;
+    }
+    memcpy(header, data, sizeof(header));
+    offset += sizeof(header);
+
+    if (header[0] != KEYPOINT_DB_MAGIC || header[1] != KEYPOINT_DB_VERSION)
+    {
+      unloadCompiledData();
+      return false;
+    }
+
+    uint64_t compiled_hash = header[6] | ((uint64_t) header[7] << 32);
+
+    uint32_t image_count;
+    uint64_t image_hash;
+    if (country_dir.length() > 0 && hashKeypointImages(country_dir, image_count, image_hash) &&
+        (image_count != header[5] || image_hash != compiled_hash))
+    {
+      cerr << filename << " was compiled from different images than " << country_dir
+           << ", ignoring it.  Rebuild it with openalpr-utils-compilekeypoints" << endl;
+      unloadCompiledData();
+      return false;
+    }
+
+    uint32_t num_images = header[2];
+    int descriptor_cols = header[3];
+    int descriptor_type = header[4];
+    size_t descriptor_elem_size = CV_ELEM_SIZE(descriptor_type);
+
+    vector<string> labels;
+    vector<Mat> descriptors;
+    vector<vector<KeyPoint> > keypoints;
+
+    bool valid = true;
+    for (uint32_t i = 0; i < num_images && valid; i++)
+    {
+      uint32_t label_length;
+      if (offset + sizeof(label_length) > compiled_size)
+      {
+        valid = false;
+        break;
+      }
+      memcpy(&label_length, data + offset, sizeof(label_length));
+      offset += sizeof(label_length);
+
+      if (offset + padTo4(label_length) + 2 * sizeof(uint32_t) > compiled_size)
+      {
+        valid = false;
+        break;
+      }
+      labels.push_back(string((const char*) data + offset, label_length));
+      offset += padTo4(label_length);
+
+      uint32_t counts[2];
+      memcpy(counts, data + offset, sizeof(counts));
+      offset += sizeof(counts);
+
+      size_t keypoint_bytes = (size_t) counts[0] * sizeof(CompiledKeypoint);
+      size_t descriptor_bytes = (size_t) counts[1] * descriptor_cols * descriptor_elem_size;
+      if (offset + keypoint_bytes + padTo4(descriptor_bytes) > compiled_size)
+      {
+        valid = false;
+        break;
+      }
+
+      const CompiledKeypoint* compiled = (const CompiledKeypoint*) (data + offset);
+      vector<KeyPoint> image_keypoints(counts[0]);
+      for (uint32_t k = 0; k < counts[0]; k++)
+      {
+        image_keypoints[k] = KeyPoint(compiled[k].x, compiled[k].y, compiled[k].size, compiled[k].angle,
+                                      compiled[k].response, compiled[k].octave, compiled[k].class_id);
+      }
+      keypoints.push_back(image_keypoints);
+      offset += keypoint_bytes;
+
+      // Point straight into the mapped file.  The matcher never modifies its training descriptors
+      descriptors.push_back(Mat(counts[1], descriptor_cols, descriptor_type, (void*) (data + offset)));
+      offset += padTo4(descriptor_bytes);
+    }
+
+    if (!valid || labels.size() == 0)
+    {
+      unloadCompiledData();
+      return false;
+    }
+
+    billMapping = labels;
+    trainingImgKeypoints = keypoints;
+    trainingDescriptors = descriptors;
+    source_image_count = header[5];
+    source_hash = compiled_hash;
+
+    this->descriptorMatcher->add(trainingDescriptors);
+    this->descriptorMatcher->train();
+
+    return true;
+  }
+
+  void FeatureMatcher::unloadCompiledData()
+  {
+    if (compiled_data == NULL)
+      return;
+
+#ifdef _WIN32
+    free(compiled_data);
+#else
+    munmap(compiled_data, compiled_size);
+#endif
+
+    compiled_data = NULL;
+    compiled_size = 0;
+  }
+
   RecognitionResult FeatureMatcher::recognize( const Mat& queryImg, bool drawOnImage, Mat* outputImage,
       bool debug_on, vector<int> debug_matches_array
                                              )
@@ -23,9 +23,12 @@
 #include "opencv2/calib3d/calib3d.hpp"
 #include "opencv2/imgproc/imgproc.hpp"
 #include "opencv2/features2d/features2d.hpp"
+#include "opencv2/flann/flann.hpp"
 #include "opencv2/video/tracking.hpp"
 #include "opencv2/highgui/highgui.hpp"
 
+#include <stdint.h>
+
 #include "line_segment.h"
 #include "support/filesystem.h"
 
@@ -49,19 +52,48 @@ namespace alpr
       RecognitionResult recognize( const cv::Mat& queryImg, bool drawOnImage, cv::Mat* outputImage,
                                    bool debug_on, std::vector<int> debug_matches_array );
 
+      // Loads the compiled keypoint database (runtime_dir/keypoints/<country>.kpdb) if there is one and it
+      // was compiled from the current images, otherwise computes the keypoints for every image in
+      // runtime_dir/keypoints/<country>/
       bool loadRecognitionSet(std::string runtime_dir, std::string country);
 
+      // Computes the keypoints for every image in the directory
+      bool loadRecognitionImages(std::string country_dir);
+
+      // Writes the loaded keypoints, descriptors and labels to a compiled keypoint database
+      bool saveRecognitionSet(std::string filename);
+
+      // Memory maps a compiled keypoint database.  The descriptors are used in place, so the pages
+      // are shared by every process that loads the same file.  If country_dir is given and exists, the
+      // file is rejected unless it was compiled from exactly the images in that directory
+      bool loadCompiledRecognitionSet(std::string filename, std::string country_dir = "");
+
       bool isLoaded();
 
+      // Matches against an LSH index of the training descriptors instead of every descriptor.  probeLevel is the
+      // number of neighboring hash buckets also searched; higher finds more of the true matches, but is slower
+      void setIndexedMatching(bool enabled, int probeLevel);
+
       int numTrainingElements();
 
     private:
 
       cv::Ptr<cv::DescriptorMatcher> descriptorMatcher;
+      bool indexedMatching;
       cv::Ptr<cv::FastFeatureDetector> detector;
       cv::Ptr<cv::BRISK> extractor;
 
       std::vector<std::vector<cv::KeyPoint> > trainingImgKeypoints;
+      std::vector<cv::Mat> trainingDescriptors;
+
+      // The compiled keypoint database that trainingDescriptors point into (NULL if not loaded from one)
+      void* compiled_data;
+      size_t compiled_size;
+
+      // The number of keypoint images the set was computed from, and a hash of them
+      uint32_t source_image_count;
+      uint64_t source_hash;
+      void unloadCompiledData();
 
       void _surfStyleMatching(const cv::Mat& queryDescriptors, std::vector<std::vector<cv::DMatch> > matchesKnn, std::vector<cv::DMatch>& matches12);
 
@@ -40,6 +40,10 @@ namespace alpr {
     impl->setTopN(topN);
   }
 
+  void StateDetector::setIndexedMatching(bool enabled, int probeLevel) {
+    impl->featureMatcher.setIndexedMatching(enabled, probeLevel);
+  }
+
   vector<StateCandidate> StateDetector::detect(vector<char> imageBytes) {
     return impl->detect(imageBytes);
   }
@@ -43,6 +43,10 @@ namespace alpr {
       // Maximum number of candidates to return
       void setTopN(int topN);
 
+      // Search an LSH index of the templates instead of comparing against all of them.
+      // Higher probe levels find more matches, at the cost of speed
+      void setIndexedMatching(bool enabled, int probeLevel);
+
       // Given an image of a license plate, provide the likely state candidates
       std::vector<StateCandidate> detect(std::vector<char> imageBytes);
       std::vector<StateCandidate> detect(unsigned char* pixelData, int bytesPerPixel, int imgWidth, int imgHeight);
@@ -8,8 +8,11 @@
 #define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
 
 #include <cstdlib>
+#include <sstream>
 #include "catch.hpp"
 #include "alpr.h"
+#include "cjson.h"
+#include "json_writer.h"
 #include "support/timing.h"
 
 
@@ -93,3 +96,156 @@ TEST_CASE( "JSON Serialization/Deserialization", "[json]" ) {
   }
   
 }
+
+TEST_CASE( "JSON Writer matches cJSON formatting", "[json]" ) {
+
+  double numbers[] = { 0, 1, -1, 42, 0.5, -2.75, 3.14159, 0.1f, 99.5f, 1e-7, 1e10, -1e12,
+                       2147483647.0, 2147483648.0, -2147483649.0, 1456789012345.0 };
+  for (unsigned int i = 0; i < sizeof(numbers) / sizeof(numbers[0]); i++)
+  {
+    cJSON* item = cJSON_CreateNumber(numbers[i]);
+    char* out = cJSON_PrintUnformatted(item);
+    std::string expected(out);
+    free(out);
+    cJSON_Delete(item);
+
+    std::string actual;
+    JsonWriter::appendNumber(actual, numbers[i]);
+    REQUIRE( actual == expected );
+  }
+
+  std::string strings[] = { "", "abc123", "quote\" back\\slash", "tab\tnew\nline\r", "\x01\x1f", "multi\nline plate" };
+  for (unsigned int i = 0; i < sizeof(strings) / sizeof(strings[0]); i++)
+  {
+    cJSON* item = cJSON_CreateString(strings[i].c_str());
+    char* out = cJSON_PrintUnformatted(item);
+    std::string expected(out);
+    free(out);
+    cJSON_Delete(item);
+
+    std::string actual;
+    JsonWriter::appendString(actual, strings[i]);
+    REQUIRE( actual == expected );
+  }
+}
+
+TEST_CASE( "JSON Serialization with extra fields", "[json]" ) {
+
+  AlprResults results;
+  results.epoch_time = getEpochTimeMs();
+  results.img_width = 1280;
+  results.img_height = 720;
+  results.total_processing_time_ms = 55.5;
+  results.regionsOfInterest.push_back(AlprRegionOfInterest(0,0,1280,720));
+
+  AlprPlateResult apr;
+  AlprPlate ap;
+  ap.characters = "ABC123";
+  ap.matches_template = true;
+  ap.overall_confidence = 91.25;
+  apr.topNPlates.push_back(ap);
+  apr.bestPlate = ap;
+  for (int i = 0; i < 4; i++)
+  {
+    apr.plate_points[i].x = i * 10;
+    apr.plate_points[i].y = i * 5;
+  }
+  apr.processing_time_ms = 12;
+  apr.requested_topn = 10;
+  apr.plate_index = 0;
+  apr.region = "";
+  apr.regionConfidence = 0;
+  results.plates.push_back(apr);
+
+  std::vector<AlprJsonField> fields;
+  fields.push_back(AlprJsonField("uuid", "site-cam1-1234"));
+  fields.push_back(AlprJsonField("camera_id", 7));
+
+  // The JSON is appended to whatever the buffer already holds
+  std::string buffer = "[";
+  Alpr::toJson(results, buffer, fields);
+  REQUIRE( buffer.substr(0, 1) == "[" );
+
+  std::string json = buffer.substr(1);
+  REQUIRE( json == Alpr::toJson(results).substr(0, Alpr::toJson(results).length() - 1) + ",\"uuid\":\"site-cam1-1234\",\"camera_id\":7}" );
+
+  cJSON* root = cJSON_Parse(json.c_str());
+  REQUIRE( root != NULL );
+  REQUIRE( std::string(cJSON_GetObjectItem(root, "uuid")->valuestring) == "site-cam1-1234" );
+  REQUIRE( cJSON_GetObjectItem(root, "camera_id")->valueint == 7 );
+  cJSON_Delete(root);
+
+  AlprResults roundTrip = Alpr::fromJson(json);
+  REQUIRE( roundTrip.img_width == results.img_width );
+  REQUIRE( roundTrip.plates.size() == 1 );
+  REQUIRE( roundTrip.plates[0].bestPlate.characters == "ABC123" );
+}
+
+TEST_CASE( "JSON Deserialization validation", "[json]" ) {
+
+  AlprResults results;
+  std::string error;
+
+  // Only the frame details, the results and each plate's coordinates are required
+  std::string minimal = "{\"epoch_time\":1456789012345,\"img_width\":640,\"img_height\":480,\"results\":"
+                        "[{\"plate\":\"ABC123\",\"coordinates\":[{\"x\":1,\"y\":2},{\"x\":3,\"y\":4},{\"x\":5,\"y\":6},{\"x\":7,\"y\":8}]}]}";
+  REQUIRE( Alpr::fromJson(minimal, results, error) );
+  REQUIRE( error == "" );
+  REQUIRE( results.epoch_time == 1456789012345LL );
+  REQUIRE( results.regionsOfInterest.size() == 0 );
+  REQUIRE( results.plates.size() == 1 );
+  REQUIRE( results.plates[0].bestPlate.characters == "ABC123" );
+  REQUIRE( results.plates[0].topNPlates.size() == 0 );
+  REQUIRE( results.plates[0].region == "" );
+  REQUIRE( results.plates[0].plate_points[3].x == 7 );
+
+  std::string missing = "{\"epoch_time\":1456789012345,\"img_width\":640,\"results\":[]}";
+  REQUIRE( Alpr::fromJson(missing, results, error) == false );
+  REQUIRE( error.find("img_height") != std::string::npos );
+
+  std::string wrongType = "{\"epoch_time\":1,\"img_width\":640,\"img_height\":480,\"results\":"
+                          "[{\"coordinates\":[{\"x\":1,\"y\":2},{\"x\":3,\"y\":4},{\"x\":5,\"y\":6},{\"x\":7,\"y\":\"8\"}]}]}";
+  REQUIRE( Alpr::fromJson(wrongType, results, error) == false );
+  REQUIRE( error.find("results[0].coordinates[3]") != std::string::npos );
+
+  std::string truncated = minimal.substr(0, minimal.length() / 2);
+  REQUIRE( Alpr::fromJson(truncated, results, error) == false );
+  REQUIRE( Alpr::fromJson("", results, error) == false );
+  REQUIRE( Alpr::fromJson(minimal + "}", results, error) == false );
+
+  // Invalid input gives empty results instead of crashing
+  REQUIRE( Alpr::fromJson(truncated).plates.size() == 0 );
+}
+
+TEST_CASE( "JSON Lines Reader", "[json]" ) {
+
+  AlprResults results;
+  results.epoch_time = 1000;
+  results.img_width = 640;
+  results.img_height = 480;
+  results.total_processing_time_ms = 10;
+
+  std::stringstream lines;
+  for (int i = 0; i < 3; i++)
+  {
+    results.epoch_time++;
+    lines << Alpr::toJson(results) << "\n";
+  }
+  lines << "{\"epoch_time\":\n";
+  lines << "\n";
+  results.epoch_time++;
+  lines << Alpr::toJson(results) << "\r\n";
+
+  AlprJsonLinesReader reader(lines);
+  AlprResults line;
+  std::vector<int64_t> epochs;
+  while (reader.next(line))
+    epochs.push_back(line.epoch_time);
+
+  REQUIRE( epochs.size() == 4 );
+  REQUIRE( epochs[0] == 1001 );
+  REQUIRE( epochs[3] == 1004 );
+  REQUIRE( reader.errorCount() == 1 );
+  REQUIRE( reader.lastError().find("line 4") == 0 );
+  REQUIRE( reader.lineNumber() == 6 );
+}
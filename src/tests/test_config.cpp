@@ -64,4 +64,30 @@ TEST_CASE( "Reloading Countries", "[Config]" )
   REQUIRE(alpr.getConfig()->ocrLanguage == "leu");
 
 
-}
\ No newline at end of file
+}
+TEST_CASE( "Copying Common Values", "[Config]" )
+{
+  Config us_config("us", OPENALPR_TESTING_CONFIG_PATH, OPENALPR_TESTING_RUNTIME_DIR);
+  Config eu_config("eu", OPENALPR_TESTING_CONFIG_PATH, OPENALPR_TESTING_RUNTIME_DIR);
+
+  REQUIRE(eu_config.copyCommonValues(us_config) == false);
+  REQUIRE(eu_config.commonValuesDiffer(us_config) == false);
+
+  us_config.setDebug(true);
+  us_config.analysis_count = 3;
+
+  // Checking does not copy anything
+  REQUIRE(eu_config.commonValuesDiffer(us_config) == true);
+  REQUIRE(eu_config.analysis_count != 3);
+
+  REQUIRE(eu_config.copyCommonValues(us_config) == true);
+  REQUIRE(eu_config.debugTiming == true);
+  REQUIRE(eu_config.analysis_count == 3);
+
+  // Country specific values are left alone
+  REQUIRE(eu_config.ocrLanguage == "leu");
+  REQUIRE(eu_config.country == "eu");
+
+  REQUIRE(eu_config.copyCommonValues(us_config) == false);
+  REQUIRE(eu_config.commonValuesDiffer(us_config) == false);
+}
@@ -0,0 +1,90 @@
+#include <cstdlib>
+#include <algorithm>
+#include "utility.h"
+#include "catch.hpp"
+#include "config.h"
+#include "prewarp.h"
+#include "detection/detectorcpu.h"
+
+using namespace std;
+using namespace cv;
+using namespace alpr;
+
+static bool rectOrder(const Rect& a, const Rect& b)
+{
+  if (a.y != b.y) return a.y < b.y;
+  if (a.x != b.x) return a.x < b.x;
+  if (a.width != b.width) return a.width < b.width;
+  return a.height < b.height;
+}
+
+static vector<Rect> sorted(vector<Rect> rects)
+{
+  std::sort(rects.begin(), rects.end(), rectOrder);
+  return rects;
+}
+
+// A plate from the runtime data at a few sizes, on a noisy background
+static Mat samplePlateImage()
+{
+  Mat plate = imread(string(OPENALPR_TESTING_RUNTIME_DIR) + "keypoints/us/ca1993.jpg", CV_LOAD_IMAGE_GRAYSCALE);
+  REQUIRE( plate.empty() == false );
+
+  Mat frame(600, 900, CV_8U);
+  randu(frame, Scalar(60), Scalar(200));
+
+  int widths[] = { 120, 260, 480 };
+  int x = 20;
+  for (int i = 0; i < 3; i++)
+  {
+    Mat scaled;
+    resize(plate, scaled, Size(widths[i], widths[i] * plate.rows / plate.cols));
+    scaled.copyTo(frame(Rect(x, 50 + i * 60, scaled.cols, scaled.rows)));
+    x += widths[i] / 2;
+  }
+
+  return frame;
+}
+
+TEST_CASE( "Threaded detection matches single threaded", "[detection]" ) {
+
+  Config single_config("us", OPENALPR_TESTING_CONFIG_PATH, OPENALPR_TESTING_RUNTIME_DIR);
+  single_config.detectionThreads = 1;
+  PreWarp single_prewarp(&single_config);
+  DetectorCPU single(&single_config, &single_prewarp);
+
+  Config threaded_config("us", OPENALPR_TESTING_CONFIG_PATH, OPENALPR_TESTING_RUNTIME_DIR);
+  threaded_config.detectionThreads = 4;
+  PreWarp threaded_prewarp(&threaded_config);
+  DetectorCPU threaded(&threaded_config, &threaded_prewarp);
+
+  REQUIRE( single.isLoaded() );
+  REQUIRE( threaded.isLoaded() );
+
+  Mat frame = samplePlateImage();
+
+  // The full frame size reaches the scales above 2, which are searched differently
+  Size min_plate_size(single_config.minPlateSizeWidthPx, single_config.minPlateSizeHeightPx);
+  Size max_plate_size(frame.cols, frame.rows);
+
+  // find_plates equalizes the frame in place
+  vector<Rect> single_plates = single.find_plates(frame.clone(), min_plate_size, max_plate_size);
+  vector<Rect> threaded_plates = threaded.find_plates(frame.clone(), min_plate_size, max_plate_size);
+
+  REQUIRE( sorted(single_plates) == sorted(threaded_plates) );
+
+  // Overlapping regions of interest share the pyramid whether or not it is threaded
+  vector<Rect> regions;
+  regions.push_back(Rect(0, 0, 600, 400));
+  regions.push_back(Rect(300, 100, 600, 500));
+
+  vector<vector<Rect> > single_region_plates;
+  vector<vector<Rect> > threaded_region_plates;
+  REQUIRE( single.find_plates_in_regions(frame, regions, single_region_plates) );
+  REQUIRE( threaded.find_plates_in_regions(frame, regions, threaded_region_plates) );
+
+  REQUIRE( single_region_plates.size() == regions.size() );
+  REQUIRE( threaded_region_plates.size() == regions.size() );
+  for (unsigned int i = 0; i < regions.size(); i++)
+    REQUIRE( sorted(single_region_plates[i]) == sorted(threaded_region_plates[i]) );
+}
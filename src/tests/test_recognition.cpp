@@ -0,0 +1,92 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include "catch.hpp"
+#include "alpr.h"
+#include "opencv2/highgui/highgui.hpp"
+
+using namespace std;
+using namespace cv;
+using namespace alpr;
+
+// Copies the default config with a different max_threads value, and returns the path of the copy
+static string writeThreadsConfig(int max_threads)
+{
+  ifstream infile(OPENALPR_TESTING_CONFIG_PATH);
+  REQUIRE( infile.good() );
+
+  stringstream path;
+  path << "unittests_max_threads_" << max_threads << ".conf";
+
+  ofstream outfile(path.str().c_str());
+  string line;
+  while (getline(infile, line))
+  {
+    if (line.find("max_threads") == 0)
+      outfile << "max_threads = " << max_threads << "\n";
+    else
+      outfile << line << "\n";
+  }
+  outfile.close();
+
+  return path.str();
+}
+
+// Several plates from the runtime data spread over one frame
+static Mat multiPlateImage()
+{
+  const char* plates[] = { "ca1993.jpg", "fl2004.jpg", "ma1987.jpg", "tx2009.jpg" };
+  Point positions[] = { Point(40, 60), Point(700, 90), Point(120, 420), Point(820, 480) };
+
+  Mat frame(720, 1280, CV_8UC3, Scalar(110, 110, 110));
+  for (int i = 0; i < 4; i++)
+  {
+    Mat plate = imread(string(OPENALPR_TESTING_RUNTIME_DIR) + "keypoints/us/" + plates[i]);
+    REQUIRE( plate.empty() == false );
+    plate.copyTo(frame(Rect(positions[i].x, positions[i].y, plate.cols, plate.rows)));
+  }
+
+  return frame;
+}
+
+static AlprResults recognizeWithThreads(Mat frame, int max_threads)
+{
+  string config_file = writeThreadsConfig(max_threads);
+  Alpr alpr("us", config_file, OPENALPR_TESTING_RUNTIME_DIR);
+  remove(config_file.c_str());
+  REQUIRE( alpr.isLoaded() );
+
+  vector<AlprRegionOfInterest> regions;
+  regions.push_back(AlprRegionOfInterest(0, 0, frame.cols, frame.rows));
+  return alpr.recognize(frame.data, frame.elemSize(), frame.cols, frame.rows, regions);
+}
+
+TEST_CASE( "Threaded recognition matches single threaded", "[threading]" ) {
+
+  Mat frame = multiPlateImage();
+
+  AlprResults single = recognizeWithThreads(frame, 1);
+  AlprResults threaded = recognizeWithThreads(frame, 4);
+
+  // The regions are analyzed in waves on the pool, but the results keep the order of the regions
+  REQUIRE( threaded.plates.size() == single.plates.size() );
+  for (unsigned int i = 0; i < single.plates.size(); i++)
+  {
+    const AlprPlateResult& expected = single.plates[i];
+    const AlprPlateResult& actual = threaded.plates[i];
+
+    REQUIRE( actual.plate_index == expected.plate_index );
+    REQUIRE( actual.bestPlate.characters == expected.bestPlate.characters );
+    REQUIRE( actual.bestPlate.overall_confidence == Approx(expected.bestPlate.overall_confidence) );
+    for (int p = 0; p < 4; p++)
+    {
+      REQUIRE( actual.plate_points[p].x == expected.plate_points[p].x );
+      REQUIRE( actual.plate_points[p].y == expected.plate_points[p].y );
+    }
+
+    REQUIRE( actual.topNPlates.size() == expected.topNPlates.size() );
+    for (unsigned int j = 0; j < expected.topNPlates.size(); j++)
+      REQUIRE( actual.topNPlates[j].characters == expected.topNPlates[j].characters );
+  }
+}
@@ -2,6 +2,7 @@
 #include "utility.h"
 #include "catch.hpp"
 #include "postprocess/regexrule.h"
+#include "postprocess/patternautomaton.h"
 
 using namespace std;
 using namespace cv;
@@ -105,4 +106,57 @@ TEST_CASE( "Invalid tests", "[Regex]" ) {
   
   RegexRule rule2("us", "A####]", "\\pL", "\\pN");
   REQUIRE( rule2.match("A1234") == false);
-}
\ No newline at end of file
+}
+TEST_CASE( "Position tests", "[Regex]" ) {
+  RegexRule rule1("us", "[A-C]@#\\d", "[A-Z]", "[0-9]");
+
+  REQUIRE( rule1.length() == 4 );
+
+  REQUIRE( rule1.matchesAt(0, "B") == true);
+  REQUIRE( rule1.matchesAt(0, "D") == false);
+  REQUIRE( rule1.matchesAt(1, "Z") == true);
+  REQUIRE( rule1.matchesAt(1, "1") == false);
+  REQUIRE( rule1.matchesAt(2, "7") == true);
+  REQUIRE( rule1.matchesAt(3, "7") == true);
+  REQUIRE( rule1.matchesAt(3, "X") == false);
+  REQUIRE( rule1.matchesAt(4, "7") == false);
+
+  REQUIRE( rule1.matchesAt(1, "Z12") == true);
+  REQUIRE( rule1.matchesAt(2, "123") == false);
+
+  RegexRule rule2("us", "[십팔]@", "\\pL", "\\pN");
+  REQUIRE( rule2.matchesAt(0, "십") == true);
+  REQUIRE( rule2.matchesAt(0, "与") == false);
+  REQUIRE( rule2.matchesAt(1, "与") == true);
+}
+
+TEST_CASE( "Pattern automaton tests", "[Regex]" ) {
+  vector<RegexRule*> rules;
+  rules.push_back(new RegexRule("us", "@@@####", "[A-Z]", "[0-9]"));
+  rules.push_back(new RegexRule("us", "###@@@", "[A-Z]", "[0-9]"));
+  rules.push_back(new RegexRule("us", "[T][AR]##@@", "[A-Z]", "[0-9]"));
+
+  PatternAutomaton automaton(rules);
+
+  REQUIRE( automaton.match("ABC1234") == 0);
+  REQUIRE( automaton.match("123ABC") == 1);
+  REQUIRE( automaton.match("TR12AB") == 2);
+  REQUIRE( automaton.match("TX12AB") == -1);
+  REQUIRE( automaton.match("ABC123") == -1);
+  REQUIRE( automaton.match("ABC12345") == -1);
+  REQUIRE( automaton.match("") == -1);
+
+  // Prefixes
+  PatternAutomaton::State state;
+  automaton.start(state);
+  REQUIRE( automaton.advance(state, 0, 'T') == true);
+  REQUIRE( automaton.firstRule(state) == 0);
+  REQUIRE( automaton.advance(state, 1, 'A') == true);
+  REQUIRE( automaton.advance(state, 2, '1') == true);
+  REQUIRE( automaton.firstRule(state) == 2);
+  REQUIRE( automaton.match(state, 3) == -1);
+  REQUIRE( automaton.advance(state, 3, 'X') == false);
+
+  for (unsigned int i = 0; i < rules.size(); i++)
+    delete rules[i];
+}
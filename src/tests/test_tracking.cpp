@@ -0,0 +1,155 @@
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "catch.hpp"
+#include "alpr.h"
+#include "plate_tracker.h"
+
+using namespace std;
+using namespace cv;
+using namespace alpr;
+
+static AlprPlateResult plateAt(const string& characters, float confidence, Rect rect)
+{
+  AlprPlateResult plate;
+  plate.bestPlate.characters = characters;
+  plate.bestPlate.overall_confidence = confidence;
+  plate.bestPlate.matches_template = false;
+  plate.topNPlates.push_back(plate.bestPlate);
+
+  plate.plate_points[0].x = rect.x;                 plate.plate_points[0].y = rect.y;
+  plate.plate_points[1].x = rect.x + rect.width;    plate.plate_points[1].y = rect.y;
+  plate.plate_points[2].x = rect.x + rect.width;    plate.plate_points[2].y = rect.y + rect.height;
+  plate.plate_points[3].x = rect.x;                 plate.plate_points[3].y = rect.y + rect.height;
+
+  return plate;
+}
+
+static AlprResults frameResults(int64_t epoch_time)
+{
+  AlprResults results;
+  results.epoch_time = epoch_time;
+  results.img_width = 640;
+  results.img_height = 480;
+  results.total_processing_time_ms = 0;
+  return results;
+}
+
+TEST_CASE( "Plate tracker matches plates by overlap and by text", "[tracking]" ) {
+
+  // A plate ends two frames after it was last seen
+  PlateTracker tracker(0.3, 2, 2);
+  Mat frame(480, 640, CV_8UC3, Scalar(0, 0, 0));
+  vector<AlprPlateGroup> finished;
+
+  AlprResults results = frameResults(1000);
+  results.plates.push_back(plateAt("ABC123", 80, Rect(100, 100, 120, 40)));
+  tracker.addResults(frame, results, finished);
+
+  // Overlaps the first sighting, so it is the same plate even though it reads very differently
+  results = frameResults(1100);
+  results.plates.push_back(plateAt("XYZ789", 70, Rect(110, 104, 120, 40)));
+  tracker.addResults(frame, results, finished);
+
+  // No overlap, but close by and within 2 characters of the leading text.  The plate far away is a new one
+  results = frameResults(1200);
+  results.plates.push_back(plateAt("ABC128", 90, Rect(200, 110, 120, 40)));
+  results.plates.push_back(plateAt("ABC123", 85, Rect(450, 350, 120, 40)));
+  tracker.addResults(frame, results, finished);
+
+  // The first reading again, which makes it the leading text
+  results = frameResults(1300);
+  results.plates.push_back(plateAt("ABC123", 85, Rect(205, 112, 120, 40)));
+  tracker.addResults(frame, results, finished);
+
+  // Close by, but the text is too different
+  results = frameResults(1400);
+  results.plates.push_back(plateAt("QQQ555", 60, Rect(300, 110, 120, 40)));
+  tracker.addResults(frame, results, finished);
+
+  REQUIRE( finished.size() == 0 );
+
+  vector<AlprPlateGroup> groups = tracker.flush();
+  REQUIRE( groups.size() == 3 );
+
+  AlprPlateGroup& moving = groups[0];
+  REQUIRE( moving.track_id == 1 );
+  REQUIRE( moving.frame_count == 4 );
+  REQUIRE( moving.first_seen_epoch == 1000 );
+  REQUIRE( moving.last_seen_epoch == 1300 );
+
+  // The text with the highest combined score wins, each candidate keeps its most confident reading
+  REQUIRE( moving.bestPlate.characters == "ABC123" );
+  REQUIRE( moving.candidates.size() == 3 );
+  REQUIRE( moving.candidates[0].characters == "ABC123" );
+  REQUIRE( moving.candidates[0].overall_confidence == 85 );
+  REQUIRE( moving.candidates[1].characters == "ABC128" );
+  REQUIRE( moving.candidates[2].characters == "XYZ789" );
+
+  // The single most confident sighting
+  REQUIRE( moving.bestResult.bestPlate.characters == "ABC128" );
+  REQUIRE( moving.bestFrame.empty() == false );
+
+  REQUIRE( groups[1].track_id == 2 );
+  REQUIRE( groups[1].frame_count == 1 );
+  REQUIRE( groups[2].track_id == 3 );
+  REQUIRE( groups[2].bestPlate.characters == "QQQ555" );
+}
+
+TEST_CASE( "Plate tracker reports plates that left the scene", "[tracking]" ) {
+
+  PlateTracker tracker(0.3, 2, 2);
+  Mat frame(480, 640, CV_8UC3, Scalar(0, 0, 0));
+  vector<AlprPlateGroup> finished;
+
+  AlprResults results = frameResults(1000);
+  results.plates.push_back(plateAt("ABC123", 80, Rect(100, 100, 120, 40)));
+  tracker.addResults(frame, results, finished);
+
+  // Missing for up to maxMissedFrames frames keeps the track open
+  for (int i = 1; i <= 2; i++)
+  {
+    tracker.addResults(frame, frameResults(1000 + i * 100), finished);
+    REQUIRE( finished.size() == 0 );
+  }
+
+  tracker.addResults(frame, frameResults(1300), finished);
+  REQUIRE( finished.size() == 1 );
+  REQUIRE( finished[0].bestPlate.characters == "ABC123" );
+  REQUIRE( finished[0].last_seen_epoch == 1000 );
+
+  // Reported once
+  REQUIRE( tracker.flush().size() == 0 );
+}
+
+TEST_CASE( "Plate tracker does not count reused results", "[tracking]" ) {
+
+  PlateTracker tracker(0.3, 2, 2);
+  Mat frame(480, 640, CV_8UC3, Scalar(0, 0, 0));
+  vector<AlprPlateGroup> finished;
+
+  AlprResults results = frameResults(1000);
+  results.plates.push_back(plateAt("ABC123", 80, Rect(100, 100, 120, 40)));
+  tracker.addResults(frame, results, finished);
+
+  // Frames without anything new reuse the results.  They keep the plate in the scene
+  // for longer than maxMissedFrames, but are not new sightings
+  for (int i = 0; i < 5; i++)
+  {
+    AlprResults reused = tracker.skipRecognition(frame, finished);
+    REQUIRE( tracker.lastFrameReused() );
+    REQUIRE( reused.plates.size() == 1 );
+  }
+  REQUIRE( finished.size() == 0 );
+
+  vector<AlprPlateGroup> groups = tracker.flush();
+  REQUIRE( groups.size() == 1 );
+  REQUIRE( groups[0].frame_count == 1 );
+  REQUIRE( groups[0].first_seen_epoch == 1000 );
+  REQUIRE( groups[0].last_seen_epoch > 1000 );
+  REQUIRE( groups[0].candidates.size() == 1 );
+
+  // flush() forgets the previous results too
+  REQUIRE( tracker.skipRecognition(frame, finished).plates.size() == 0 );
+  REQUIRE( tracker.flush().size() == 0 );
+}
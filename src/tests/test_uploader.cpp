@@ -0,0 +1,612 @@
+/*
+ * Tests for the alprd uploader, against a local beanstalkd and HTTP endpoint
+ * that run inside the test process.
+ */
+
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <log4cplus/logger.h>
+
+#include "catch.hpp"
+#include "cjson.h"
+#include "daemon/uploader.h"
+#include "support/platform.h"
+#include "support/timing.h"
+#include "support/tinythread.h"
+
+using namespace std;
+using namespace alpr;
+
+static bool sendAll(int fd, const string& data)
+{
+  size_t sent = 0;
+  while (sent < data.length())
+  {
+    ssize_t bytes = send(fd, data.data() + sent, data.length() - sent, MSG_NOSIGNAL);
+    if (bytes <= 0)
+      return false;
+    sent += bytes;
+  }
+  return true;
+}
+
+// Reads from the socket until buffer holds at least length bytes
+static bool fillBuffer(int fd, string& buffer, size_t length)
+{
+  char chunk[4096];
+  while (buffer.length() < length)
+  {
+    ssize_t bytes = recv(fd, chunk, sizeof(chunk), 0);
+    if (bytes <= 0)
+      return false;
+    buffer.append(chunk, bytes);
+  }
+  return true;
+}
+
+// Takes everything up to the delimiter off the front of the buffer
+static bool readUntil(int fd, string& buffer, const string& delimiter, string& result)
+{
+  size_t end;
+  while ((end = buffer.find(delimiter)) == string::npos)
+  {
+    if (!fillBuffer(fd, buffer, buffer.length() + 1))
+      return false;
+  }
+
+  result = buffer.substr(0, end);
+  buffer.erase(0, end + delimiter.length());
+  return true;
+}
+
+// Accepts connections on a free local port, and handles each one on a thread of its own.
+// Subclasses must call stop() in their destructor
+class LocalServer
+{
+  public:
+    LocalServer()
+    {
+      listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+
+      sockaddr_in address;
+      memset(&address, 0, sizeof(address));
+      address.sin_family = AF_INET;
+      address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      address.sin_port = 0;
+      bind(listen_fd, (sockaddr*) &address, sizeof(address));
+      listen(listen_fd, 16);
+
+      socklen_t length = sizeof(address);
+      getsockname(listen_fd, (sockaddr*) &address, &length);
+      server_port = ntohs(address.sin_port);
+
+      accept_thread = NULL;
+    }
+
+    virtual ~LocalServer()
+    {
+    }
+
+    int port()
+    {
+      return server_port;
+    }
+
+    void start()
+    {
+      accept_thread = new tthread::thread(acceptThread, (void*) this);
+    }
+
+    void stop()
+    {
+      if (accept_thread == NULL)
+        return;
+
+      shutdown(listen_fd, SHUT_RDWR);
+      close(listen_fd);
+      accept_thread->join();
+      delete accept_thread;
+      accept_thread = NULL;
+
+      connections_mutex.lock();
+      for (unsigned int i = 0; i < connection_fds.size(); i++)
+        shutdown(connection_fds[i], SHUT_RDWR);
+      connections_mutex.unlock();
+
+      for (unsigned int i = 0; i < connection_threads.size(); i++)
+      {
+        connection_threads[i]->join();
+        delete connection_threads[i];
+      }
+      connection_threads.clear();
+    }
+
+  protected:
+    tthread::mutex mutex;
+
+    // Serves one client until it disconnects.  The socket is closed by the caller
+    virtual void handleConnection(int fd) = 0;
+
+  private:
+    struct Connection
+    {
+      LocalServer* server;
+      int fd;
+    };
+
+    int listen_fd;
+    int server_port;
+    tthread::thread* accept_thread;
+
+    tthread::mutex connections_mutex;
+    vector<int> connection_fds;
+    vector<tthread::thread*> connection_threads;
+
+    static void acceptThread(void* arg)
+    {
+      LocalServer* server = (LocalServer*) arg;
+      while (true)
+      {
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0)
+          return;
+
+        Connection* connection = new Connection();
+        connection->server = server;
+        connection->fd = fd;
+
+        tthread::lock_guard<tthread::mutex> guard(server->connections_mutex);
+        server->connection_fds.push_back(fd);
+        server->connection_threads.push_back(new tthread::thread(connectionThread, (void*) connection));
+      }
+    }
+
+    static void connectionThread(void* arg)
+    {
+      Connection* connection = (Connection*) arg;
+      connection->server->handleConnection(connection->fd);
+
+      connection->server->connections_mutex.lock();
+      vector<int>& fds = connection->server->connection_fds;
+      fds.erase(std::find(fds.begin(), fds.end(), connection->fd));
+      close(connection->fd);
+      connection->server->connections_mutex.unlock();
+
+      delete connection;
+    }
+};
+
+// The part of the beanstalkd protocol the uploader speaks, for a single tube
+class FakeBeanstalk : public LocalServer
+{
+  public:
+    struct Release
+    {
+      int64_t id;
+      int priority;
+      int delay_seconds;
+    };
+
+    FakeBeanstalk()
+    {
+      next_id = 1;
+      start();
+    }
+
+    virtual ~FakeBeanstalk()
+    {
+      stop();
+    }
+
+    void addJob(const string& body)
+    {
+      tthread::lock_guard<tthread::mutex> guard(mutex);
+
+      Job job;
+      job.body = body;
+      job.priority = 0;
+      job.ready_time = 0;
+      job.reserved = false;
+      jobs[next_id++] = job;
+    }
+
+    int jobCount()
+    {
+      tthread::lock_guard<tthread::mutex> guard(mutex);
+      return jobs.size();
+    }
+
+    vector<Release> getReleases()
+    {
+      tthread::lock_guard<tthread::mutex> guard(mutex);
+      return releases;
+    }
+
+  protected:
+    virtual void handleConnection(int fd)
+    {
+      string buffer;
+      string line;
+      while (readUntil(fd, buffer, "\r\n", line))
+      {
+        istringstream command(line);
+        string name;
+        command >> name;
+
+        stringstream reply;
+        if (name == "use" || name == "watch")
+        {
+          string tube;
+          command >> tube;
+          if (name == "use")
+            reply << "USING " << tube << "\r\n";
+          else
+            reply << "WATCHING 1\r\n";
+        }
+        else if (name == "reserve-with-timeout")
+        {
+          int timeout_seconds;
+          command >> timeout_seconds;
+          reserve(timeout_seconds, reply);
+        }
+        else if (name == "release")
+        {
+          Release release;
+          command >> release.id >> release.priority >> release.delay_seconds;
+
+          tthread::lock_guard<tthread::mutex> guard(mutex);
+          Job& job = jobs[release.id];
+          job.reserved = false;
+          job.priority = release.priority;
+          job.ready_time = getTimeMonotonicMs() + release.delay_seconds * 1000;
+          releases.push_back(release);
+          reply << "RELEASED\r\n";
+        }
+        else if (name == "delete")
+        {
+          int64_t id;
+          command >> id;
+
+          tthread::lock_guard<tthread::mutex> guard(mutex);
+          jobs.erase(id);
+          reply << "DELETED\r\n";
+        }
+        else if (name == "stats-tube")
+        {
+          int ready = 0;
+          int delayed = 0;
+          {
+            tthread::lock_guard<tthread::mutex> guard(mutex);
+            int64_t now = getTimeMonotonicMs();
+            for (map<int64_t, Job>::iterator it = jobs.begin(); it != jobs.end(); it++)
+            {
+              if (it->second.reserved)
+                continue;
+              if (it->second.ready_time <= now)
+                ready++;
+              else
+                delayed++;
+            }
+          }
+
+          stringstream yaml;
+          yaml << "---\ncurrent-jobs-ready: " << ready << "\ncurrent-jobs-delayed: " << delayed << "\n";
+          reply << "OK " << yaml.str().length() << "\r\n" << yaml.str() << "\r\n";
+        }
+        else
+        {
+          reply << "UNKNOWN_COMMAND\r\n";
+        }
+
+        if (!sendAll(fd, reply.str()))
+          return;
+      }
+    }
+
+  private:
+    struct Job
+    {
+      string body;
+      int priority;
+      int64_t ready_time;
+      bool reserved;
+    };
+
+    map<int64_t, Job> jobs;
+    int64_t next_id;
+    vector<Release> releases;
+
+    // Hands out the ready job with the lowest priority value, oldest first, like beanstalkd
+    void reserve(int timeout_seconds, stringstream& reply)
+    {
+      int64_t deadline = getTimeMonotonicMs() + timeout_seconds * 1000;
+      while (true)
+      {
+        {
+          tthread::lock_guard<tthread::mutex> guard(mutex);
+          int64_t now = getTimeMonotonicMs();
+
+          map<int64_t, Job>::iterator best = jobs.end();
+          for (map<int64_t, Job>::iterator it = jobs.begin(); it != jobs.end(); it++)
+          {
+            if (it->second.reserved || it->second.ready_time > now)
+              continue;
+            if (best == jobs.end() || it->second.priority < best->second.priority)
+              best = it;
+          }
+
+          if (best != jobs.end())
+          {
+            best->second.reserved = true;
+            reply << "RESERVED " << best->first << " " << best->second.body.length() << "\r\n" << best->second.body << "\r\n";
+            return;
+          }
+
+          if (now >= deadline)
+          {
+            reply << "TIMED_OUT\r\n";
+            return;
+          }
+        }
+
+        sleep_ms(10);
+      }
+    }
+};
+
+// An HTTP endpoint that fails the first few requests, and records every one
+class FakeHttpEndpoint : public LocalServer
+{
+  public:
+    struct Request
+    {
+      int64_t time;
+      string body;
+    };
+
+    FakeHttpEndpoint(int failed_requests, int response_delay_ms)
+    {
+      this->failed_requests = failed_requests;
+      this->response_delay_ms = response_delay_ms;
+      active = 0;
+      max_active = 0;
+      start();
+    }
+
+    virtual ~FakeHttpEndpoint()
+    {
+      stop();
+    }
+
+    string url()
+    {
+      stringstream url;
+      url << "http://127.0.0.1:" << port() << "/push/";
+      return url.str();
+    }
+
+    vector<Request> getRequests()
+    {
+      tthread::lock_guard<tthread::mutex> guard(mutex);
+      return requests;
+    }
+
+    int maxConcurrentRequests()
+    {
+      tthread::lock_guard<tthread::mutex> guard(mutex);
+      return max_active;
+    }
+
+  protected:
+    virtual void handleConnection(int fd)
+    {
+      string buffer;
+      string header;
+      if (!readUntil(fd, buffer, "\r\n\r\n", header))
+        return;
+
+      std::transform(header.begin(), header.end(), header.begin(), ::tolower);
+      size_t length_start = header.find("content-length:");
+      size_t content_length = 0;
+      if (length_start != string::npos)
+        content_length = atoi(header.c_str() + length_start + strlen("content-length:"));
+
+      if (!fillBuffer(fd, buffer, content_length))
+        return;
+
+      Request request;
+      request.time = getTimeMonotonicMs();
+      request.body = buffer.substr(0, content_length);
+
+      bool fail;
+      {
+        tthread::lock_guard<tthread::mutex> guard(mutex);
+        fail = (int) requests.size() < failed_requests;
+        requests.push_back(request);
+        active++;
+        max_active = std::max(max_active, active);
+      }
+
+      sleep_ms(response_delay_ms);
+
+      mutex.lock();
+      active--;
+      mutex.unlock();
+
+      if (fail)
+        sendAll(fd, "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+      else
+        sendAll(fd, "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: close\r\n\r\nok");
+    }
+
+  private:
+    int failed_requests;
+    int response_delay_ms;
+    vector<Request> requests;
+    int active;
+    int max_active;
+};
+
+static void uploadThread(void* arg)
+{
+  HttpUploader* uploader = (HttpUploader*) arg;
+  uploader->run();
+}
+
+// Runs the uploader until every job has been deleted from the queue, or the time is up
+static bool uploadAll(HttpUploader& uploader, FakeBeanstalk& queue, int timeout_ms)
+{
+  tthread::thread thread(uploadThread, (void*) &uploader);
+
+  int64_t deadline = getTimeMonotonicMs() + timeout_ms;
+  while (queue.jobCount() > 0 && getTimeMonotonicMs() < deadline)
+    sleep_ms(20);
+
+  uploader.stop();
+  thread.join();
+
+  return queue.jobCount() == 0;
+}
+
+static string jobBody(int index)
+{
+  stringstream body;
+  body << "{\"index\":" << index << "}";
+  return body.str();
+}
+
+// The index of each result in a request body, which holds one result or an array of them
+static vector<int> postedIndexes(const string& body)
+{
+  vector<int> indexes;
+
+  cJSON* root = cJSON_Parse(body.c_str());
+  REQUIRE( root != NULL );
+  if (root->type == cJSON_Array)
+  {
+    for (int i = 0; i < cJSON_GetArraySize(root); i++)
+      indexes.push_back(cJSON_GetObjectItem(cJSON_GetArrayItem(root, i), "index")->valueint);
+  }
+  else
+  {
+    indexes.push_back(cJSON_GetObjectItem(root, "index")->valueint);
+  }
+  cJSON_Delete(root);
+
+  return indexes;
+}
+
+static log4cplus::Logger testLogger()
+{
+  return log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("daemontests"));
+}
+
+TEST_CASE( "Uploader posts the queued results in batches", "[daemon]" ) {
+
+  FakeBeanstalk queue;
+  FakeHttpEndpoint endpoint(0, 20);
+  for (int i = 0; i < 10; i++)
+    queue.addJob(jobBody(i));
+
+  HttpUploader uploader(endpoint.url(), "127.0.0.1", queue.port(), "alprd", 1, 4, testLogger());
+  REQUIRE( uploadAll(uploader, queue, 10000) );
+
+  // Every result that was ready went out in full batches, as JSON arrays
+  vector<FakeHttpEndpoint::Request> requests = endpoint.getRequests();
+  REQUIRE( requests.size() == 3 );
+  REQUIRE( requests[0].body[0] == '[' );
+
+  vector<int> posted;
+  for (unsigned int i = 0; i < requests.size(); i++)
+  {
+    vector<int> indexes = postedIndexes(requests[i].body);
+    REQUIRE( indexes.size() == (i < 2 ? 4 : 2) );
+    posted.insert(posted.end(), indexes.begin(), indexes.end());
+  }
+  for (int i = 0; i < 10; i++)
+    REQUIRE( posted[i] == i );
+
+  UploaderStatistics statistics = uploader.getStatistics();
+  REQUIRE( statistics.requests == 3 );
+  REQUIRE( statistics.uploaded == 10 );
+  REQUIRE( statistics.failed_requests == 0 );
+  REQUIRE( statistics.in_flight == 0 );
+}
+
+TEST_CASE( "Uploader limits the requests in flight", "[daemon]" ) {
+
+  FakeBeanstalk queue;
+  FakeHttpEndpoint endpoint(0, 200);
+  for (int i = 0; i < 12; i++)
+    queue.addJob(jobBody(i));
+
+  HttpUploader uploader(endpoint.url(), "127.0.0.1", queue.port(), "alprd", 3, 1, testLogger());
+  REQUIRE( uploadAll(uploader, queue, 10000) );
+
+  REQUIRE( endpoint.maxConcurrentRequests() == 3 );
+
+  // Single results are posted as a plain object
+  vector<FakeHttpEndpoint::Request> requests = endpoint.getRequests();
+  REQUIRE( requests.size() == 12 );
+  for (unsigned int i = 0; i < requests.size(); i++)
+  {
+    REQUIRE( requests[i].body[0] == '{' );
+    REQUIRE( postedIndexes(requests[i].body).size() == 1 );
+  }
+
+  REQUIRE( uploader.getStatistics().uploaded == 12 );
+}
+
+TEST_CASE( "Uploader backs off after a failed request", "[daemon]" ) {
+
+  FakeBeanstalk queue;
+  FakeHttpEndpoint endpoint(2, 0);
+  queue.addJob(jobBody(0));
+  queue.addJob(jobBody(1));
+
+  HttpUploader uploader(endpoint.url(), "127.0.0.1", queue.port(), "alprd", 1, 1, testLogger());
+  REQUIRE( uploadAll(uploader, queue, 15000) );
+
+  // Each failed job is released with the current backoff, which doubles from 1 second, at a
+  // lower priority than the results that have not been tried yet
+  vector<FakeBeanstalk::Release> releases = queue.getReleases();
+  REQUIRE( releases.size() == 2 );
+  REQUIRE( releases[0].id == 1 );
+  REQUIRE( releases[0].delay_seconds == 1 );
+  REQUIRE( releases[0].priority == 1 );
+  REQUIRE( releases[1].id == 2 );
+  REQUIRE( releases[1].delay_seconds == 2 );
+  REQUIRE( releases[1].priority == 1 );
+
+  // No request starts while the endpoint is backing off, even with other results ready
+  vector<FakeHttpEndpoint::Request> requests = endpoint.getRequests();
+  REQUIRE( requests.size() == 4 );
+  REQUIRE( postedIndexes(requests[0].body)[0] == 0 );
+  REQUIRE( postedIndexes(requests[1].body)[0] == 1 );
+  REQUIRE( postedIndexes(requests[2].body)[0] == 0 );
+  REQUIRE( postedIndexes(requests[3].body)[0] == 1 );
+  REQUIRE( requests[1].time - requests[0].time >= 950 );
+  REQUIRE( requests[2].time - requests[1].time >= 1950 );
+
+  // A success ends the backoff, so the last result follows straight away
+  REQUIRE( requests[3].time - requests[2].time < 950 );
+
+  UploaderStatistics statistics = uploader.getStatistics();
+  REQUIRE( statistics.uploaded == 2 );
+  REQUIRE( statistics.failed_requests == 2 );
+  REQUIRE( statistics.retries == 2 );
+  REQUIRE( statistics.backoff_ms == 0 );
+}
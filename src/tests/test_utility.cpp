@@ -7,6 +7,9 @@
 
 #include <cstdlib>
 #include "utility.h"
+#include "binarize_wolf.h"
+#include "support/worker_pool.h"
+#include "pipeline_statistics.h"
 #include "catch.hpp"
 
 using namespace std;
@@ -63,4 +66,104 @@ TEST_CASE( "Test Levenshtein Distance", "[levenshtein]" ) {
   
   REQUIRE( levenshteinDistance("", "AAAA", 2) == 2 );
   REQUIRE( levenshteinDistance("BA", "AAAA", 2) == 2 );
-}
\ No newline at end of file
+}
+
+void squareTask(void* arg)
+{
+  int* value = (int*) arg;
+  *value = (*value) * (*value);
+}
+
+TEST_CASE( "Test Worker Pool", "[threading]" ) {
+
+  for (int num_threads = 1; num_threads <= 4; num_threads++)
+  {
+    WorkerPool pool(num_threads);
+    REQUIRE( pool.getNumThreads() == num_threads );
+
+    std::vector<int> values;
+    for (int i = 0; i < 50; i++)
+      values.push_back(i);
+
+    std::vector<void*> args;
+    for (unsigned int i = 0; i < values.size(); i++)
+      args.push_back(&values[i]);
+
+    pool.run(squareTask, args);
+
+    for (int i = 0; i < 50; i++)
+      REQUIRE( values[i] == i * i );
+  }
+}
+
+TEST_CASE( "Test Latency Histogram", "[statistics]" ) {
+
+  PipelineStatistics statistics;
+
+  // 1ms to 1000ms, evenly spread
+  for (int i = 1; i <= 1000; i++)
+    statistics.recordStage(STAGE_OCR, i);
+
+  statistics.increment(COUNTER_IMAGES, 3);
+  statistics.recordDisqualified("Low confidence in characteranalysis");
+  statistics.recordDisqualified("Low confidence in characteranalysis");
+
+  AlprStatistics summary = statistics.getStatistics();
+  REQUIRE( summary.stages.size() == STAGE_COUNT );
+
+  AlprStageStatistics ocr = summary.stages[STAGE_OCR];
+  REQUIRE( ocr.stage == "ocr" );
+  REQUIRE( ocr.count == 1000 );
+  REQUIRE( ocr.total_ms == Approx(500500) );
+  REQUIRE( ocr.max_ms == Approx(1000) );
+  REQUIRE( ocr.p50_ms == Approx(500).epsilon(0.07) );
+  REQUIRE( ocr.p90_ms == Approx(900).epsilon(0.07) );
+  REQUIRE( ocr.p99_ms == Approx(990).epsilon(0.07) );
+
+  REQUIRE( summary.stages[STAGE_DETECTION].count == 0 );
+  REQUIRE( summary.counters["images"] == 3 );
+  REQUIRE( summary.counters["candidates_disqualified"] == 2 );
+  REQUIRE( summary.disqualify_reasons["Low confidence in characteranalysis"] == 2 );
+
+  statistics.reset();
+  summary = statistics.getStatistics();
+  REQUIRE( summary.stages[STAGE_OCR].count == 0 );
+  REQUIRE( summary.counters["images"] == 0 );
+  REQUIRE( summary.disqualify_reasons.size() == 0 );
+}
+
+TEST_CASE( "Test Multi Binarization Matches Reference", "[binarize]" ) {
+
+  // Mostly white, so the windows reach the largest possible sums of squares
+  Mat im(420, 420, CV_8U, Scalar(255));
+  rectangle(im, Rect(150, 190, 120, 40), Scalar(20), CV_FILLED);
+  for (int x = 0; x < im.cols; x += 7)
+    line(im, Point(x, 0), Point(x, 60), Scalar(x % 200), 1);
+
+  // Window areas just below and above the largest one the vectorized code handles, plus a 199x199
+  // window that is entirely white in the corners
+  int windows[][2] = { { 15, 15 }, { 175, 187 }, { 181, 183 }, { 199, 199 } };
+  NiblackVersion versions[] = { NIBLACK, SAUVOLA, WOLFJOLION };
+
+  std::vector<NiblackParams> params;
+  for (int w = 0; w < 4; w++)
+  {
+    for (int v = 0; v < 3; v++)
+      params.push_back(niblackParams(versions[v], windows[w][0], windows[w][1], 0.5));
+  }
+
+  std::vector<Mat> outputs;
+  NiblackSauvolaWolfJolionMulti(im, outputs, params);
+  REQUIRE( outputs.size() == params.size() );
+
+  for (unsigned int p = 0; p < params.size(); p++)
+  {
+    Mat expected(im.rows, im.cols, CV_8U);
+    NiblackSauvolaWolfJolion(im, expected, params[p].version, params[p].winx, params[p].winy, params[p].k, params[p].dR);
+
+    Mat differences;
+    compare(expected, outputs[p], differences, CMP_NE);
+    INFO( "window " << params[p].winx << "x" << params[p].winy << ", version " << params[p].version );
+    REQUIRE( countNonZero(differences) == 0 );
+  }
+}
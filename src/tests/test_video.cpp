@@ -0,0 +1,144 @@
+#include <cstdlib>
+#include <vector>
+#include "catch.hpp"
+#include "motiondetector.h"
+#include "video/videobuffer.h"
+
+using namespace std;
+using namespace cv;
+using namespace alpr;
+
+// Runs motion detection on a frame that shows the blobs in front of an otherwise static background
+static vector<Rect> detectMotion(const vector<Rect>& blobs, int padding, Size minSize)
+{
+  Mat background(480, 640, CV_8UC3, Scalar(50, 50, 50));
+  Mat frame = background.clone();
+  for (unsigned int i = 0; i < blobs.size(); i++)
+    rectangle(frame, blobs[i], Scalar(255, 255, 255), CV_FILLED);
+
+  MotionDetector motionDetector;
+  motionDetector.ResetMotionDetection(&background);
+  return motionDetector.MotionDetectRegions(&frame, padding, minSize);
+}
+
+// True if outer fully contains inner
+static bool containsRect(Rect outer, Rect inner)
+{
+  return (outer & inner) == inner;
+}
+
+TEST_CASE( "Motion regions are padded around each moving area", "[motion]" ) {
+
+  vector<Rect> blobs;
+  blobs.push_back(Rect(100, 100, 40, 20));
+  blobs.push_back(Rect(400, 300, 40, 20));
+
+  vector<Rect> regions = detectMotion(blobs, 10, Size(0, 0));
+  REQUIRE( regions.size() == 2 );
+
+  for (unsigned int i = 0; i < blobs.size(); i++)
+  {
+    Rect padded(blobs[i].x - 11, blobs[i].y - 11, blobs[i].width + 22, blobs[i].height + 22);
+
+    int found = 0;
+    for (unsigned int r = 0; r < regions.size(); r++)
+    {
+      if (containsRect(regions[r], blobs[i]) && containsRect(padded, regions[r]))
+        found++;
+    }
+    REQUIRE( found == 1 );
+  }
+}
+
+TEST_CASE( "Motion regions that touch are merged", "[motion]" ) {
+
+  // 10 pixels apart, so the padded areas overlap
+  vector<Rect> blobs;
+  blobs.push_back(Rect(100, 100, 40, 20));
+  blobs.push_back(Rect(150, 100, 40, 20));
+
+  vector<Rect> regions = detectMotion(blobs, 10, Size(0, 0));
+  REQUIRE( regions.size() == 1 );
+  REQUIRE( containsRect(regions[0], blobs[0] | blobs[1]) );
+
+  // Far enough apart without padding
+  regions = detectMotion(blobs, 0, Size(0, 0));
+  REQUIRE( regions.size() == 2 );
+}
+
+TEST_CASE( "Small motion is dropped and small regions are grown", "[motion]" ) {
+
+  vector<Rect> blobs;
+  blobs.push_back(Rect(300, 200, 12, 12));
+
+  // Less than a quarter of the minimum size is noise
+  REQUIRE( detectMotion(blobs, 0, Size(60, 30)).size() == 0 );
+  REQUIRE( detectMotion(blobs, 0, Size(0, 0)).size() == 1 );
+
+  blobs.clear();
+  blobs.push_back(Rect(300, 200, 60, 30));
+
+  vector<Rect> regions = detectMotion(blobs, 0, Size(100, 50));
+  REQUIRE( regions.size() == 1 );
+  REQUIRE( regions[0].width >= 100 );
+  REQUIRE( regions[0].height >= 50 );
+  REQUIRE( regions[0].contains(Point(330, 215)) );
+}
+
+static void pushFrame(FrameRingBuffer& ring, int value)
+{
+  Mat image(48, 64, CV_8UC3, Scalar(value, value, value));
+  ring.push(image, vector<Rect>());
+}
+
+TEST_CASE( "Frame buffers are reused once the consumers release them", "[video]" ) {
+
+  FrameRingBuffer ring(2);
+  VideoFrame frame;
+
+  pushFrame(ring, 1);
+  REQUIRE( ring.pop(&frame) );
+  uchar* first_buffer = frame.image.data;
+  frame.image.release();
+
+  pushFrame(ring, 2);
+  REQUIRE( ring.pop(&frame) );
+  REQUIRE( frame.image.data == first_buffer );
+  REQUIRE( frame.image.at<Vec3b>(0, 0)[0] == 2 );
+
+  // Still held, so the next frame needs a buffer of its own
+  pushFrame(ring, 3);
+  VideoFrame next;
+  REQUIRE( ring.pop(&next) );
+  REQUIRE( next.image.data != first_buffer );
+  REQUIRE( next.image.at<Vec3b>(0, 0)[0] == 3 );
+  REQUIRE( frame.image.at<Vec3b>(0, 0)[0] == 2 );
+}
+
+TEST_CASE( "Frames nobody took are counted as dropped", "[video]" ) {
+
+  FrameRingBuffer ring(4);
+  VideoFrame frame;
+
+  REQUIRE( ring.popLatest(&frame) == false );
+
+  // Skipping to the newest frame drops the ones before it
+  for (int i = 0; i < 3; i++)
+    pushFrame(ring, i);
+  REQUIRE( ring.popLatest(&frame) );
+  REQUIRE( frame.sequence == 2 );
+  REQUIRE( ring.getDroppedFrames() == 2 );
+  REQUIRE( ring.pop(&frame) == false );
+
+  // Overflowing the ring drops the oldest frames
+  for (int i = 3; i < 9; i++)
+    pushFrame(ring, i);
+  REQUIRE( ring.getDroppedFrames() == 4 );
+  REQUIRE( ring.pop(&frame) );
+  REQUIRE( frame.sequence == 5 );
+
+  REQUIRE( ring.popLatest(&frame) );
+  REQUIRE( frame.sequence == 8 );
+  REQUIRE( ring.getDroppedFrames() == 6 );
+  REQUIRE( ring.getPushedFrames() == 9 );
+}
@@ -19,6 +19,8 @@
 
 #include "videobuffer.h"
 
+#include <algorithm>
+
 using namespace alpr;
 
 void imageCollectionThread(void* arg);
@@ -28,7 +30,8 @@ void getALPRImages(cv::VideoCapture cap, VideoDispatcher* dispatcher);
 VideoBuffer::VideoBuffer()
 {
   dispatcher = NULL;
-  
+  frame_mutex = NULL;
+  frame_available = NULL;
 }
 
 VideoBuffer::~VideoBuffer()
@@ -68,11 +71,19 @@ void VideoBuffer::connect(std::string mjpeg_url, int fps)
     }
     
     dispatcher = createDispatcher(mjpeg_url, fps);
+    dispatcher->frame_mutex = frame_mutex;
+    dispatcher->frame_available = frame_available;
       
     tthread::thread* t = new tthread::thread(imageCollectionThread, (void*) dispatcher);
     
 }
 
+void VideoBuffer::setFrameNotification(tthread::mutex* mutex, tthread::condition_variable* frameAvailable)
+{
+  frame_mutex = mutex;
+  frame_available = frameAvailable;
+}
+
 int VideoBuffer::getLatestFrame(cv::Mat* frame, std::vector<cv::Rect>& regionsOfInterest)
 {
   if (dispatcher == NULL)
@@ -81,6 +92,30 @@ int VideoBuffer::getLatestFrame(cv::Mat* frame, std::vector<cv::Rect>& regionsOf
   return dispatcher->getLatestFrame(frame, regionsOfInterest);
 }
 
+bool VideoBuffer::getLatestFrame(VideoFrame* frame)
+{
+  if (dispatcher == NULL)
+    return false;
+  
+  return dispatcher->getLatestFrame(frame);
+}
+
+bool VideoBuffer::getNextFrame(VideoFrame* frame)
+{
+  if (dispatcher == NULL)
+    return false;
+  
+  return dispatcher->getNextFrame(frame);
+}
+
+int64_t VideoBuffer::getDroppedFrames()
+{
+  if (dispatcher == NULL)
+    return 0;
+  
+  return dispatcher->getDroppedFrames();
+}
+
 
 void VideoBuffer::disconnect()
 {
@@ -96,6 +131,146 @@ void VideoBuffer::disconnect()
 
 
 
+FrameRingBuffer::FrameRingBuffer(int capacity)
+{
+  if (capacity < 1)
+    capacity = 1;
+  
+  slots.resize(capacity);
+  write_seq = 0;
+  read_seq = 0;
+  dropped = 0;
+}
+
+// True if the Mat holds the only reference to its pixel data.  Consumers release their references
+// on other threads with atomic decrements, so the count is read atomically as well (adding 0 is also
+// a full barrier, so the consumer is done reading the pixels before they are overwritten)
+static bool isUnshared(const cv::Mat& mat)
+{
+#if OPENCV_MAJOR_VERSION == 2
+  return mat.refcount != NULL && CV_XADD(mat.refcount, 0) == 1;
+#else
+  return mat.u != NULL && CV_XADD(&mat.u->refcount, 0) == 1;
+#endif
+}
+
+// Returns the index of a buffer that neither the ring nor any consumer still references,
+// or -1 if every buffer is in use
+int FrameRingBuffer::findFreeBuffer()
+{
+  for (unsigned int i = 0; i < buffers.size(); i++)
+  {
+    if (isUnshared(buffers[i]))
+      return i;
+  }
+  
+  return -1;
+}
+
+void FrameRingBuffer::push(cv::Mat image, std::vector<cv::Rect> regionsOfInterest)
+{
+  // The capture backend reuses its buffer for the next frame (e.g., VideoCapture::retrieve in
+  // OpenCV 2.4 returns a header over its internal image), so the pixels must be copied here
+  VideoFrame incoming;
+  int free_buffer = findFreeBuffer();
+  if (free_buffer >= 0)
+    incoming.image = buffers[free_buffer];
+  
+  // Only allocates if the buffer is missing or the frame size changed
+  image.copyTo(incoming.image);
+  
+  // Keep track of the buffers so they can be reused once the consumers are done with them.  Consumers
+  // may hold on to frames, so allow more buffers than slots before giving up on tracking new ones
+  if (free_buffer >= 0)
+    buffers[free_buffer] = incoming.image;
+  else if (buffers.size() < slots.size() * 2)
+    buffers.push_back(incoming.image);
+  
+  incoming.capture_time = getEpochTimeMs();
+  incoming.regionsOfInterest = regionsOfInterest;
+  
+  {
+    tthread::lock_guard<tthread::fast_mutex> guard(mutex);
+    
+    // The ring is full, the oldest frame nobody took is lost
+    if (write_seq - read_seq >= (int64_t) slots.size())
+    {
+      read_seq++;
+      dropped++;
+    }
+    
+    incoming.sequence = write_seq;
+    
+    // Swap rather than assign, so the frame previously in the slot is released outside the lock
+    VideoFrame& slot = slots[write_seq % slots.size()];
+    std::swap(slot.image, incoming.image);
+    std::swap(slot.regionsOfInterest, incoming.regionsOfInterest);
+    slot.sequence = incoming.sequence;
+    slot.capture_time = incoming.capture_time;
+    
+    write_seq++;
+  }
+}
+
+bool FrameRingBuffer::pop(VideoFrame* frame)
+{
+  VideoFrame taken;
+  {
+    tthread::lock_guard<tthread::fast_mutex> guard(mutex);
+    
+    if (read_seq == write_seq)
+      return false;
+    
+    takeSlot(read_seq, &taken);
+    read_seq++;
+  }
+  
+  *frame = taken;
+  return true;
+}
+
+bool FrameRingBuffer::popLatest(VideoFrame* frame)
+{
+  VideoFrame taken;
+  {
+    tthread::lock_guard<tthread::fast_mutex> guard(mutex);
+    
+    if (read_seq == write_seq)
+      return false;
+    
+    dropped += (write_seq - 1) - read_seq;
+    takeSlot(write_seq - 1, &taken);
+    read_seq = write_seq;
+  }
+  
+  *frame = taken;
+  return true;
+}
+
+// Must be called with the mutex held.  Moves the frame out of its slot, so the consumer
+// ends up holding the only reference to it
+void FrameRingBuffer::takeSlot(int64_t sequence, VideoFrame* frame)
+{
+  VideoFrame& slot = slots[sequence % slots.size()];
+  std::swap(frame->image, slot.image);
+  std::swap(frame->regionsOfInterest, slot.regionsOfInterest);
+  frame->sequence = slot.sequence;
+  frame->capture_time = slot.capture_time;
+}
+
+int64_t FrameRingBuffer::getDroppedFrames()
+{
+  tthread::lock_guard<tthread::fast_mutex> guard(mutex);
+  return dropped;
+}
+
+int64_t FrameRingBuffer::getPushedFrames()
+{
+  tthread::lock_guard<tthread::fast_mutex> guard(mutex);
+  return write_seq;
+}
+
+
 void imageCollectionThread(void* arg)
 {
   
@@ -188,9 +363,8 @@ void getALPRImages(cv::VideoCapture cap, VideoDispatcher* dispatcher)
 	  return;
 	}
 	
-	dispatcher->mMutex.lock();
+	// The dispatcher copies the frame, the capture may overwrite this buffer on the next read
 	dispatcher->setLatestFrame(frame);
-	dispatcher->mMutex.unlock();
       }
       catch (const std::runtime_error& error)
       {
@@ -198,13 +372,10 @@ void getALPRImages(cv::VideoCapture cap, VideoDispatcher* dispatcher)
 	std::stringstream ss;
 	ss << "Exception happened " <<  error.what();
 	dispatcher->log_error(ss.str());
-	dispatcher->mMutex.unlock();
 	return;
       }
 
       
-      dispatcher->mMutex.unlock();
-      
       if (hasImage == false)
 	break;
       
@@ -9,48 +9,126 @@
 
 #include "support/filesystem.h"
 #include "support/tinythread.h"
+#include "support/fast_mutex.h"
 #include "support/platform.h"
+#include "support/timing.h"
 
 
 
+// The number of frames a stream buffers for its consumers before the oldest is dropped
+const int DEFAULT_FRAME_BUFFER_SIZE = 8;
+
+struct VideoFrame
+{
+  // Shared with the buffer and every other consumer of this frame.  Treat it as read-only (clone it before drawing on it)
+  cv::Mat image;
+  
+  // Frame number since the stream was connected, starting at 0
+  int64_t sequence;
+  
+  // Epoch time (ms) when the frame was captured
+  int64_t capture_time;
+  
+  std::vector<cv::Rect> regionsOfInterest;
+};
+
+// Bounded ring of captured frames.  One thread pushes, any number of threads take frames out.
+// Each pushed image is copied once, into a buffer owned by the ring, and then handed to exactly one
+// consumer without further copies.  Buffers are recycled once every consumer has released them, so a
+// steady stream does not allocate.  The lock only guards the ring indexes and Mat headers; pixel
+// buffers are never copied, allocated or freed while it is held.
+class FrameRingBuffer
+{
+  public:
+    FrameRingBuffer(int capacity);
+    
+    // Adds a copy of the image, overwriting the oldest frame if no consumer has taken it yet.
+    // Called from a single producer thread
+    void push(cv::Mat image, std::vector<cv::Rect> regionsOfInterest);
+    
+    // Takes the oldest frame that has not been handed out.  Returns false if there is none
+    bool pop(VideoFrame* frame);
+    
+    // Takes the newest frame, skipping any older ones that have not been handed out.  Returns false if there is none
+    bool popLatest(VideoFrame* frame);
+    
+    // Frames that were overwritten or skipped before any consumer took them
+    int64_t getDroppedFrames();
+    int64_t getPushedFrames();
+    
+  private:
+    std::vector<VideoFrame> slots;
+    
+    // Sequence number of the next frame to push, and of the next frame to hand out
+    int64_t write_seq;
+    int64_t read_seq;
+    int64_t dropped;
+    
+    tthread::fast_mutex mutex;
+    
+    // Every buffer handed out so far (up to a limit).  Only used by the producer thread
+    std::vector<cv::Mat> buffers;
+    
+    void takeSlot(int64_t sequence, VideoFrame* frame);
+    int findFreeBuffer();
+};
+
 class VideoDispatcher
 {
   public:
-    VideoDispatcher(std::string mjpeg_url, int fps)
+    VideoDispatcher(std::string mjpeg_url, int fps, int buffer_size = DEFAULT_FRAME_BUFFER_SIZE) : frames(buffer_size)
     {
       this->active = true;
-      this->latestFrameNumber = -1;
-      this->lastFrameRead = -1;
       this->fps = fps;
       this->mjpeg_url = mjpeg_url;
+      this->frame_mutex = NULL;
+      this->frame_available = NULL;
     }
     
     
     int getLatestFrame(cv::Mat* frame, std::vector<cv::Rect>& regionsOfInterest)
     {
-      tthread::lock_guard<tthread::mutex> guard(mMutex);
-      
-      if (latestFrameNumber == lastFrameRead)
+      VideoFrame latest;
+      if (!frames.popLatest(&latest))
         return -1;
       
-      frame->create(latestFrame.size(), latestFrame.type());
-      latestFrame.copyTo(*frame);
-      
-      this->lastFrameRead = this->latestFrameNumber;
+      *frame = latest.image;
       
       // Copy the regionsOfInterest array
-      for (int i = 0; i < this->latestRegionsOfInterest.size(); i++)
-          regionsOfInterest.push_back(this->latestRegionsOfInterest[i]);
+      for (int i = 0; i < latest.regionsOfInterest.size(); i++)
+          regionsOfInterest.push_back(latest.regionsOfInterest[i]);
       
-      return this->lastFrameRead;
+      return (int) latest.sequence;
+    }
+    
+    bool getLatestFrame(VideoFrame* frame)
+    {
+      return frames.popLatest(frame);
+    }
+    
+    bool getNextFrame(VideoFrame* frame)
+    {
+      return frames.pop(frame);
     }
     
+    // Called from the capture thread only.  The frame is copied, so the capture may
+    // reuse its buffer for the next frame
     void setLatestFrame(cv::Mat frame)
     {      
-      frame.copyTo(this->latestFrame);
-      this->latestRegionsOfInterest = calculateRegionsOfInterest(&this->latestFrame);
+      frames.push(frame, calculateRegionsOfInterest(&frame));
       
-      this->latestFrameNumber++;
+      // Notifying with the consumers' mutex held, so a consumer that just found no frame
+      // is already waiting and can not miss this one
+      if (frame_available != NULL)
+      {
+        tthread::lock_guard<tthread::mutex> guard(*frame_mutex);
+        frame_available->notify_one();
+      }
+    }
+    
+    int64_t getDroppedFrames()
+    {
+      return frames.getDroppedFrames();
     }
     
     virtual void log_info(std::string message)
@@ -74,16 +152,15 @@ class VideoDispatcher
     
     bool active;
     
-    int latestFrameNumber;
-    int lastFrameRead;
-    
     std::string mjpeg_url;
     int fps;
-    tthread::mutex mMutex;
+    
+    // Signalled after each new frame, if set
+    tthread::mutex* frame_mutex;
+    tthread::condition_variable* frame_available;
     
   private:
-    cv::Mat latestFrame;
-    std::vector<cv::Rect> latestRegionsOfInterest;
+    FrameRingBuffer frames;
 };
 
 class VideoBuffer
@@ -95,11 +172,24 @@ class VideoBuffer
 
     void connect(std::string mjpeg_url, int fps);
     
+    // Signals frameAvailable (with mutex locked) whenever a new frame is captured, so consumers
+    // can wait on it instead of polling.  Call before connect()
+    void setFrameNotification(tthread::mutex* mutex, tthread::condition_variable* frameAvailable);
 
     // If a new frame is available, the function sets "frame" to it and returns the frame number
     // If no frames are available, or the latest has already been grabbed, returns -1.
     // regionsOfInterest is set to a list of good regions to check for license plates.  Default is one rectangle for the entire frame.
     int getLatestFrame(cv::Mat* frame, std::vector<cv::Rect>& regionsOfInterest);
+    
+    // Same as above, with the capture time and sequence number.  Returns false if no new frame is available
+    bool getLatestFrame(VideoFrame* frame);
+    
+    // Takes the oldest frame that has not been handed out yet.  Several threads may share one stream this way,
+    // each frame goes to exactly one of them.  Returns false if no new frame is available
+    bool getNextFrame(VideoFrame* frame);
+    
+    // Frames that were captured but never handed out, because the consumers fell behind
+    int64_t getDroppedFrames();
 
     void disconnect();
     
@@ -111,6 +201,9 @@ class VideoBuffer
     
     
     VideoDispatcher* dispatcher;
+    
+    tthread::mutex* frame_mutex;
+    tthread::condition_variable* frame_available;
 };
 
 